@@ -61,6 +61,31 @@ uint32_t FlashInit(void *base_of_flash, uint32_t image_size,
     result = device->init(base_of_flash);
 #endif /* USE_ARGC_ARGV */
 
+    /* Report the erase blocks and page size of the detected chip. */
+    if(RESULT_ERROR != result && device->layout)
+    {
+        uint32_t page_size;
+        uint32_t overrides = device->layout(LAYOUT_OVERRIDE_BUFFER, &page_size);
+
+        if(overrides & OVERRIDE_PAGESIZE)
+        {
+            SET_PAGESIZE_OVERRIDE(page_size);
+        }
+        result |= overrides;
+    }
+
+    /* Use all of the OCRAM for the download buffer, fewer and larger transfers. */
+    if(RESULT_ERROR != result && device->buffer_size)
+    {
+        uint32_t size = device->buffer_size((uint32_t)(uintptr_t)&FlashBufferStart, &FlashBufferEnd - &FlashBufferStart + 1);
+
+        if(size != 0)
+        {
+            SET_BUFSIZE_OVERRIDE(size);
+            result |= OVERRIDE_BUFSIZE;
+        }
+    }
+
     //if(RESULT_ERROR != result)
     //{
     //    if (FLAG_ERASE_ONLY & flags)
@@ -128,9 +153,9 @@ uint32_t FlashWrite(void *block_start,
                     uint32_t count,
                     char const *buffer)
 {
-    SFDP_DEBUG("FlashWrite start: 0x%08x, offset: %d, count: %d, buffer: 0x%08x", (uint32_t)block_start+offset_into_block, offset_into_block, count, buffer);
+    SFDP_DEBUG("FlashWrite start: 0x%08x, offset: %d, count: %d, buffer: 0x%08x", (uint32_t)(uintptr_t)block_start+offset_into_block, offset_into_block, count, buffer);
 
-    uint32_t status = device->write((uint32_t)block_start+offset_into_block, count, buffer);
+    uint32_t status = device->write((uint32_t)(uintptr_t)block_start+offset_into_block, count, buffer);
 
     SFDP_DEBUG("FlashWrite status: %d", status);
 
@@ -148,7 +173,27 @@ uint32_t FlashWrite(void *block_start,
 uint32_t FlashErase(void *block_start,
                     uint32_t block_size)
 {
-    return device->erase(block_start);
+    return device->erase(block_start, block_size);
+}
+
+/*************************************************************************
+* Function Name: FlashChecksum
+* Parameters:  Start Address, Data size
+*
+* Return: CRC16 of the flash content
+* Description: Calculate the checksum on target so that C-SPY does not
+*              have to read the image back for verification
+*************************************************************************/
+OPTIONAL_CHECKSUM
+
+uint32_t FlashChecksum(void const *begin, uint32_t count)
+{
+    if(device->checksum)
+    {
+        return device->checksum(begin, count);
+    }
+
+    return Crc16((uint8_t const *)begin, count);
 }
 
 OPTIONAL_SIGNOFF
@@ -16,21 +16,163 @@
 *    $Revision: 5068 $
 **************************************************************************/
 
+#include <stdio.h>
+
 #include "fsl_iomuxc.h"
 #include "fsl_lpuart.h"
 #include "fsl_lpspi.h"
 #include "fsl_flexspi.h"
 
 #include "flash_loader.h"
+#include "flash_loader_extra.h"
 
 #include "sfdp.h"
 #include "cm_backtrace.h"
 
 #include "device.h"
+#include "flexspi_lut.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 
 #define FlexSPI_AHB_BASE        0x60000000U
+#define SFDP_SIGNATURE          0x50444653U     // 'S' 'F' 'D' 'P'
+
+/* one LUT instruction, the lower half of a LUT word */
+#define FLEXSPI_LUT_INSTR(cmd, pad, op) ((uint16_t)FLEXSPI_LUT_SEQ((cmd), (pad), (op), 0, 0, 0))
+
+////////////////////////////////////////////////////////////////////////////////
+
+/** necessary functions as device_t call-backs **/
+#if USE_ARGC_ARGV
+static uint32_t init(void *base_of_flash,int argc, char const *argv[]);
+#else
+static uint32_t init(void *base_of_flash);
+#endif /* USE_ARGC_ARGV */
+static uint32_t write(uint32_t addr,uint32_t count,char const *buffer);
+static uint32_t erase(void *block_start, uint32_t size);
+static uint32_t erase_chip(void);
+static uint32_t checksum(void const *begin, uint32_t count);
+static uint32_t signoff(void);
+static uint32_t layout(char *layout, uint32_t *page_size);
+static uint32_t buffer_size(uint32_t start, uint32_t size);
+
+////////////////////////////////////////////////////////////////////////////////
+
+static void flexspi_set_iomux(void);
+#if NOR_PROBE_IOMUX
+static void flexspi_probe_iomux(flexspi_port_t port, bool bus, bool flexspi);
+#endif
+static void flexspi_init(void);
+static void flexspi_set_lut(void);
+static void flexspi_update_lut_seq(uint32_t seq, const uint32_t *seq_lut);
+static void flexspi_set_clock(uint32_t div, flexspi_read_sample_clock_t rx_sample_clock);
+static void flexspi_device_seq(const sfdp_flash *flash, uint32_t seq, uint32_t *seq_lut);
+static void flexspi_erase_seq(const sfdp_flash *flash, uint8_t type, uint32_t *seq_lut);
+static void flexspi_lut_pack(uint32_t *seq_lut, const uint16_t *instr, uint8_t num);
+static bool flexspi_octal(const sfdp_flash *flash);
+static uint32_t flexspi_octal_cmd(const sfdp_flash *flash, uint8_t cmd);
+static void flexspi_octal_seq(const sfdp_flash *flash, uint32_t seq, uint32_t *seq_lut);
+#if FLEXSPI_OCTAL_DDR
+static bool flexspi_octal_capable(const sfdp_flash *flash);
+static void flexspi_octal_enter(FLEXSPI_Type *base, nor_port_t *nor, flexspi_device_config_t *flash_config);
+static void flexspi_octal_exit(FLEXSPI_Type *base, nor_port_t *nor);
+#endif
+static void flexspi_select_device(const nor_port_t *nor);
+static void flexspi_config_port(flexspi_device_config_t *flash_config, flexspi_port_t port);
+static uint32_t flexspi_flash_size(const sfdp_flash *flash);
+static bool flexspi_addr_4b(const sfdp_flash *flash);
+static uint8_t flexspi_addr_bits(const sfdp_flash *flash);
+static uint8_t flexspi_erase_cmd(const sfdp_flash *flash, uint8_t type);
+static uint8_t flexspi_erase_types(const sfdp_flash *flash, uint32_t address, uint32_t *region_end);
+static void flexspi_sector_map(FLEXSPI_Type *base, nor_port_t *nor);
+static void flexspi_probe_ports(flexspi_device_config_t *flash_config);
+#if NOR_MULTI_DEVICE
+static sfdp_err flexspi_sfdp_write_read(const sfdp_spi *spi, const uint8_t *write_buf, size_t write_size,
+                                        uint8_t *read_buf, size_t read_size);
+#endif
+static nor_port_t *nor_port_at(uint32_t index);
+#if FLEXSPI_PARALLEL_MODE
+static status_t flexspi_parallel_Write_Page(FLEXSPI_Type *base, uint32_t dstAddr, char const *src, uint32_t size);
+#endif
+static bool flexspi_qe_readable(const sfdp_flash *flash);
+static uint8_t flexspi_sr_volatile_we(const sfdp_flash *flash);
+static bool flexspi_nor_Quad_Enabled(FLEXSPI_Type *base, nor_port_t *nor);
+static status_t flexspi_nor_Write_QE(FLEXSPI_Type *base, nor_port_t *nor, bool enable, bool volatile_write);
+static void flexspi_read_seq(const sfdp_flash *flash, bool quad, uint32_t *seq_lut);
+static bool flexspi_read_dtr(const sfdp_flash *flash);
+static uint8_t flexspi_dtr_dummy(const sfdp_flash *flash);
+static bool flexspi_read_continuous(const sfdp_flash *flash);
+static void flexspi_continuous_seq(const sfdp_flash *flash, uint32_t *seq_lut);
+static uint32_t checksum_window(void const *begin, uint32_t count);
+static const quad_program_t *quad_program_lookup(const sfdp_flash *flash);
+static uint32_t page_program_size(const sfdp_flash *flash);
+static char *layout_device(char *layout, const sfdp_flash *flash);
+static bool is_blank(char const *data, uint32_t size);
+
+/** internal functions to check status **/
+static status_t flexspi_nor_Erase_Range(FLEXSPI_Type *base, nor_port_t *nor, uint8_t num, uint32_t address, uint32_t size);
+static status_t flexspi_nor_Erase(FLEXSPI_Type *base, nor_port_t *nor, uint32_t address, uint8_t type);
+static status_t flexspi_nor_Write_Page(FLEXSPI_Type *base, nor_port_t *nor, uint32_t dstAddr, uint32_t *src, uint32_t size);
+static status_t flexspi_nor_Read_Register(FLEXSPI_Type *base, nor_port_t *nor, uint32_t seq, uint8_t *value);
+#if !NOR_MULTI_DEVICE
+static status_t flexspi_nor_Read_SFDP(FLEXSPI_Type *base, nor_port_t *nor, uint32_t address, uint32_t *data, uint32_t size);
+#endif
+static status_t flexspi_nor_Write_Enable(FLEXSPI_Type *base, nor_port_t *nor);
+static status_t flexspi_nor_Exit_Continuous(FLEXSPI_Type *base);
+static status_t flexspi_nor_Wait_Bus_If_Busy(FLEXSPI_Type *base, nor_port_t *nor);
+static status_t flexspi_nor_Complete(FLEXSPI_Type *base);
+static status_t flexspi_nor_Complete_Port(FLEXSPI_Type *base, nor_port_t *nor);
+static bool flexspi_nor_Pending(void);
+
+////////////////////////////////////////////////////////////////////////////////
+
+static const quad_program_t quad_program_table[] = QUAD_PAGE_PROGRAM_TABLE;
+
+/* quad page program 1-1-4 / 1-4-4 of the 4-byte address instruction table */
+static const quad_program_t quad_program_4b[] = {
+    {0x00, SFDP_CMD_4B_QUAD_PAGE_PROGRAM_114, kFLEXSPI_1PAD},
+    {0x00, SFDP_CMD_4B_QUAD_PAGE_PROGRAM_144, kFLEXSPI_4PAD},
+};
+
+device_stats_t device_stats;
+
+/* SFDP erase type currently loaded in NOR_CMD_LUT_SEQ_IDX_ERASEBLOCK, 0: none */
+static uint8_t erase_block_type;
+
+/* parts programmed together or devices found, nor_port[0] is the one on port A1 read over SFDP */
+static nor_port_t nor_port[NOR_PORT_NUM];
+static uint8_t nor_port_num;
+
+/* chip select of flash_table[n] or of gang part n */
+static const flexspi_port_t flexspi_ports[] = {kFLEXSPI_PortA1, kFLEXSPI_PortA2, kFLEXSPI_PortB1, kFLEXSPI_PortB2};
+
+#if NOR_MULTI_DEVICE
+/* AHB read sequence of flash_table[n], every device keeps its own */
+static const uint8_t read_seqs[] = {
+    NOR_CMD_LUT_SEQ_IDX_READ_FAST_QUAD,
+    NOR_CMD_LUT_SEQ_IDX_READ_FAST_QUAD_DEV1,
+    NOR_CMD_LUT_SEQ_IDX_READ_FAST_QUAD_DEV2,
+    NOR_CMD_LUT_SEQ_IDX_READ_FAST_QUAD_DEV3,
+};
+#endif
+
+/* IP command sequences that depend on the part, loaded for the device a command goes to */
+static const uint8_t device_seqs[] = {
+    NOR_CMD_LUT_SEQ_IDX_READ_QE_REG,
+    NOR_CMD_LUT_SEQ_IDX_ERASESECTOR,
+    NOR_CMD_LUT_SEQ_IDX_PAGEPROGRAM_SINGLE,
+    NOR_CMD_LUT_SEQ_IDX_PAGEPROGRAM_QUAD,
+    NOR_CMD_LUT_SEQ_IDX_WRITESTATUSREG,
+};
+
+/* device whose sequences are in the LUT */
+static const sfdp_flash *lut_flash;
+
+/* device switched to octal DDR, its sequences are 8D-8D-8D */
+static const sfdp_flash *octal_flash;
+
+/* QE bit of the quad parts after signoff, from the FlashInit arguments */
+static qe_request_t qe_request;
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -39,7 +181,10 @@ const device_t flash_device = {
     .write = write,
     .erase = erase,
     .erase_chip = erase_chip,
-    .signoff = signoff
+    .checksum = checksum,
+    .signoff = signoff,
+    .layout = layout,
+    .buffer_size = buffer_size
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -52,6 +197,17 @@ static uint32_t init(void *base_of_flash)
 {
     uint32_t result = RESULT_OK;
 
+    memset(&device_stats, 0, sizeof(device_stats));
+
+    qe_request = QE_KEEP;
+#if USE_ARGC_ARGV
+    if(FlFindOption("--setQE", 0, argc, argv)) {
+        qe_request = QE_SET;
+    } else if(FlFindOption("--clrQE", 0, argc, argv)) {
+        qe_request = QE_CLEAR;
+    }
+#endif
+
     result = sfdp_init();
     if(result != RESULT_OK) {
         return result;
@@ -59,10 +215,17 @@ static uint32_t init(void *base_of_flash)
 
     flexspi_init();
 
+#if FLEXSPI_PARALLEL_MODE
+    if(nor_port_num != NOR_PORT_NUM) {
+        SFDP_DEBUG("Parallel mode needs the same flash on FlexSPI A1 and B1.");
+        return RESULT_ERROR;
+    }
+#endif
+
     SFDP_DEBUG("Flashloader Init Done.");
 
-    asm("CPSIE I");
-    asm("CPSIE F");
+    __enable_irq();
+    __enable_fault_irq();
     SFDP_DEBUG("All Interrupts has been enabled.");
 
     cm_backtrace_init("SphinxEVK Flashloader", "v1.0", "v0.1");
@@ -73,42 +236,107 @@ static uint32_t init(void *base_of_flash)
 
 #pragma optimize=none
 static uint32_t write(uint32_t addr, uint32_t count, char const *buffer) {
-    extern sfdp_flash flash_table[];
     uint32_t result = RESULT_OK;
     uint32_t index = addr-FlexSPI_AHB_BASE;
 
-    const uint32_t page_size = (1<<flash_table[0].sfdp_table->DWORD11.page_size);
-    //const uint32_t page_size = 256;
-    uint32_t size = page_size-((uint32_t)addr%page_size);
-
     /* Write the Pages that needed */
     while(count)
     {
         //SFDP_DEBUG("from [0x%08lX] write to [0x%08lX]", buffer, index + FlexSPI_AHB_BASE);
 
-        flexspi_nor_Write_Page(FLEXSPI, index, (void*)buffer);
-        if(kStatus_Success != result)
-        {
-            return result;
+        nor_port_t *nor = nor_port_at(index);
+        if(nor == NULL) {
+            SFDP_DEBUG("0x%08lX is outside the flash.", index + FlexSPI_AHB_BASE);
+            return RESULT_ERROR;
+        }
+
+        const uint32_t page_size = page_program_size(nor->flash);
+        //const uint32_t page_size = 256;
+        uint32_t size = page_size-(index%page_size);
+
+        if(size > count) {
+            size = count;
+        }
+
+        /* Erased flash already reads 0xFF, padding needs no program cycle. */
+        if(is_blank(buffer, size)) {
+            device_stats.pages_skipped++;
+        } else {
+#if FLEXSPI_PARALLEL_MODE
+            result = flexspi_parallel_Write_Page(FLEXSPI, index, buffer, size);
+            if(kStatus_Success != result)
+            {
+                return result;
+            }
+#elif NOR_MULTI_DEVICE
+            result = flexspi_nor_Write_Page(FLEXSPI, nor, index - nor->base, (void*)buffer, size);
+            if(kStatus_Success != result)
+            {
+                return result;
+            }
+#else
+            /* round robin, the other parts keep programming while one gets its page */
+            for(uint8_t i = 0; i < nor_port_num; i++) {
+                result = flexspi_nor_Write_Page(FLEXSPI, &nor_port[i], index, (void*)buffer, size);
+                if(kStatus_Success != result)
+                {
+                    return result;
+                }
+            }
+#endif
+            device_stats.pages_programmed++;
         }
 
         count -= size;
         index += size;
         buffer += size;
-        size = page_size;
     }
 
+#if !DEFERRED_WRITE_COMPLETION
+    result = flexspi_nor_Complete(FLEXSPI);
+#endif
+
     return result;
 }
 
-static uint32_t erase(void *block_start) {
-    extern sfdp_flash flash_table[];
+static uint32_t erase(void *block_start, uint32_t size) {
     uint32_t result = RESULT_OK;
-    uint32_t addr = (uint32_t)(block_start);
+    uint32_t addr = (uint32_t)(uintptr_t)(block_start);
+
+    SFDP_DEBUG("Erasing 0x%08lX..0x%08lX", addr, addr + size - 1);
+
+#if NOR_MULTI_DEVICE
+    /* an aggregated range may run from the end of one device into the next one */
+    uint32_t index = addr - FlexSPI_AHB_BASE;
+    uint32_t rest = size;
+
+    while(rest && kStatus_Success == result)
+    {
+        nor_port_t *nor = nor_port_at(index);
+        if(nor == NULL) {
+            result = kStatus_InvalidArgument;
+            break;
+        }
 
-    SFDP_DEBUG("Erasing Sector/Block at 0x%08lX", addr);
+        uint32_t chunk = nor->base + nor->size - index;
+        if(chunk > rest) {
+            chunk = rest;
+        }
 
-    result = flexspi_nor_Erase_Sector(FLEXSPI, addr - FlexSPI_AHB_BASE);
+        result = flexspi_nor_Erase_Range(FLEXSPI, nor, 1, index - nor->base, chunk);
+        index += chunk;
+        rest -= chunk;
+    }
+#else
+    /* in parallel mode every part holds half of the block */
+    result = flexspi_nor_Erase_Range(FLEXSPI, nor_port, nor_port_num, (addr - FlexSPI_AHB_BASE) / NOR_PARALLEL_FACTOR, size / NOR_PARALLEL_FACTOR);
+#endif
+#if !DEFERRED_ERASE_COMPLETION
+    if(kStatus_Success == result)
+    {
+        result = flexspi_nor_Complete(FLEXSPI);
+    }
+#endif
 
     if(kStatus_Success != result)
     {
@@ -126,7 +354,8 @@ static uint32_t erase(void *block_start) {
         }
     }
 
-    SFDP_DEBUG("Erase Sector/Block at 0x%08lX SUCCESS!", addr);
+    SFDP_DEBUG("Erase 0x%08lX..0x%08lX %s!", addr, addr + size - 1,
+               flexspi_nor_Pending() ? "STARTED" : "SUCCESS");
 
     return result;
 }
@@ -146,27 +375,287 @@ static uint32_t erase_chip(void) {
 
     SFDP_DEBUG("Start Chip Erasing..");
 
-    /* Enable Writting. */
-    flexspi_nor_Write_Enable(FLEXSPI);
-
-    /* Erase Chip. */
-    result = FLEXSPI_TransferBlocking(FLEXSPI, &flashXfer);
+    result = flexspi_nor_Complete(FLEXSPI);
     if(kStatus_Success != result)
     {
         return result;
     }
 
-    return flexspi_nor_Wait_Bus_If_Busy(FLEXSPI);
+    /* start the chip erase on every part, then wait for all of them */
+    for(uint8_t i = 0; i < nor_port_num; i++) {
+        flashXfer.deviceAddress = nor_port[i].base;
+        flashXfer.port = nor_port[i].port;
+
+        /* Enable Writting. */
+        flexspi_nor_Write_Enable(FLEXSPI, &nor_port[i]);
+
+        /* Erase Chip. */
+        result = FLEXSPI_TransferBlocking(FLEXSPI, &flashXfer);
+        if(kStatus_Success != result)
+        {
+            return result;
+        }
+
+        nor_port[i].pending_op = FLASH_OP_ERASE;
+        nor_port[i].pending_addr = 0;
+    }
+
+    return flexspi_nor_Complete(FLEXSPI);
+}
+
+static uint32_t checksum(void const *begin, uint32_t count) {
+    const uint32_t sdr_div = CLOCK_GetDiv(kCLOCK_FlexspiDiv);
+    bool dtr = (nor_port_num != 0);
+    bool continuous = (nor_port_num != 0);
+    uint32_t sum;
+    status_t complete;
+
+    /* the flash does not answer reads while it programs */
+    complete = flexspi_nor_Complete(FLEXSPI);
+
+    for(uint8_t i = 0; i < nor_port_num; i++) {
+        dtr = dtr && nor_port[i].read_dtr;
+        continuous = continuous && nor_port[i].read_continuous;
+    }
+
+    if(continuous) {
+        /* the software reset below starts the first burst at the opcode */
+        for(uint8_t i = 0; i < nor_port_num; i++) {
+            uint32_t seq_lut[4];
+
+            flexspi_continuous_seq(nor_port[i].flash, seq_lut);
+            flexspi_update_lut_seq(nor_port[i].read_seq, seq_lut);
+        }
+    }
+
+    if(dtr) {
+        /* DDR runs SCK at half the root clock, half the divider keeps it at or below the SDR SCK */
+        flexspi_set_clock(sdr_div / 2U, (flexspi_read_sample_clock_t)FLEXSPI_RX_SAMPLE_CLOCK);
+    } else {
+        /* AHB RX buffers may still hold data prefetched before programming */
+        FLEXSPI_SoftwareReset(FLEXSPI);
+    }
+
+    sum = checksum_window(begin, count);
+
+    if(dtr) {
+        /* program and erase commands are SDR, their SCK must not exceed the part's */
+        flexspi_set_clock(sdr_div, (flexspi_read_sample_clock_t)FLEXSPI_RX_SAMPLE_CLOCK);
+    }
+
+    /* a part left in continuous read would take the next opcode as an address */
+    if(continuous && kStatus_Success != flexspi_nor_Exit_Continuous(FLEXSPI)) {
+        sum = (uint16_t)~sum;
+    } else if(kStatus_Success != complete) {
+        /* the window was read from a part still busy, make C-SPY's verify fail */
+        SFDP_DEBUG("Checksum error. Code: %4X(%4d)", complete, complete);
+        sum = (uint16_t)~sum;
+    }
+
+    return sum;
+}
+
+/**
+ * CRC of the image read back through the AHB window with the fast read LUT.
+ */
+static uint32_t checksum_window(void const *begin, uint32_t count) {
+#if (FLEXSPI_GANG_PORT_NUM == 1)
+    /* one window: the devices follow each other, a parallel array interleaves its parts */
+    return Crc16((uint8_t const *)begin, count);
+#else
+    uint16_t sum = 0;
+
+    /* every part of the gang must hold the image, make C-SPY's verify fail otherwise */
+    for(uint8_t i = 0; i < nor_port_num; i++) {
+        uint16_t port_sum = Crc16((uint8_t const *)begin + nor_port[i].base, count);
+
+        if(i == 0) {
+            sum = port_sum;
+        } else if(port_sum != sum) {
+            SFDP_DEBUG("Checksum mismatch on gang part %d.", i);
+            return (uint16_t)~sum;
+        }
+    }
+
+    return sum;
+#endif
 }
 
 static uint32_t signoff(void) {
+    uint32_t result = flexspi_nor_Complete(FLEXSPI);
+
+    /* --setQE keeps QE set for quad boot reads, --clrQE clears it, otherwise it is left as found */
+    for(uint8_t i = 0; i < nor_port_num; i++) {
+        nor_port_t *nor = &nor_port[i];
+        bool volatile_write = false;
+
+        if(qe_request == QE_KEEP && nor->qe_set_by_init) {
+            /* an unreadable volatile QE may have been set before, the next reset restores it */
+            if(nor->qe_volatile && !flexspi_qe_readable(nor->flash)) {
+                continue;
+            }
+            volatile_write = nor->qe_volatile;
+        } else if(qe_request != QE_CLEAR) {
+            continue;
+        }
+        if(flexspi_qe_readable(nor->flash) && !flexspi_nor_Quad_Enabled(FLEXSPI, nor)) {
+            continue;
+        }
+        if(kStatus_Success == flexspi_nor_Write_QE(FLEXSPI, nor, false, volatile_write)) {
+            SFDP_DEBUG("FlexSPI port %d: QE cleared.", nor->port);
+        } else {
+            SFDP_DEBUG("FlexSPI port %d: QE could not be cleared.", nor->port);
+        }
+    }
+
+#if FLEXSPI_OCTAL_DDR
+    /* back to 1S-1S-1S, the next session reads SFDP in 1S-1S-1S */
+    flexspi_octal_exit(FLEXSPI, &nor_port[0]);
+#endif
+
     SFDP_DEBUG("Complete! Flashloader signing off..");
+    SFDP_DEBUG("%d pages programmed, %d blank pages skipped.", device_stats.pages_programmed, device_stats.pages_skipped);
     SFDP_DEBUG("Deinit FLEXSPI, LPUART1 Done.");
+    SFDP_LOG_FLUSH();
 
     FLEXSPI_Deinit(FLEXSPI);
     LPUART_Deinit(LPUART1);
 
-    return RESULT_OK;
+    return result;
+}
+
+/**
+ * Describe the real chip to C-SPY instead of the static .flash layout.
+ * The first largest-type block is split into smallest-type blocks so the
+ * boot headers (FCB, IVT) at the flash base keep a fine erase granularity,
+ * the rest of the chip is laid out in largest-type blocks.
+ */
+static uint32_t layout(char *layout, uint32_t *page_size) {
+    char *end = layout;
+    uint32_t page = 0;
+    uint32_t flags = OVERRIDE_LAYOUT | OVERRIDE_PAGESIZE;
+
+    /* the windows of the devices follow each other, a gang or parallel array has one */
+    for(uint8_t i = 0; i < (NOR_MULTI_DEVICE ? nor_port_num : 1); i++) {
+        const sfdp_flash *flash = nor_port[i].flash;
+
+        if(flags & OVERRIDE_LAYOUT) {
+            if(end != layout) {
+                *end++ = ' ';
+            }
+            end = layout_device(end, flash);
+            if(end == NULL) {
+                flags &= ~OVERRIDE_LAYOUT;
+            }
+        }
+
+        /* C-SPY pads to one page size, the smallest one suits every device */
+        if(flash->sfdp_header.len < 11) {
+            flags &= ~OVERRIDE_PAGESIZE;
+        } else if(page == 0 || page_program_size(flash) < page) {
+            page = page_program_size(flash);
+        }
+    }
+    if(flags & OVERRIDE_LAYOUT) {
+        SFDP_DEBUG("Flash layout: %s", layout);
+    }
+
+    if(flags & OVERRIDE_PAGESIZE) {
+        *page_size = page;
+    }
+
+    return flags;
+}
+
+/**
+ * Append the blocks of one device to the layout string, NULL if SFDP
+ * describes no erase type for it.
+ */
+static char *layout_device(char *layout, const sfdp_flash *flash) {
+    const sfdp_para *sfdp = &flash->sfdp;
+    /* a parallel array erases the same block on both parts */
+    uint32_t capacity = flexspi_flash_size(flash) * 1024U * NOR_PARALLEL_FACTOR;
+    uint32_t smallest = sfdp->eraser[SMALLEST_ERASER_INDEX].size * NOR_PARALLEL_FACTOR;
+    uint32_t largest = smallest;
+
+    for(uint8_t i = SMALLEST_ERASER_INDEX + 1; i < SFDP_SFDP_ERASE_TYPE_MAX_NUM; i++) {
+        if(flexspi_erase_cmd(flash, i) != 0 && sfdp->eraser[i].size * NOR_PARALLEL_FACTOR > largest) {
+            largest = sfdp->eraser[i].size * NOR_PARALLEL_FACTOR;
+        }
+    }
+
+    if(smallest == 0 || capacity < smallest) {
+        return NULL;
+    }
+
+    /* hybrid parts: each sector map region in blocks of its own smallest erase type */
+    if(sfdp->region_num != 0) {
+        char *end = layout;
+        uint32_t address = 0, block = 0, count = 0;
+
+        while(address < capacity / NOR_PARALLEL_FACTOR) {
+            uint32_t region_end;
+            uint8_t types = flexspi_erase_types(flash, address, &region_end);
+            uint8_t type;
+
+            if(types == 0) {
+                return NULL;
+            }
+            for(type = SMALLEST_ERASER_INDEX; !(types & (1U << type)); type++);
+            if(region_end > capacity / NOR_PARALLEL_FACTOR) {
+                region_end = capacity / NOR_PARALLEL_FACTOR;
+            }
+
+            if(count != 0 && sfdp->eraser[type].size != block) {
+                end += sprintf(end, "%s%lu 0x%lX", end == layout ? "" : " ", (unsigned long)count,
+                               (unsigned long)(block * NOR_PARALLEL_FACTOR));
+                count = 0;
+            }
+            block = sfdp->eraser[type].size;
+            count += (region_end - address) / block;
+            address = region_end;
+        }
+
+        return end + sprintf(end, "%s%lu 0x%lX", end == layout ? "" : " ", (unsigned long)count,
+                             (unsigned long)(block * NOR_PARALLEL_FACTOR));
+    }
+
+    if(largest == smallest || capacity < 2 * largest) {
+        return layout + sprintf(layout, "%lu 0x%lX", (unsigned long)(capacity / smallest), (unsigned long)smallest);
+    }
+
+    return layout + sprintf(layout, "%lu 0x%lX %lu 0x%lX", (unsigned long)(largest / smallest), (unsigned long)smallest,
+                            (unsigned long)(capacity / largest - 1), (unsigned long)largest);
+}
+
+/**
+ * The .icf links the RAM buffer over the largest OCRAM the part can have,
+ * clip it to the FlexRAM banks that are really configured as OCRAM.
+ */
+static uint32_t buffer_size(uint32_t start, uint32_t size) {
+    uint32_t bank_cfg = FLEXRAM_DEFAULT_BANK_CFG;
+    uint32_t ocram_end = OCRAM_BASE;
+
+    if(IOMUXC_GPR->GPR16 & IOMUXC_GPR_GPR16_FLEXRAM_BANK_CFG_SEL_MASK) {
+        bank_cfg = IOMUXC_GPR->GPR17;
+    }
+
+    for(uint8_t i = 0; i < FLEXRAM_BANK_NUM; i++) {
+        if(((bank_cfg >> (2 * i)) & 0x3) == FLEXRAM_BANK_OCRAM) {
+            ocram_end += FLEXRAM_BANK_SIZE;
+        }
+    }
+
+    if(start >= ocram_end) {
+        return 0;
+    }
+    if(size > ocram_end - start) {
+        size = ocram_end - start;
+    }
+
+    SFDP_DEBUG("RAM buffer: %d bytes at 0x%08lX.", size, start);
+
+    return size;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -205,11 +694,126 @@ static void flexspi_set_iomux(void) {
     IOMUXC_SetPinConfig(IOMUXC_GPIO_SD_B1_10_FLEXSPI_A_DATA01, 0x10F1);
     IOMUXC_SetPinConfig(IOMUXC_GPIO_SD_B1_11_FLEXSPI_A_SS0_B,  0x10F1);
 
+#endif
+
+#if ((NOR_PORT_NUM > 1 && !NOR_MULTI_DEVICE) || FLEXSPI_OCTAL_DDR) && defined(CPU_MIMXRT1021)
+
+    /* gang fixture or parallel array: port A2 chip select, port B bus with B1/B2 chip selects.
+       More devices mux these pads per chip select in flexspi_probe_iomux().
+       An octal part takes the port B data pads as its DATA4..7. */
+    IOMUXC_SetPinMux(IOMUXC_GPIO_SD_B0_00_FLEXSPI_A_SS1_B,  1U);
+    IOMUXC_SetPinMux(IOMUXC_GPIO_SD_B1_00_FLEXSPI_B_DATA03, 1U);
+    IOMUXC_SetPinMux(IOMUXC_GPIO_SD_B1_01_FLEXSPI_B_SCLK,   1U);
+    IOMUXC_SetPinMux(IOMUXC_GPIO_SD_B1_02_FLEXSPI_B_DATA00, 1U);
+    IOMUXC_SetPinMux(IOMUXC_GPIO_SD_B1_03_FLEXSPI_B_DATA02, 1U);
+    IOMUXC_SetPinMux(IOMUXC_GPIO_SD_B1_04_FLEXSPI_B_DATA01, 1U);
+    IOMUXC_SetPinMux(IOMUXC_GPIO_SD_B1_05_FLEXSPI_B_SS0_B,  1U);
+    IOMUXC_SetPinMux(IOMUXC_GPIO_SD_B0_01_FLEXSPI_B_SS1_B,  1U);
+
+    IOMUXC_SetPinConfig(IOMUXC_GPIO_SD_B0_00_FLEXSPI_A_SS1_B,  0x10F1);
+    IOMUXC_SetPinConfig(IOMUXC_GPIO_SD_B1_00_FLEXSPI_B_DATA03, 0x10F1);
+    IOMUXC_SetPinConfig(IOMUXC_GPIO_SD_B1_01_FLEXSPI_B_SCLK,   0x10F1);
+    IOMUXC_SetPinConfig(IOMUXC_GPIO_SD_B1_02_FLEXSPI_B_DATA00, 0x10F1);
+    IOMUXC_SetPinConfig(IOMUXC_GPIO_SD_B1_03_FLEXSPI_B_DATA02, 0x10F1);
+    IOMUXC_SetPinConfig(IOMUXC_GPIO_SD_B1_04_FLEXSPI_B_DATA01, 0x10F1);
+    IOMUXC_SetPinConfig(IOMUXC_GPIO_SD_B1_05_FLEXSPI_B_SS0_B,  0x10F1);
+    IOMUXC_SetPinConfig(IOMUXC_GPIO_SD_B0_01_FLEXSPI_B_SS1_B,  0x10F1);
+
+#elif (NOR_PORT_NUM > 1 && !NOR_MULTI_DEVICE) || FLEXSPI_OCTAL_DDR
+
+    /* gang fixture or parallel array: port A2 chip select, port B bus with B1/B2 chip selects.
+       More devices mux these pads per chip select in flexspi_probe_iomux().
+       An octal part takes the port B data pads as its DATA4..7. */
+    IOMUXC_SetPinMux(IOMUXC_GPIO_SD_B0_00_FLEXSPIA_SS1_B,  1U);
+    IOMUXC_SetPinMux(IOMUXC_GPIO_SD_B1_00_FLEXSPIB_DATA03, 1U);
+    IOMUXC_SetPinMux(IOMUXC_GPIO_SD_B1_01_FLEXSPIB_DATA02, 1U);
+    IOMUXC_SetPinMux(IOMUXC_GPIO_SD_B1_02_FLEXSPIB_DATA01, 1U);
+    IOMUXC_SetPinMux(IOMUXC_GPIO_SD_B1_03_FLEXSPIB_DATA00, 1U);
+    IOMUXC_SetPinMux(IOMUXC_GPIO_SD_B1_04_FLEXSPIB_SCLK,   1U);
+    IOMUXC_SetPinMux(IOMUXC_GPIO_SD_B1_05_FLEXSPIB_SS0_B,  1U);
+    IOMUXC_SetPinMux(IOMUXC_GPIO_SD_B0_01_FLEXSPIB_SS1_B,  1U);
+
+    IOMUXC_SetPinConfig(IOMUXC_GPIO_SD_B0_00_FLEXSPIA_SS1_B,  0x10F1);
+    IOMUXC_SetPinConfig(IOMUXC_GPIO_SD_B1_00_FLEXSPIB_DATA03, 0x10F1);
+    IOMUXC_SetPinConfig(IOMUXC_GPIO_SD_B1_01_FLEXSPIB_DATA02, 0x10F1);
+    IOMUXC_SetPinConfig(IOMUXC_GPIO_SD_B1_02_FLEXSPIB_DATA01, 0x10F1);
+    IOMUXC_SetPinConfig(IOMUXC_GPIO_SD_B1_03_FLEXSPIB_DATA00, 0x10F1);
+    IOMUXC_SetPinConfig(IOMUXC_GPIO_SD_B1_04_FLEXSPIB_SCLK,   0x10F1);
+    IOMUXC_SetPinConfig(IOMUXC_GPIO_SD_B1_05_FLEXSPIB_SS0_B,  0x10F1);
+    IOMUXC_SetPinConfig(IOMUXC_GPIO_SD_B0_01_FLEXSPIB_SS1_B,  0x10F1);
+
+#endif
+
+#if (FLEXSPI_RX_SAMPLE_CLOCK != 0) && defined(CPU_MIMXRT1021)
+
+    /* port A read strobe instead of the port B1 chip select, SION loops SCK back or takes the flash DQS */
+    IOMUXC_SetPinMux(IOMUXC_GPIO_SD_B1_05_FLEXSPI_A_DQS,    1U);
+    IOMUXC_SetPinConfig(IOMUXC_GPIO_SD_B1_05_FLEXSPI_A_DQS, 0x10F1);
+
+#elif (FLEXSPI_RX_SAMPLE_CLOCK != 0)
+
+    /* port A read strobe instead of the port B1 chip select, SION loops SCK back or takes the flash DQS */
+    IOMUXC_SetPinMux(IOMUXC_GPIO_SD_B1_05_FLEXSPIA_DQS,     1U);
+    IOMUXC_SetPinConfig(IOMUXC_GPIO_SD_B1_05_FLEXSPIA_DQS,  0x10F1);
+
 #endif
 
     SFDP_DEBUG("Set FlexSPI IOMUX Done.");
 }
 
+#if NOR_PROBE_IOMUX
+/* FlexSPI function for a probe, GPIO with its reset pad settings when nothing answers */
+#define FLEXSPI_PROBE_PAD(flexspi_pad, gpio_pad, flexspi)       \
+    do {                                                        \
+        if(flexspi) {                                           \
+            IOMUXC_SetPinMux(flexspi_pad, 1U);                  \
+            IOMUXC_SetPinConfig(flexspi_pad, 0x10F1);           \
+        } else {                                                \
+            IOMUXC_SetPinMux(gpio_pad, 0U);                     \
+            IOMUXC_SetPinConfig(gpio_pad, 0x10B0);              \
+        }                                                       \
+    } while(0)
+
+/**
+ * Hand the chip select pad of port A2, B1 or B2 to FlexSPI for its SFDP probe,
+ * or back to GPIO when no flash answers there. With bus set the port B bus
+ * pads follow, port A1 leaves the chip selects alone.
+ */
+static void flexspi_probe_iomux(flexspi_port_t port, bool bus, bool flexspi) {
+#if defined(CPU_MIMXRT1021)
+    if(port == kFLEXSPI_PortA2) {
+        FLEXSPI_PROBE_PAD(IOMUXC_GPIO_SD_B0_00_FLEXSPI_A_SS1_B, IOMUXC_GPIO_SD_B0_00_GPIO3_IO13, flexspi);
+    } else if(port == kFLEXSPI_PortB1) {
+        FLEXSPI_PROBE_PAD(IOMUXC_GPIO_SD_B1_05_FLEXSPI_B_SS0_B, IOMUXC_GPIO_SD_B1_05_GPIO3_IO25, flexspi);
+    } else if(port == kFLEXSPI_PortB2) {
+        FLEXSPI_PROBE_PAD(IOMUXC_GPIO_SD_B0_01_FLEXSPI_B_SS1_B, IOMUXC_GPIO_SD_B0_01_GPIO3_IO14, flexspi);
+    }
+    if(bus) {
+        FLEXSPI_PROBE_PAD(IOMUXC_GPIO_SD_B1_00_FLEXSPI_B_DATA03, IOMUXC_GPIO_SD_B1_00_GPIO3_IO20, flexspi);
+        FLEXSPI_PROBE_PAD(IOMUXC_GPIO_SD_B1_01_FLEXSPI_B_SCLK,   IOMUXC_GPIO_SD_B1_01_GPIO3_IO21, flexspi);
+        FLEXSPI_PROBE_PAD(IOMUXC_GPIO_SD_B1_02_FLEXSPI_B_DATA00, IOMUXC_GPIO_SD_B1_02_GPIO3_IO22, flexspi);
+        FLEXSPI_PROBE_PAD(IOMUXC_GPIO_SD_B1_03_FLEXSPI_B_DATA02, IOMUXC_GPIO_SD_B1_03_GPIO3_IO23, flexspi);
+        FLEXSPI_PROBE_PAD(IOMUXC_GPIO_SD_B1_04_FLEXSPI_B_DATA01, IOMUXC_GPIO_SD_B1_04_GPIO3_IO24, flexspi);
+    }
+#else
+    if(port == kFLEXSPI_PortA2) {
+        FLEXSPI_PROBE_PAD(IOMUXC_GPIO_SD_B0_00_FLEXSPIA_SS1_B, IOMUXC_GPIO_SD_B0_00_GPIO3_IO12, flexspi);
+    } else if(port == kFLEXSPI_PortB1) {
+        FLEXSPI_PROBE_PAD(IOMUXC_GPIO_SD_B1_05_FLEXSPIB_SS0_B, IOMUXC_GPIO_SD_B1_05_GPIO3_IO05, flexspi);
+    } else if(port == kFLEXSPI_PortB2) {
+        FLEXSPI_PROBE_PAD(IOMUXC_GPIO_SD_B0_01_FLEXSPIB_SS1_B, IOMUXC_GPIO_SD_B0_01_GPIO3_IO13, flexspi);
+    }
+    if(bus) {
+        FLEXSPI_PROBE_PAD(IOMUXC_GPIO_SD_B1_00_FLEXSPIB_DATA03, IOMUXC_GPIO_SD_B1_00_GPIO3_IO00, flexspi);
+        FLEXSPI_PROBE_PAD(IOMUXC_GPIO_SD_B1_01_FLEXSPIB_DATA02, IOMUXC_GPIO_SD_B1_01_GPIO3_IO01, flexspi);
+        FLEXSPI_PROBE_PAD(IOMUXC_GPIO_SD_B1_02_FLEXSPIB_DATA01, IOMUXC_GPIO_SD_B1_02_GPIO3_IO02, flexspi);
+        FLEXSPI_PROBE_PAD(IOMUXC_GPIO_SD_B1_03_FLEXSPIB_DATA00, IOMUXC_GPIO_SD_B1_03_GPIO3_IO03, flexspi);
+        FLEXSPI_PROBE_PAD(IOMUXC_GPIO_SD_B1_04_FLEXSPIB_SCLK,   IOMUXC_GPIO_SD_B1_04_GPIO3_IO04, flexspi);
+    }
+#endif
+}
+#endif
+
 static void flexspi_set_lut(void) {
     extern sfdp_flash flash_table[];
     uint32_t flash_lut[] =  {
@@ -229,123 +833,1165 @@ static void flexspi_set_lut(void) {
         [4*NOR_CMD_LUT_SEQ_IDX_ERASECHIP]	=
             FLEXSPI_LUT_SEQ(kFLEXSPI_Command_SDR, kFLEXSPI_1PAD, 0xC7, kFLEXSPI_Command_STOP, kFLEXSPI_1PAD, 0),
 
-        /* Page Program - single mode */
-        [4*NOR_CMD_LUT_SEQ_IDX_PAGEPROGRAM_SINGLE] =
-            FLEXSPI_LUT_SEQ(kFLEXSPI_Command_SDR, kFLEXSPI_1PAD, 0x02, kFLEXSPI_Command_RADDR_SDR, kFLEXSPI_1PAD, (flash_table[0].addr_in_4_byte==true)?32:24),
-        [4*NOR_CMD_LUT_SEQ_IDX_PAGEPROGRAM_SINGLE+1] =
-            FLEXSPI_LUT_SEQ(kFLEXSPI_Command_WRITE_SDR, kFLEXSPI_1PAD, 0x04, kFLEXSPI_Command_STOP, kFLEXSPI_1PAD, 0),
-
-        /* Write result-1 register */
-        [4*NOR_CMD_LUT_SEQ_IDX_WRITESTATUSREG] =
-            FLEXSPI_LUT_SEQ(kFLEXSPI_Command_SDR, kFLEXSPI_1PAD, 0x01, kFLEXSPI_Command_WRITE_SDR, kFLEXSPI_1PAD, FLEXSPI_INSTRUCTION_OPERAND_ANY_NONE_ZERO_VALUE),
-
         /* Read result register */
         [4*NOR_CMD_LUT_SEQ_IDX_READSTATUSREG] =
             FLEXSPI_LUT_SEQ(kFLEXSPI_Command_SDR, kFLEXSPI_1PAD, 0x05, kFLEXSPI_Command_READ_SDR, kFLEXSPI_1PAD, FLEXSPI_INSTRUCTION_OPERAND_ANY_NONE_ZERO_VALUE),
 
+        /* Read SFDP */
+        [4*NOR_CMD_LUT_SEQ_IDX_READ_SFDP] =
+            FLEXSPI_LUT_SEQ(kFLEXSPI_Command_SDR, kFLEXSPI_1PAD, SFDP_CMD_READ_SFDP_REGISTER, kFLEXSPI_Command_RADDR_SDR, kFLEXSPI_1PAD, 24),
+        [4*NOR_CMD_LUT_SEQ_IDX_READ_SFDP + 1] =
+            FLEXSPI_LUT_SEQ(kFLEXSPI_Command_DUMMY_SDR, kFLEXSPI_1PAD, 8, kFLEXSPI_Command_READ_SDR, kFLEXSPI_1PAD, FLEXSPI_INSTRUCTION_OPERAND_ANY_NONE_ZERO_VALUE),
+
         /* Write Enable for volatile register */
         [4*NOR_CMD_LUT_SEQ_IDX_WRITE_ENABLE_VOLATILE] =
             FLEXSPI_LUT_SEQ(kFLEXSPI_Command_SDR, kFLEXSPI_1PAD, 0x50, kFLEXSPI_Command_STOP, kFLEXSPI_1PAD, 0),
     };
 
-    /* SFDP instructions rely on device SFDP parameter table */
-
-    /* Fast read quad mode - SDR */
-    flash_lut[4*NOR_CMD_LUT_SEQ_IDX_READ_FAST_QUAD] =
-        FLEXSPI_LUT_SEQ(kFLEXSPI_Command_SDR, kFLEXSPI_1PAD, flash_table[0].sfdp_table->DWORD3.fastread_114_cmd, kFLEXSPI_Command_RADDR_SDR, kFLEXSPI_1PAD, (flash_table[0].addr_in_4_byte==true)?32:24);
-    flash_lut[4*NOR_CMD_LUT_SEQ_IDX_READ_FAST_QUAD+1] =
-        FLEXSPI_LUT_SEQ(kFLEXSPI_Command_DUMMY_SDR, kFLEXSPI_4PAD, flash_table[0].sfdp_table->DWORD3.dummy_clocks_before_114_output, kFLEXSPI_Command_READ_SDR, kFLEXSPI_4PAD, FLEXSPI_INSTRUCTION_OPERAND_ANY_NONE_ZERO_VALUE);
-
-    /* Erase Sector  */
-    flash_lut[4*NOR_CMD_LUT_SEQ_IDX_ERASESECTOR] =
-        FLEXSPI_LUT_SEQ(kFLEXSPI_Command_SDR, kFLEXSPI_1PAD, flash_table[0].sfdp_table->DWORD1.erase_4k_cmd, kFLEXSPI_Command_RADDR_SDR, kFLEXSPI_1PAD, (flash_table[0].addr_in_4_byte==true)?32:24);
-
-    if(&flash_table[0].sfdp_table == 0) {
+    if(flash_table[0].sfdp_table == NULL) {
         SFDP_DEBUG("Failed to get SFDP parameter table.");
         return;
     }
 
+    /* SFDP instructions rely on device SFDP parameter table, flash_table[0] is loaded first */
+    flexspi_device_seq(&flash_table[0], NOR_CMD_LUT_SEQ_IDX_READ_FAST_QUAD, &flash_lut[4*NOR_CMD_LUT_SEQ_IDX_READ_FAST_QUAD]);
+    for(uint8_t i = 0; i < sizeof(device_seqs)/sizeof(device_seqs[0]); i++) {
+        flexspi_device_seq(&flash_table[0], device_seqs[i], &flash_lut[4*device_seqs[i]]);
+    }
+    lut_flash = &flash_table[0];
+    erase_block_type = 0;
+
     FLEXSPI_UpdateLUT(FLEXSPI, 0, flash_lut, sizeof(flash_lut)/sizeof(uint32_t));
     SFDP_DEBUG("Update FlexSPI LUT Done.");
 }
 
-static void flexspi_init(void) {
-    extern sfdp_flash flash_table[];
+/**
+ * Build the LUT words of one sequence that depends on the part.
+ */
+static void flexspi_device_seq(const sfdp_flash *flash, uint32_t seq, uint32_t *seq_lut) {
+    const uint8_t addr_bits = flexspi_addr_bits(flash);
+    const bool addr_4b = flexspi_addr_4b(flash);
+    const quad_program_t *quad_program;
 
-    flexspi_config_t config =
-    {
-        .rxSampleClock = kFLEXSPI_ReadSampleClkLoopbackInternally,
-    	.enableSckFreeRunning = false,
-    	.enableCombination = false,
-    	.enableDoze = true,
-    	.enableHalfSpeedAccess = false,
-    	.enableSckBDiffOpt = false,
-    	.enableSameConfigForAll = false,
-    	.seqTimeoutCycle = 0xFFFFU,
-    	.ipGrantTimeoutCycle = 0xFFU,
-    	.txWatermark = 8,
-    	.rxWatermark = 8,
-    	.ahbConfig.enableAHBWriteIpTxFifo = false,
-    	.ahbConfig.enableAHBWriteIpRxFifo = false,
-    	.ahbConfig.ahbGrantTimeoutCycle = 0xFFU,
-    	.ahbConfig.ahbBusTimeoutCycle = 0xFFFFU,
-    	.ahbConfig.resumeWaitCycle = 0x20U,
-        .ahbConfig.buffer = {0, 0, 0, 0},
-    	.ahbConfig.enableClearAHBBufferOpt = false,
-    	.ahbConfig.enableAHBPrefetch = false,
-    	.ahbConfig.enableAHBBufferable = false,
-    	.ahbConfig.enableAHBCachable = false,
-    };
+    memset(seq_lut, 0, 4*sizeof(uint32_t));
 
-    flexspi_device_config_t flash_config = {
-        .flexspiRootClk = CLOCK_GetFreq(kCLOCK_Usb1PllPfd0Clk)/(CLOCK_GetDiv(kCLOCK_FlexspiDiv) + 1U),
-        .flashSize = (flash_table[0].sfdp_table->DWORD2.flash_density>>31U)==0U?((flash_table[0].sfdp_table->DWORD2.flash_density+1)/(8*1024)):(1U<<(flash_table[0].sfdp_table->DWORD2.flash_density&0x7FFFFFFF))/(8*1024),
-        .CSIntervalUnit = kFLEXSPI_CsIntervalUnit1SckCycle,
-        .CSInterval = 2,
-        .CSHoldTime = 3,
-        .CSSetupTime = 3,
-        .dataValidTime = 0,
-        .columnspace = 0,
-        .enableWordAddress = 0,
-        .AWRSeqIndex = 0,
-        .AWRSeqNumber = 0,
-        .ARDSeqIndex = NOR_CMD_LUT_SEQ_IDX_READ_FAST_QUAD, //NOR_CMD_LUT_SEQ_IDX_READ_NORMAL,
-        .ARDSeqNumber = 1,
-        .AHBWriteWaitUnit = kFLEXSPI_AhbWriteWaitUnit2AhbCycle,
-        .AHBWriteWaitInterval = 0,
-    };
+    if(flexspi_octal(flash)) {
+        flexspi_octal_seq(flash, seq, seq_lut);
+        return;
+    }
 
-    /* DeInit LPSPI2 */
-    LPSPI_Deinit(LPSPI2);
+    switch(seq) {
+        /* Fast read quad mode - SDR */
+        case NOR_CMD_LUT_SEQ_IDX_READ_FAST_QUAD:
+        case NOR_CMD_LUT_SEQ_IDX_READ_FAST_QUAD_DEV1:
+        case NOR_CMD_LUT_SEQ_IDX_READ_FAST_QUAD_DEV2:
+        case NOR_CMD_LUT_SEQ_IDX_READ_FAST_QUAD_DEV3:
+            flexspi_read_seq(flash, true, seq_lut);
+            break;
+
+        /* Erase Sector, the smallest SFDP erase type. Larger types are loaded into ERASEBLOCK on demand. */
+        case NOR_CMD_LUT_SEQ_IDX_ERASESECTOR:
+            flexspi_erase_seq(flash, SMALLEST_ERASER_INDEX, seq_lut);
+            break;
+
+        /* Read the status register holding QE, located by the SFDP quad enable requirements */
+        case NOR_CMD_LUT_SEQ_IDX_READ_QE_REG:
+            switch(flash->sfdp_table->DWORD15.quad_enable_requirements) {
+                case 2:
+                    seq_lut[0] = FLEXSPI_LUT_SEQ(kFLEXSPI_Command_SDR, kFLEXSPI_1PAD, 0x05, kFLEXSPI_Command_READ_SDR, kFLEXSPI_1PAD, FLEXSPI_INSTRUCTION_OPERAND_ANY_NONE_ZERO_VALUE);
+                    break;
+                case 3:
+                    seq_lut[0] = FLEXSPI_LUT_SEQ(kFLEXSPI_Command_SDR, kFLEXSPI_1PAD, 0x3F, kFLEXSPI_Command_READ_SDR, kFLEXSPI_1PAD, FLEXSPI_INSTRUCTION_OPERAND_ANY_NONE_ZERO_VALUE);
+                    break;
+                default:
+                    seq_lut[0] = FLEXSPI_LUT_SEQ(kFLEXSPI_Command_SDR, kFLEXSPI_1PAD, 0x35, kFLEXSPI_Command_READ_SDR, kFLEXSPI_1PAD, FLEXSPI_INSTRUCTION_OPERAND_ANY_NONE_ZERO_VALUE);
+                    break;
+            }
+            break;
+
+        /* Write the status register holding QE, SR1 by 01h may carry SR2 as a second byte */
+        case NOR_CMD_LUT_SEQ_IDX_WRITESTATUSREG:
+            switch(flash->sfdp_table->DWORD15.quad_enable_requirements) {
+                case 3:
+                    seq_lut[0] = FLEXSPI_LUT_SEQ(kFLEXSPI_Command_SDR, kFLEXSPI_1PAD, 0x3E, kFLEXSPI_Command_WRITE_SDR, kFLEXSPI_1PAD, FLEXSPI_INSTRUCTION_OPERAND_ANY_NONE_ZERO_VALUE);
+                    break;
+                case 6:
+                    seq_lut[0] = FLEXSPI_LUT_SEQ(kFLEXSPI_Command_SDR, kFLEXSPI_1PAD, 0x31, kFLEXSPI_Command_WRITE_SDR, kFLEXSPI_1PAD, FLEXSPI_INSTRUCTION_OPERAND_ANY_NONE_ZERO_VALUE);
+                    break;
+                default:
+                    seq_lut[0] = FLEXSPI_LUT_SEQ(kFLEXSPI_Command_SDR, kFLEXSPI_1PAD, SFDP_CMD_WRITE_STATUS_REGISTER, kFLEXSPI_Command_WRITE_SDR, kFLEXSPI_1PAD, FLEXSPI_INSTRUCTION_OPERAND_ANY_NONE_ZERO_VALUE);
+                    break;
+            }
+            break;
 
-    /* Set FLEXSPI IOMUX. */
-    flexspi_set_iomux();
+        /* Page Program - single mode */
+        case NOR_CMD_LUT_SEQ_IDX_PAGEPROGRAM_SINGLE:
+            seq_lut[0] = FLEXSPI_LUT_SEQ(kFLEXSPI_Command_SDR, kFLEXSPI_1PAD, addr_4b ? SFDP_CMD_4B_PAGE_PROGRAM : SFDP_CMD_PAGE_PROGRAM, kFLEXSPI_Command_RADDR_SDR, kFLEXSPI_1PAD, addr_bits);
+            seq_lut[1] = FLEXSPI_LUT_SEQ(kFLEXSPI_Command_WRITE_SDR, kFLEXSPI_1PAD, 0x04, kFLEXSPI_Command_STOP, kFLEXSPI_1PAD, 0);
+            break;
+
+        /* Page Program - quad mode, 1-1-4 or 1-4-4 depending on vendor */
+        case NOR_CMD_LUT_SEQ_IDX_PAGEPROGRAM_QUAD:
+            quad_program = quad_program_lookup(flash);
+            if(quad_program != NULL) {
+                seq_lut[0] = FLEXSPI_LUT_SEQ(kFLEXSPI_Command_SDR, kFLEXSPI_1PAD, quad_program->cmd, kFLEXSPI_Command_RADDR_SDR, quad_program->addr_pads, addr_bits);
+                seq_lut[1] = FLEXSPI_LUT_SEQ(kFLEXSPI_Command_WRITE_SDR, kFLEXSPI_4PAD, 0x04, kFLEXSPI_Command_STOP, kFLEXSPI_1PAD, 0);
+            }
+            break;
+    }
+}
 
-    /* Set AHB buffer size for reading data through AHB bus. */
-    FLEXSPI_Init(FLEXSPI, &config);
+/**
+ * Build the AHB read sequence: 1-4-4 DTR read when enabled, 1-1-4 fast read,
+ * or 1-1-1 fast read for parts without 1-1-4 or whose QE bit cannot be set.
+ */
+static void flexspi_read_seq(const sfdp_flash *flash, bool quad, uint32_t *seq_lut) {
+    const uint8_t addr_bits = flexspi_addr_bits(flash);
+    const bool addr_4b = flexspi_addr_4b(flash);
+
+    memset(seq_lut, 0, 4*sizeof(uint32_t));
+
+    if(quad && flexspi_read_dtr(flash)) {
+        /* mode byte FFh keeps the part out of continuous read, DDR dummy operands count half clocks */
+        const uint16_t instr[] = {
+            FLEXSPI_LUT_INSTR(kFLEXSPI_Command_SDR, kFLEXSPI_1PAD, addr_4b ? SFDP_CMD_4B_DTR_READ_144 : SFDP_CMD_DTR_READ_144),
+            FLEXSPI_LUT_INSTR(kFLEXSPI_Command_RADDR_DDR, kFLEXSPI_4PAD, addr_bits),
+            FLEXSPI_LUT_INSTR(kFLEXSPI_Command_MODE8_DDR, kFLEXSPI_4PAD, 0xFF),
+            FLEXSPI_LUT_INSTR(kFLEXSPI_Command_DUMMY_DDR, kFLEXSPI_4PAD, 2 * flexspi_dtr_dummy(flash)),
+            FLEXSPI_LUT_INSTR(kFLEXSPI_Command_READ_DDR, kFLEXSPI_4PAD, FLEXSPI_INSTRUCTION_OPERAND_ANY_NONE_ZERO_VALUE),
+        };
+
+        flexspi_lut_pack(seq_lut, instr, sizeof(instr)/sizeof(instr[0]));
+    } else if(quad && flash->sfdp_table->DWORD1.support_114_fastread) {
+        seq_lut[0] = FLEXSPI_LUT_SEQ(kFLEXSPI_Command_SDR, kFLEXSPI_1PAD, addr_4b ? SFDP_CMD_4B_FAST_READ_114 : flash->sfdp_table->DWORD3.fastread_114_cmd, kFLEXSPI_Command_RADDR_SDR, kFLEXSPI_1PAD, addr_bits);
+        seq_lut[1] = FLEXSPI_LUT_SEQ(kFLEXSPI_Command_DUMMY_SDR, kFLEXSPI_4PAD, flash->sfdp_table->DWORD3.dummy_clocks_before_114_output, kFLEXSPI_Command_READ_SDR, kFLEXSPI_4PAD, FLEXSPI_INSTRUCTION_OPERAND_ANY_NONE_ZERO_VALUE);
+    } else {
+        seq_lut[0] = FLEXSPI_LUT_SEQ(kFLEXSPI_Command_SDR, kFLEXSPI_1PAD, addr_4b ? 0x0C : 0x0B, kFLEXSPI_Command_RADDR_SDR, kFLEXSPI_1PAD, addr_bits);
+        seq_lut[1] = FLEXSPI_LUT_SEQ(kFLEXSPI_Command_DUMMY_SDR, kFLEXSPI_1PAD, 8, kFLEXSPI_Command_READ_SDR, kFLEXSPI_1PAD, FLEXSPI_INSTRUCTION_OPERAND_ANY_NONE_ZERO_VALUE);
+    }
+}
 
-    /* Configure flash settings according to serial flash feature. */
-    FLEXSPI_SetFlashConfig(FLEXSPI, &flash_config, kFLEXSPI_PortA1);
+/**
+ * Whether the AHB reads of the device use the 1-4-4 DTR read. Octal parts
+ * have their own DDR read.
+ */
+static bool flexspi_read_dtr(const sfdp_flash *flash) {
+    const sfdp_para_table_t *table = flash->sfdp_table;
 
-    /* never enter 4 bytes address mode. */
-    if(flash_table[0].sfdp.addr_4_byte == true) {
-        flash_table[0].sfdp.addr_4_byte = false;
+    if(!FLEXSPI_DTR_READ || flexspi_octal(flash) || !table->DWORD1.support_dtr || !table->DWORD1.support_144_fastread) {
+        return false;
     }
 
-    /* Update LUT table. */
-    flexspi_set_lut();
+    return !flexspi_addr_4b(flash) || (flash->sfdp.instr_4b & SFDP_4B_DTR_READ_144);
+}
 
-    SFDP_DEBUG("FlexSPI init Done.");
+/**
+ * Dummy clocks of the DTR read after its one clock mode byte. SFDP has no DTR
+ * latency, Macronix parts keep the 1-4-4 SDR one (mode + wait clocks).
+ */
+static uint8_t flexspi_dtr_dummy(const sfdp_flash *flash) {
+    const uint8_t clocks = flash->sfdp_table->DWORD3.clocks_144_fastread + flash->sfdp_table->DWORD3.dummy_clocks_before_144_output;
+
+    if(FLEXSPI_DTR_READ_DUMMY != 0) {
+        return FLEXSPI_DTR_READ_DUMMY;
+    }
+
+    return clocks > 1 ? clocks - 1 : 0;
+}
+
+/**
+ * Whether checksum() may read the device in continuous read: a quad part with
+ * the 1-4-4 read whose 0-4-4 mode is entered by mode bits A5h and left by Fh
+ * on IO0-3, which flexspi_nor_Exit_Continuous() sends.
+ */
+static bool flexspi_read_continuous(const sfdp_flash *flash) {
+    const sfdp_para_table_t *table = flash->sfdp_table;
+
+    if(!FLEXSPI_CONTINUOUS_READ || flexspi_octal(flash) || !table->DWORD1.support_144_fastread || !table->DWORD15.support_044_mode) {
+        return false;
+    }
+    /* entry xxx1b: A5h, x1xxb: Axh; exit xx_xx1xb: Fh on IO0-3 for 8 clocks, 10 with 4-byte addresses */
+    if(!(table->DWORD15.mode_044_entry & 0x05) || !(table->DWORD15.mode_044_exit & 0x02)) {
+        return false;
+    }
+    if(flexspi_read_dtr(flash)) {
+        return true;
+    }
+
+    return !flexspi_addr_4b(flash) || (flash->sfdp.instr_4b & SFDP_4B_FAST_READ_144);
+}
+
+/**
+ * Build the AHB read sequence of checksum(): the 1-4-4 read (DTR when enabled)
+ * with mode bits A5h. JMP_ON_CS makes the next burst start at the address.
+ */
+static void flexspi_continuous_seq(const sfdp_flash *flash, uint32_t *seq_lut) {
+    const uint8_t addr_bits = flexspi_addr_bits(flash);
+    const bool addr_4b = flexspi_addr_4b(flash);
+    const uint8_t clocks = flash->sfdp_table->DWORD3.clocks_144_fastread + flash->sfdp_table->DWORD3.dummy_clocks_before_144_output;
+
+    if(flexspi_read_dtr(flash)) {
+        const uint16_t instr[] = {
+            FLEXSPI_LUT_INSTR(kFLEXSPI_Command_SDR, kFLEXSPI_1PAD, addr_4b ? SFDP_CMD_4B_DTR_READ_144 : SFDP_CMD_DTR_READ_144),
+            FLEXSPI_LUT_INSTR(kFLEXSPI_Command_RADDR_DDR, kFLEXSPI_4PAD, addr_bits),
+            FLEXSPI_LUT_INSTR(kFLEXSPI_Command_MODE8_DDR, kFLEXSPI_4PAD, 0xA5),
+            FLEXSPI_LUT_INSTR(kFLEXSPI_Command_DUMMY_DDR, kFLEXSPI_4PAD, 2 * flexspi_dtr_dummy(flash)),
+            FLEXSPI_LUT_INSTR(kFLEXSPI_Command_READ_DDR, kFLEXSPI_4PAD, FLEXSPI_INSTRUCTION_OPERAND_ANY_NONE_ZERO_VALUE),
+            FLEXSPI_LUT_INSTR(kFLEXSPI_Command_JUMP_ON_CS, kFLEXSPI_1PAD, 1),
+        };
+
+        flexspi_lut_pack(seq_lut, instr, sizeof(instr)/sizeof(instr[0]));
+    } else {
+        /* the mode byte takes the first two of the SFDP mode + wait clocks */
+        const uint16_t instr[] = {
+            FLEXSPI_LUT_INSTR(kFLEXSPI_Command_SDR, kFLEXSPI_1PAD, addr_4b ? SFDP_CMD_4B_FAST_READ_144 : flash->sfdp_table->DWORD3.fastread_144_cmd),
+            FLEXSPI_LUT_INSTR(kFLEXSPI_Command_RADDR_SDR, kFLEXSPI_4PAD, addr_bits),
+            FLEXSPI_LUT_INSTR(kFLEXSPI_Command_MODE8_SDR, kFLEXSPI_4PAD, 0xA5),
+            FLEXSPI_LUT_INSTR(kFLEXSPI_Command_DUMMY_SDR, kFLEXSPI_4PAD, clocks > 2 ? clocks - 2 : 0),
+            FLEXSPI_LUT_INSTR(kFLEXSPI_Command_READ_SDR, kFLEXSPI_4PAD, FLEXSPI_INSTRUCTION_OPERAND_ANY_NONE_ZERO_VALUE),
+            FLEXSPI_LUT_INSTR(kFLEXSPI_Command_JUMP_ON_CS, kFLEXSPI_1PAD, 1),
+        };
+
+        flexspi_lut_pack(seq_lut, instr, sizeof(instr)/sizeof(instr[0]));
+    }
+}
+
+/**
+ * Build the erase sequence of an SFDP erase type.
+ */
+static void flexspi_erase_seq(const sfdp_flash *flash, uint8_t type, uint32_t *seq_lut) {
+    memset(seq_lut, 0, 4*sizeof(uint32_t));
+
+    if(flexspi_octal(flash)) {
+        seq_lut[0] = flexspi_octal_cmd(flash, flexspi_erase_cmd(flash, type));
+        seq_lut[1] = FLEXSPI_LUT_SEQ(kFLEXSPI_Command_RADDR_DDR, kFLEXSPI_8PAD, 32, kFLEXSPI_Command_STOP, kFLEXSPI_1PAD, 0);
+    } else {
+        seq_lut[0] = FLEXSPI_LUT_SEQ(kFLEXSPI_Command_SDR, kFLEXSPI_1PAD, flexspi_erase_cmd(flash, type), kFLEXSPI_Command_RADDR_SDR, kFLEXSPI_1PAD, flexspi_addr_bits(flash));
+    }
+}
+
+/**
+ * Pack LUT instructions into the four words of a sequence, STOP fills the rest.
+ */
+static void flexspi_lut_pack(uint32_t *seq_lut, const uint16_t *instr, uint8_t num) {
+    memset(seq_lut, 0, 4*sizeof(uint32_t));
+
+    for(uint8_t i = 0; i < num; i++) {
+        seq_lut[i / 2] |= (uint32_t)instr[i] << (16 * (i & 1));
+    }
+}
+
+/**
+ * Whether the device has been switched to octal DDR.
+ */
+static bool flexspi_octal(const sfdp_flash *flash) {
+    return flash == octal_flash;
+}
+
+#if FLEXSPI_OCTAL_DDR
+/**
+ * Whether the device can be switched to octal DDR: SFDP names its 8D-8D-8D
+ * read and the sequences to enter the mode, and its instructions are one
+ * byte repeated or inverted as the extension.
+ */
+static bool flexspi_octal_capable(const sfdp_flash *flash) {
+    const sfdp_para *sfdp = &flash->sfdp;
+
+    return sfdp->octal.read_cmd != 0 && sfdp->octal.seq_num != 0
+           && (sfdp->octal.cmd_ext == SFDP_OCTAL_CMD_EXT_REPEAT || sfdp->octal.cmd_ext == SFDP_OCTAL_CMD_EXT_INVERT);
+}
+#endif
+
+/**
+ * LUT word of an 8D-8D-8D instruction, the opcode followed by its extension.
+ */
+static uint32_t flexspi_octal_cmd(const sfdp_flash *flash, uint8_t cmd) {
+    uint8_t ext = (flash->sfdp.octal.cmd_ext == SFDP_OCTAL_CMD_EXT_INVERT) ? (uint8_t)~cmd : cmd;
+
+    return FLEXSPI_LUT_SEQ(kFLEXSPI_Command_DDR, kFLEXSPI_8PAD, cmd, kFLEXSPI_Command_DDR, kFLEXSPI_8PAD, ext);
+}
+
+/**
+ * Build an 8D-8D-8D sequence. Addresses are 4 bytes, DDR dummy operands count
+ * half clocks. Quad sequences stay empty, page programs use PAGEPROGRAM_SINGLE.
+ */
+static void flexspi_octal_seq(const sfdp_flash *flash, uint32_t seq, uint32_t *seq_lut) {
+    const sfdp_para *sfdp = &flash->sfdp;
+    uint16_t instr[5];
+    uint8_t num = 0;
+    uint32_t cmd;
+
+    memset(seq_lut, 0, 4*sizeof(uint32_t));
+
+    switch(seq) {
+        case NOR_CMD_LUT_SEQ_IDX_READ_FAST_QUAD:
+        case NOR_CMD_LUT_SEQ_IDX_READ_FAST_QUAD_DEV1:
+        case NOR_CMD_LUT_SEQ_IDX_READ_FAST_QUAD_DEV2:
+        case NOR_CMD_LUT_SEQ_IDX_READ_FAST_QUAD_DEV3:
+            seq_lut[0] = flexspi_octal_cmd(flash, sfdp->octal.read_cmd);
+            seq_lut[1] = FLEXSPI_LUT_SEQ(kFLEXSPI_Command_RADDR_DDR, kFLEXSPI_8PAD, 32, kFLEXSPI_Command_DUMMY_DDR, kFLEXSPI_8PAD, 2 * sfdp->octal.read_dummy);
+            seq_lut[2] = FLEXSPI_LUT_SEQ(kFLEXSPI_Command_READ_DDR, kFLEXSPI_8PAD, FLEXSPI_INSTRUCTION_OPERAND_ANY_NONE_ZERO_VALUE, kFLEXSPI_Command_STOP, kFLEXSPI_1PAD, 0);
+            break;
+
+        case NOR_CMD_LUT_SEQ_IDX_ERASESECTOR:
+            flexspi_erase_seq(flash, SMALLEST_ERASER_INDEX, seq_lut);
+            break;
+
+        case NOR_CMD_LUT_SEQ_IDX_PAGEPROGRAM_SINGLE:
+            seq_lut[0] = flexspi_octal_cmd(flash, SFDP_CMD_4B_PAGE_PROGRAM);
+            seq_lut[1] = FLEXSPI_LUT_SEQ(kFLEXSPI_Command_RADDR_DDR, kFLEXSPI_8PAD, 32, kFLEXSPI_Command_WRITE_DDR, kFLEXSPI_8PAD, FLEXSPI_INSTRUCTION_OPERAND_ANY_NONE_ZERO_VALUE);
+            break;
+
+        case NOR_CMD_LUT_SEQ_IDX_WRITEENABLE:
+            seq_lut[0] = flexspi_octal_cmd(flash, SFDP_CMD_WRITE_ENABLE);
+            break;
+
+        case NOR_CMD_LUT_SEQ_IDX_ERASECHIP:
+            seq_lut[0] = flexspi_octal_cmd(flash, SFDP_CMD_ERASE_CHIP);
+            break;
+
+        /* the profile tells whether read status takes an address, and its dummy clocks */
+        case NOR_CMD_LUT_SEQ_IDX_READSTATUSREG:
+            cmd = flexspi_octal_cmd(flash, SFDP_CMD_READ_STATUS_REGISTER);
+            instr[num++] = (uint16_t)cmd;
+            instr[num++] = (uint16_t)(cmd >> 16);
+            if(sfdp->octal.rdsr_addr_bytes) {
+                instr[num++] = FLEXSPI_LUT_INSTR(kFLEXSPI_Command_RADDR_DDR, kFLEXSPI_8PAD, 8 * sfdp->octal.rdsr_addr_bytes);
+            }
+            instr[num++] = FLEXSPI_LUT_INSTR(kFLEXSPI_Command_DUMMY_DDR, kFLEXSPI_8PAD, 2 * sfdp->octal.rdsr_dummy);
+            instr[num++] = FLEXSPI_LUT_INSTR(kFLEXSPI_Command_READ_DDR, kFLEXSPI_8PAD, FLEXSPI_INSTRUCTION_OPERAND_ANY_NONE_ZERO_VALUE);
+            flexspi_lut_pack(seq_lut, instr, num);
+            break;
+    }
+}
+
+/**
+ * Load the sequences of the device the next IP commands go to, if another
+ * device's are in the LUT. The parts of a gang share theirs.
+ */
+static void flexspi_select_device(const nor_port_t *nor) {
+    uint32_t seq_lut[4];
+
+    if(nor->flash == lut_flash) {
+        return;
+    }
+
+    for(uint8_t i = 0; i < sizeof(device_seqs)/sizeof(device_seqs[0]); i++) {
+        flexspi_device_seq(nor->flash, device_seqs[i], seq_lut);
+        flexspi_update_lut_seq(device_seqs[i], seq_lut);
+    }
+    lut_flash = nor->flash;
+    erase_block_type = 0;
+}
+
+/**
+ * Reprogram the four LUT words of one sequence.
+ */
+static void flexspi_update_lut_seq(uint32_t seq, const uint32_t *seq_lut) {
+    flexspi_lut_write_seq(FLEXSPI, seq, seq_lut);
+}
+
+/**
+ * Change the FlexSPI root clock divider and the read sample clock, both only
+ * take effect with the module stopped. The flash DQS goes through the DLL as
+ * FLEXSPI_SetFlashConfig() sets it up for the new root clock.
+ */
+static void flexspi_set_clock(uint32_t div, flexspi_read_sample_clock_t rx_sample_clock) {
+    while(!FLEXSPI_GetBusIdleStatus(FLEXSPI)) {
+    }
+    FLEXSPI_Enable(FLEXSPI, false);
+    CLOCK_DisableClock(kCLOCK_FlexSpi);
+    CLOCK_SetDiv(kCLOCK_FlexspiDiv, div);
+    CLOCK_EnableClock(kCLOCK_FlexSpi);
+
+    FLEXSPI->MCR0 = (FLEXSPI->MCR0 & ~FLEXSPI_MCR0_RXCLKSRC_MASK) | FLEXSPI_MCR0_RXCLKSRC(rx_sample_clock);
+    if(rx_sample_clock == kFLEXSPI_ReadSampleClkExternalInputFromDqsPad
+       && CLOCK_GetFreq(kCLOCK_Usb1PllPfd0Clk)/(div + 1U) >= 100000000U) {
+        FLEXSPI->DLLCR[0] = FLEXSPI_DLLCR_DLLEN(1) | FLEXSPI_DLLCR_SLVDLYTARGET(0x0F);
+    } else {
+        FLEXSPI->DLLCR[0] = FLEXSPI_DLLCR_OVRDEN(1);
+    }
+
+    FLEXSPI_Enable(FLEXSPI, true);
+    /* AHB RX buffers hold data read with the old clock */
+    FLEXSPI_SoftwareReset(FLEXSPI);
+}
+
+static void flexspi_init(void) {
+    extern sfdp_flash flash_table[];
+
+    flexspi_config_t config =
+    {
+        /* the flash DQS only once an octal part is in 8D-8D-8D */
+        .rxSampleClock = (FLEXSPI_RX_SAMPLE_CLOCK == 3) ? kFLEXSPI_ReadSampleClkLoopbackFromDqsPad : (flexspi_read_sample_clock_t)FLEXSPI_RX_SAMPLE_CLOCK,
+    	.enableSckFreeRunning = false,
+    	.enableCombination = FLEXSPI_OCTAL_DDR,
+    	.enableDoze = true,
+    	.enableHalfSpeedAccess = false,
+    	.enableSckBDiffOpt = false,
+    	.enableSameConfigForAll = false,
+    	.seqTimeoutCycle = 0xFFFFU,
+    	.ipGrantTimeoutCycle = 0xFFU,
+    	.txWatermark = 8,
+    	.rxWatermark = 8,
+    	.ahbConfig.enableAHBWriteIpTxFifo = false,
+    	.ahbConfig.enableAHBWriteIpRxFifo = false,
+    	.ahbConfig.ahbGrantTimeoutCycle = 0xFFU,
+    	.ahbConfig.ahbBusTimeoutCycle = 0xFFFFU,
+    	.ahbConfig.resumeWaitCycle = 0x20U,
+        /* buffers 0..2 belong to no master, the core reads through the
+           all-master buffer 3 (256 bytes, prefetch enabled at reset) */
+        .ahbConfig.buffer = {{0, 0x0E, 0}, {0, 0x0E, 0}, {0, 0x0E, 0}, {0, 0, 0}},
+    	.ahbConfig.enableClearAHBBufferOpt = false,
+    	.ahbConfig.enableAHBPrefetch = true,
+    	.ahbConfig.enableAHBBufferable = false,
+    	.ahbConfig.enableAHBCachable = false,
+    };
+
+    flexspi_device_config_t flash_config = {
+        .flexspiRootClk = CLOCK_GetFreq(kCLOCK_Usb1PllPfd0Clk)/(CLOCK_GetDiv(kCLOCK_FlexspiDiv) + 1U),
+        .flashSize = flexspi_flash_size(&flash_table[0]),
+        .CSIntervalUnit = kFLEXSPI_CsIntervalUnit1SckCycle,
+        .CSInterval = 2,
+        .CSHoldTime = 3,
+        .CSSetupTime = 3,
+        .dataValidTime = 0,
+        .columnspace = 0,
+        .enableWordAddress = 0,
+        .AWRSeqIndex = 0,
+        .AWRSeqNumber = 0,
+        .ARDSeqIndex = NOR_CMD_LUT_SEQ_IDX_READ_FAST_QUAD, //NOR_CMD_LUT_SEQ_IDX_READ_NORMAL,
+        .ARDSeqNumber = 1,
+        .AHBWriteWaitUnit = kFLEXSPI_AhbWriteWaitUnit2AhbCycle,
+        .AHBWriteWaitInterval = 0,
+    };
+
+#if SFDP_PORT_LPSPI == true
+    /* DeInit LPSPI2 */
+    LPSPI_Deinit(LPSPI2);
+#endif
+
+    /* every part answers 1S-1S-1S until flexspi_octal_enter() */
+    octal_flash = NULL;
+
+    /* Set FLEXSPI IOMUX. */
+    flexspi_set_iomux();
+
+    /* Set AHB buffer size for reading data through AHB bus. */
+    FLEXSPI_Init(FLEXSPI, &config);
+
+    /* Configure flash settings according to serial flash feature. */
+    FLEXSPI_SetFlashConfig(FLEXSPI, &flash_config, kFLEXSPI_PortA1);
+
+    /* never enter 4 bytes address mode, parts above 16 MB use the 4-byte address instructions. */
+    if(flash_table[0].sfdp.addr_4_byte == true) {
+        flash_table[0].sfdp.addr_4_byte = false;
+    }
+
+    /* Update LUT table. */
+    flexspi_set_lut();
+
+    /* Find the parts that are programmed together, or the other devices. */
+    flexspi_probe_ports(&flash_config);
+
+#if FLEXSPI_OCTAL_DDR
+    /* Switch the part on A1 to 8D-8D-8D when SFDP says how. */
+    flexspi_octal_enter(FLEXSPI, &nor_port[0], &flash_config);
+#endif
+
+#if FLEXSPI_PARALLEL_MODE
+    /* AHB reads fetch from A1 and B1 at once, the IP commands still address one part */
+    FLEXSPI_EnableAHBParallelMode(FLEXSPI, true);
+#endif
+
+    SFDP_DEBUG("FlexSPI init Done.");
+}
+
+/**
+ * Flash size in KB from the SFDP density (DWORD2), as FLSHCR0 takes it.
+ * Without 4-byte address instructions only the first 16 MB are reachable.
+ */
+static uint32_t flexspi_flash_size(const sfdp_flash *flash) {
+    const uint32_t density = flash->sfdp_table->DWORD2.flash_density;
+    uint32_t size = (density>>31U)==0U?((density+1)/(8*1024)):(1U<<(density&0x7FFFFFFF))/(8*1024);
+
+    if(flexspi_addr_bits(flash) == 24 && size > NOR_3BYTE_ADDR_SIZE / 1024U) {
+        size = NOR_3BYTE_ADDR_SIZE / 1024U;
+    }
+
+    return size;
+}
+
+/**
+ * Whether the device is addressed by the instructions of its 4-byte address
+ * instruction table. Only parts above 16 MB use them, and only when the table
+ * covers quad read, page program and the smallest erase type.
+ */
+static bool flexspi_addr_4b(const sfdp_flash *flash) {
+    const uint32_t instr = flash->sfdp.instr_4b;
+
+    return flash->sfdp.capacity > NOR_3BYTE_ADDR_SIZE
+           && (instr & SFDP_4B_FAST_READ_114) && (instr & SFDP_4B_PAGE_PROGRAM_111)
+           && flash->sfdp.eraser[SMALLEST_ERASER_INDEX].cmd_4b != 0;
+}
+
+static uint8_t flexspi_addr_bits(const sfdp_flash *flash) {
+    return (flash->addr_in_4_byte==true || flexspi_addr_4b(flash) || flexspi_octal(flash))?32:24;
+}
+
+/**
+ * Erase instruction of an SFDP erase type in the addressing of the device, 0 if it has none.
+ * Octal DDR always sends 4-byte addresses, the 4-byte instruction is preferred when there is one.
+ */
+static uint8_t flexspi_erase_cmd(const sfdp_flash *flash, uint8_t type) {
+    if(flash->sfdp.eraser[type].size == 0) {
+        return 0;
+    }
+    if(flexspi_octal(flash) && flash->sfdp.eraser[type].cmd_4b != 0) {
+        return flash->sfdp.eraser[type].cmd_4b;
+    }
+
+    return flexspi_addr_4b(flash) ? flash->sfdp.eraser[type].cmd_4b : flash->sfdp.eraser[type].cmd;
+}
+
+/**
+ * Erase types usable at an offset of the device, bit n for SFDP eraser n, and
+ * the end of its sector map region. Without a sector map the device is one
+ * region and every type with an instruction is usable.
+ */
+static uint8_t flexspi_erase_types(const sfdp_flash *flash, uint32_t address, uint32_t *region_end) {
+    const sfdp_para *sfdp = &flash->sfdp;
+    uint32_t start = 0;
+    uint8_t types = 0;
+    uint8_t i;
+
+    *region_end = sfdp->capacity;
+    if(sfdp->region_num == 0) {
+        types = (1U << SFDP_SFDP_ERASE_TYPE_MAX_NUM) - 1;
+    }
+    for(i = 0; i < sfdp->region_num; i++) {
+        if(address - start < sfdp->region[i].size) {
+            types = sfdp->region[i].erasers;
+            *region_end = start + sfdp->region[i].size;
+            break;
+        }
+        start += sfdp->region[i].size;
+    }
+
+    for(i = 0; i < SFDP_SFDP_ERASE_TYPE_MAX_NUM; i++) {
+        if(flexspi_erase_cmd(flash, i) == 0) {
+            types &= ~(1U << i);
+        }
+    }
+
+    return types;
+}
+
+/**
+ * Configure one chip select, keeping the flash sizes of the others.
+ * KSDK 2.3 FLEXSPI_SetFlashConfig clears FLSHCR0 of another port on the way.
+ */
+static void flexspi_config_port(flexspi_device_config_t *flash_config, flexspi_port_t port) {
+    uint32_t flash_size[4];
+    uint8_t i;
+
+    for(i = 0; i < 4; i++) {
+        flash_size[i] = FLEXSPI->FLSHCR0[i];
+    }
+
+    FLEXSPI_SetFlashConfig(FLEXSPI, flash_config, port);
+
+    for(i = 0; i < 4; i++) {
+        if(i != port) {
+            FLEXSPI->FLSHCR0[i] = flash_size[i];
+        }
+    }
+}
+
+/**
+ * Find the parts behind the other chip selects. Port A1 holds the part read
+ * by sfdp_init(). In gang and parallel mode the other ports join when their SFDP
+ * header and basic parameter table read back the same through FlexSPI.
+ * Otherwise flash_table[n] is probed on chip select n and, when found, gets
+ * the address window after the devices before it.
+ */
+static void flexspi_probe_ports(flexspi_device_config_t *flash_config) {
+    extern sfdp_flash flash_table[];
+    nor_port_t *nor;
+    uint8_t i;
+
+    /* only the ports in use decode an address range */
+    for(i = 1; i < 4; i++) {
+        FLEXSPI->FLSHCR0[flexspi_ports[i]] = 0;
+    }
+
+    nor_port_num = 0;
+
+#if NOR_MULTI_DEVICE
+    uint32_t end = 0;
+#if NOR_PROBE_IOMUX
+    bool port_b = false;
+#endif
+
+    for(i = 0; i < NOR_PORT_NUM; i++) {
+        sfdp_flash *flash = &flash_table[i];
+        flexspi_device_config_t config = *flash_config;
+
+        nor = &nor_port[nor_port_num];
+        nor->port = flexspi_ports[i];
+        nor->base = end;
+        nor->flash = flash;
+        nor->read_seq = read_seqs[i];
+        nor->pending_op = FLASH_OP_NONE;
+
+        if(i != 0) {
+            uint32_t seq_lut[4];
+
+#if FLEXSPI_OCTAL_DDR
+            /* port B data pads carry DATA4..7 of port A, an octal part on A1 is the only device */
+            if(nor->port >= kFLEXSPI_PortB1 || flexspi_octal_capable(&flash_table[0])) {
+                continue;
+            }
+#endif
+
+#if NOR_PROBE_IOMUX
+            flexspi_probe_iomux(nor->port, nor->port >= kFLEXSPI_PortB1, true);
+#endif
+            /* decode a window for the probe, its size is known once SFDP is read */
+            flexspi_config_port(&config, nor->port);
+
+            flash->spi.wr = flexspi_sfdp_write_read;
+            flash->spi.user_data = nor;
+            flash->retry = flash_table[0].retry;
+
+            if(SFDP_SUCCESS != sfdp_device_init(flash) || !flash->sfdp.available || flexspi_flash_size(flash) == 0) {
+                FLEXSPI->FLSHCR0[nor->port] = 0;
+#if NOR_PROBE_IOMUX
+                flexspi_probe_iomux(nor->port, false, false);
+#endif
+                SFDP_DEBUG("FlexSPI port %d: no flash.", nor->port);
+                continue;
+            }
+#if NOR_PROBE_IOMUX
+            port_b |= (nor->port >= kFLEXSPI_PortB1);
+#endif
+
+            config.flashSize = flexspi_flash_size(flash);
+            config.ARDSeqIndex = nor->read_seq;
+            flexspi_config_port(&config, nor->port);
+
+            flexspi_device_seq(flash, nor->read_seq, seq_lut);
+            flexspi_update_lut_seq(nor->read_seq, seq_lut);
+
+            /* never enter 4 bytes address mode, parts above 16 MB use the 4-byte address instructions. */
+            flash->sfdp.addr_4_byte = false;
+        }
+
+        nor->size = flexspi_flash_size(flash) * 1024U;
+        end += nor->size;
+
+        SFDP_DEBUG("FlexSPI port %d: %s at 0x%08lX, %ld KB.", nor->port, flash->name,
+                   FlexSPI_AHB_BASE + nor->base, nor->size / 1024U);
+        nor_port_num++;
+    }
+#if NOR_PROBE_IOMUX && (NOR_PORT_NUM > 2)
+    /* no flash on B1 or B2, the port B bus goes back to GPIO as well */
+    if(!port_b) {
+        flexspi_probe_iomux(kFLEXSPI_PortA1, true, false);
+    }
+#endif
+#else
+#if FLEXSPI_PARALLEL_MODE
+    static const flexspi_port_t ports[] = {kFLEXSPI_PortA1, kFLEXSPI_PortB1};
+#else
+    const flexspi_port_t *ports = flexspi_ports;
+#endif
+    uint32_t table[sizeof(sfdp_para_table_t)/sizeof(uint32_t)];
+    uint32_t table_size = flash_table[0].sfdp_header.len * sizeof(uint32_t);
+    uint32_t signature;
+
+    if(table_size > sizeof(table)) {
+        table_size = sizeof(table);
+    }
+
+    for(i = 1; i < NOR_PORT_NUM; i++) {
+        flexspi_config_port(flash_config, ports[i]);
+    }
+
+    for(i = 0; i < NOR_PORT_NUM; i++) {
+        nor = &nor_port[nor_port_num];
+
+        nor->port = ports[i];
+        nor->base = i * flash_config->flashSize * 1024U;
+        nor->size = flash_config->flashSize * 1024U;
+        nor->flash = &flash_table[0];
+        nor->read_seq = NOR_CMD_LUT_SEQ_IDX_READ_FAST_QUAD;
+        nor->pending_op = FLASH_OP_NONE;
+
+        if(i != 0) {
+            if(kStatus_Success != flexspi_nor_Read_SFDP(FLEXSPI, nor, 0, &signature, sizeof(signature))
+               || signature != SFDP_SIGNATURE
+               || kStatus_Success != flexspi_nor_Read_SFDP(FLEXSPI, nor, flash_table[0].sfdp_header.ptp, table, table_size)
+               || memcmp(table, flash_table[0].sfdp_table, table_size) != 0) {
+                SFDP_DEBUG("FlexSPI port %d: no matching flash.", ports[i]);
+                continue;
+            }
+        }
+
+        SFDP_DEBUG("FlexSPI port %d: flash at 0x%08lX.", ports[i], FlexSPI_AHB_BASE + nor->base);
+        nor_port_num++;
+    }
+#endif
+
+    /* Set QE for quad reads and programs, fall back to 1-1-1 reads without it. */
+    for(i = 0; i < nor_port_num; i++) {
+        nor = &nor_port[i];
+        /* the parts of a gang or parallel array share flash_table[0] */
+        if(NOR_MULTI_DEVICE || i == 0) {
+            flexspi_sector_map(FLEXSPI, nor);
+        }
+        nor->program_seq = NOR_CMD_LUT_SEQ_IDX_PAGEPROGRAM_SINGLE;
+        nor->qe_set_by_init = false;
+        nor->qe_volatile = false;
+        nor->read_dtr = flexspi_read_dtr(nor->flash);
+        nor->read_continuous = false;
+        if(!flexspi_nor_Quad_Enabled(FLEXSPI, nor)) {
+            /* --setQE keeps QE for quad boot reads, otherwise the volatile copy is enough where the part has one */
+            nor->qe_volatile = (qe_request != QE_SET) && (kStatus_Success == flexspi_nor_Write_QE(FLEXSPI, nor, true, true));
+            nor->qe_set_by_init = nor->qe_volatile || (kStatus_Success == flexspi_nor_Write_QE(FLEXSPI, nor, true, false));
+            if(!nor->qe_set_by_init) {
+                uint32_t seq_lut[4];
+
+                /* the parts of a gang share the read sequence, one of them without QE slows all down */
+                flexspi_read_seq(nor->flash, false, seq_lut);
+                flexspi_update_lut_seq(nor->read_seq, seq_lut);
+                nor->read_dtr = false;
+                SFDP_DEBUG("FlexSPI port %d: QE cannot be set, 1-1-1 reads.", nor->port);
+                continue;
+            }
+            SFDP_DEBUG("FlexSPI port %d: QE set%s.", nor->port, nor->qe_volatile ? " (volatile)" : "");
+        }
+        if(nor->read_dtr) {
+            SFDP_DEBUG("FlexSPI port %d: 1-4-4 DTR reads, %d dummy clocks.", nor->port, flexspi_dtr_dummy(nor->flash));
+        }
+        nor->read_continuous = flexspi_read_continuous(nor->flash);
+        if(nor->read_continuous) {
+            SFDP_DEBUG("FlexSPI port %d: checksums in continuous read.", nor->port);
+        }
+        if(quad_program_lookup(nor->flash) != NULL) {
+            nor->program_seq = NOR_CMD_LUT_SEQ_IDX_PAGEPROGRAM_QUAD;
+            SFDP_DEBUG("FlexSPI port %d: quad page program enabled, command 0x%02X.", nor->port,
+                       quad_program_lookup(nor->flash)->cmd);
+        }
+    }
+}
+
+#if NOR_MULTI_DEVICE
+/**
+ * sfdp_spi write/read of the devices behind FlexSPI, bound by flexspi_probe_ports().
+ * Read SFDP has its own sequence, the register reads of sfdp.c borrow the
+ * ERASEBLOCK slot.
+ */
+static sfdp_err flexspi_sfdp_write_read(const sfdp_spi *spi, const uint8_t *write_buf, size_t write_size,
+                                        uint8_t *read_buf, size_t read_size) {
+    nor_port_t *nor = (nor_port_t *)spi->user_data;
+    uint32_t data[16];
+    uint32_t address = 0;
+    uint32_t seq = NOR_CMD_LUT_SEQ_IDX_READ_SFDP;
+
+    if(write_buf[0] == SFDP_CMD_READ_SFDP_REGISTER && write_size >= 4) {
+        address = ((uint32_t)write_buf[1] << 16) | ((uint32_t)write_buf[2] << 8) | write_buf[3];
+    } else {
+        uint32_t seq_lut[4] = {
+            FLEXSPI_LUT_SEQ(kFLEXSPI_Command_SDR, kFLEXSPI_1PAD, write_buf[0], kFLEXSPI_Command_READ_SDR, kFLEXSPI_1PAD, FLEXSPI_INSTRUCTION_OPERAND_ANY_NONE_ZERO_VALUE),
+        };
+        flexspi_update_lut_seq(NOR_CMD_LUT_SEQ_IDX_ERASEBLOCK, seq_lut);
+        erase_block_type = 0;
+        seq = NOR_CMD_LUT_SEQ_IDX_ERASEBLOCK;
+    }
+
+    while(read_size) {
+        uint32_t size = (read_size < sizeof(data)) ? read_size : sizeof(data);
+        flexspi_transfer_t flashXfer =
+        {
+            .deviceAddress = nor->base + address,
+            .port = nor->port,
+            .cmdType = kFLEXSPI_Read,
+            .seqIndex = seq,
+            .SeqNumber = 1,
+            .data = data,
+            .dataSize = size,
+        };
+
+        if(kStatus_Success != FLEXSPI_TransferBlocking(FLEXSPI, &flashXfer)) {
+            return SFDP_ERR_READ;
+        }
+        memcpy(read_buf, data, size);
+
+        read_buf += size;
+        read_size -= size;
+        address += size;
+    }
+
+    return SFDP_SUCCESS;
+}
+#endif
+
+/**
+ * The part or device that holds an offset of the flash array, NULL past the
+ * last device. Gang and parallel mode address nor_port[0].
+ */
+static nor_port_t *nor_port_at(uint32_t index) {
+#if NOR_MULTI_DEVICE
+    for(uint8_t i = 0; i < nor_port_num; i++) {
+        if(index - nor_port[i].base < nor_port[i].size) {
+            return &nor_port[i];
+        }
+    }
+    return NULL;
+#else
+    (void)index;
+    return &nor_port[0];
+#endif
+}
+
+/**
+ * Bytes of the flash array covered by one page program on every part.
+ */
+static uint32_t page_program_size(const sfdp_flash *flash) {
+    uint32_t size = 1UL << flash->sfdp_table->DWORD11.page_size;
+
+#if FLEXSPI_PARALLEL_MODE
+    if(size > NOR_PARALLEL_PAGE_MAX) {
+        size = NOR_PARALLEL_PAGE_MAX;
+    }
+#endif
+
+    return size * NOR_PARALLEL_FACTOR;
+}
+
+/**
+ * Find the quad page program instruction of the flash, NULL if it has none.
+ * The part must support the matching quad fast read according to SFDP.
+ */
+static const quad_program_t *quad_program_lookup(const sfdp_flash *flash) {
+    /* parts addressed by 4-byte instructions name their quad program in that table */
+    if(flexspi_addr_4b(flash)) {
+        if(flash->sfdp.instr_4b & SFDP_4B_PAGE_PROGRAM_114) {
+            return &quad_program_4b[0];
+        }
+        if((flash->sfdp.instr_4b & SFDP_4B_PAGE_PROGRAM_144) && flash->sfdp_table->DWORD1.support_144_fastread) {
+            return &quad_program_4b[1];
+        }
+        return NULL;
+    }
+
+    for(uint32_t i = 0; i < sizeof(quad_program_table)/sizeof(quad_program_table[0]); i++) {
+        const quad_program_t *entry = &quad_program_table[i];
+
+        if(entry->mf_id != flash->chip.mf_id) {
+            continue;
+        }
+        if(entry->addr_pads == kFLEXSPI_1PAD && flash->sfdp_table->DWORD1.support_114_fastread) {
+            return entry;
+        }
+        if(entry->addr_pads == kFLEXSPI_4PAD && flash->sfdp_table->DWORD1.support_144_fastread) {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Check whether a buffer holds only 0xFF, a word at a time.
+ */
+static bool is_blank(char const *data, uint32_t size) {
+    const uint8_t *p = (const uint8_t *)data;
+    const uint32_t *word;
+
+    while(size && ((uintptr_t)p & 3U)) {
+        if(*p++ != 0xFFU) {
+            return false;
+        }
+        size--;
+    }
+
+    word = (const uint32_t *)p;
+    while(size >= 16) {
+        if((word[0] & word[1] & word[2] & word[3]) != 0xFFFFFFFFU) {
+            return false;
+        }
+        word += 4;
+        size -= 16;
+    }
+    while(size >= 4) {
+        if(*word++ != 0xFFFFFFFFU) {
+            return false;
+        }
+        size -= 4;
+    }
+
+    p = (const uint8_t *)word;
+    while(size--) {
+        if(*p++ != 0xFFU) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Whether the quad enable requirements (DWORD15) name an instruction that
+ * reads the register holding QE. 001b and 100b write SR2 with 01h only.
+ */
+static bool flexspi_qe_readable(const sfdp_flash *flash) {
+    if(flash->sfdp_header.len < 15) {
+        return false;
+    }
+
+    switch(flash->sfdp_table->DWORD15.quad_enable_requirements) {
+        case 1:
+        case 4:
+            return false;
+        default:
+            return true;
+    }
+}
+
+/**
+ * LUT sequence of the write enable that makes a status register write change
+ * only the volatile copy, from DWORD16 or the DWORD1 bits 3/4 of JESD216 (v1.0)
+ * tables. 0: the part has no volatile status register writes.
+ */
+static uint8_t flexspi_sr_volatile_we(const sfdp_flash *flash) {
+    if(flash->sfdp_header.len >= 16) {
+        uint32_t sr1 = flash->sfdp_table->DWORD16.value;
+
+        if(sr1 & (SFDP_SR1_VOLATILE_50H | SFDP_SR1_NV_VOLATILE_50H)) {
+            return NOR_CMD_LUT_SEQ_IDX_WRITE_ENABLE_VOLATILE;
+        }
+        return (sr1 & SFDP_SR1_VOLATILE_06H) ? NOR_CMD_LUT_SEQ_IDX_WRITEENABLE : 0;
+    }
+    if(!flash->sfdp.sr_is_non_vola) {
+        return (flash->sfdp.vola_sr_we_cmd == SFDP_VOLATILE_SR_WRITE_ENABLE) ? NOR_CMD_LUT_SEQ_IDX_WRITE_ENABLE_VOLATILE
+                                                                              : NOR_CMD_LUT_SEQ_IDX_WRITEENABLE;
+    }
+    return 0;
+}
+
+/**
+ * Check the QE bit according to the SFDP quad enable requirements (DWORD15).
+ * Without an instruction to read it (flexspi_qe_readable()) it counts as clear.
+ */
+static bool flexspi_nor_Quad_Enabled(FLEXSPI_Type *base, nor_port_t *nor) {
+    uint8_t value = 0;
+    uint8_t mask;
+
+    /* JESD216 (v1.0) basic tables end before DWORD15 */
+    if(nor->flash->sfdp_header.len < 15) {
+        return false;
+    }
+
+    switch(nor->flash->sfdp_table->DWORD15.quad_enable_requirements) {
+        case 0:
+            /* no QE bit, quad instructions are always accepted */
+            return true;
+        case 2:
+            mask = 1U << 6;
+            break;
+        case 3:
+            mask = 1U << 7;
+            break;
+        case 5:
+        case 6:
+            mask = 1U << 1;
+            break;
+        default:
+            return false;
+    }
+
+    flexspi_select_device(nor);
+    if(kStatus_Success != flexspi_nor_Read_Register(base, nor, NOR_CMD_LUT_SEQ_IDX_READ_QE_REG, &value)) {
+        return false;
+    }
+
+    return (value & mask) != 0;
+}
+
+/**
+ * Set or clear the QE bit according to the SFDP quad enable requirements
+ * (DWORD15) and read it back where the part allows. volatile_write enables the
+ * status register write for the volatile copy only, kStatus_Fail when the part
+ * has none; otherwise the write is non-volatile.
+ */
+static status_t flexspi_nor_Write_QE(FLEXSPI_Type *base, nor_port_t *nor, bool enable, bool volatile_write)
+{
+    uint8_t sr[2] = { 0 };
+    uint32_t writeValue;
+    uint32_t size = 1;
+    uint8_t mask;
+    status_t result;
+    flexspi_transfer_t enableXfer =
+    {
+        .deviceAddress = nor->base,
+        .port = nor->port,
+        .cmdType = kFLEXSPI_Command,
+        .seqIndex = NOR_CMD_LUT_SEQ_IDX_WRITEENABLE,
+        .SeqNumber = 1,
+        .data = NULL,
+        .dataSize = 0,
+    };
+    flexspi_transfer_t flashXfer =
+    {
+        .deviceAddress = nor->base,
+        .port = nor->port,
+        .cmdType = kFLEXSPI_Write,
+        .seqIndex = NOR_CMD_LUT_SEQ_IDX_WRITESTATUSREG,
+        .SeqNumber = 1,
+        .data = &writeValue,
+        .dataSize = 1,
+    };
+
+    /* JESD216 (v1.0) basic tables end before DWORD15 */
+    if(nor->flash->sfdp_header.len < 15) {
+        return kStatus_Fail;
+    }
+    if(nor->flash->sfdp_table->DWORD15.quad_enable_requirements == 0) {
+        return kStatus_Success;
+    }
+    if(flexspi_octal(nor->flash)) {
+        return kStatus_Fail;
+    }
+    if(volatile_write) {
+        enableXfer.seqIndex = flexspi_sr_volatile_we(nor->flash);
+        if(enableXfer.seqIndex == 0) {
+            return kStatus_Fail;
+        }
+    }
+
+    flexspi_select_device(nor);
+
+    switch(nor->flash->sfdp_table->DWORD15.quad_enable_requirements) {
+        /* SR1 bit 6, one byte 01h */
+        case 2:
+            mask = 1U << 6;
+            result = flexspi_nor_Read_Register(base, nor, NOR_CMD_LUT_SEQ_IDX_READSTATUSREG, &sr[0]);
+            break;
+        /* SR2 bit 7, read 3Fh write 3Eh; SR2 bit 1, read 35h write 31h */
+        case 3:
+        case 6:
+            mask = (nor->flash->sfdp_table->DWORD15.quad_enable_requirements == 3) ? (1U << 7) : (1U << 1);
+            result = flexspi_nor_Read_Register(base, nor, NOR_CMD_LUT_SEQ_IDX_READ_QE_REG, &sr[0]);
+            break;
+        /* SR2 bit 1, two bytes 01h: SR1 then SR2 */
+        case 5:
+            mask = 1U << 1;
+            result = flexspi_nor_Read_Register(base, nor, NOR_CMD_LUT_SEQ_IDX_READSTATUSREG, &sr[0]);
+            if(kStatus_Success == result) {
+                result = flexspi_nor_Read_Register(base, nor, NOR_CMD_LUT_SEQ_IDX_READ_QE_REG, &sr[1]);
+            }
+            size = 2;
+            break;
+        /* SR2 bit 1, two bytes 01h, no instruction reads SR2: its other bits are written as 0 */
+        case 1:
+        case 4:
+            mask = 1U << 1;
+            result = flexspi_nor_Read_Register(base, nor, NOR_CMD_LUT_SEQ_IDX_READSTATUSREG, &sr[0]);
+            size = 2;
+            break;
+        default:
+            return kStatus_Fail;
+    }
+    if(kStatus_Success != result) {
+        return result;
+    }
+
+    /* WIP and WEL read back as 0, the part ignores them on writes anyway */
+    sr[size - 1] = enable ? (sr[size - 1] | mask) : (sr[size - 1] & ~mask);
+    writeValue = sr[0] | ((uint32_t)sr[1] << 8);
+    flashXfer.dataSize = size;
+
+    result = FLEXSPI_TransferBlocking(base, &enableXfer);
+    if(kStatus_Success == result) {
+        result = FLEXSPI_TransferBlocking(base, &flashXfer);
+    }
+    if(kStatus_Success == result) {
+        result = flexspi_nor_Wait_Bus_If_Busy(base, nor);
+    }
+    if(kStatus_Success != result || !flexspi_qe_readable(nor->flash)) {
+        return result;
+    }
+
+    return (flexspi_nor_Quad_Enabled(base, nor) == enable) ? kStatus_Success : kStatus_Fail;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-static status_t flexspi_nor_Erase_Sector(FLEXSPI_Type *base, uint32_t address)
+/**
+ * Erase planner: cover [address, address + size) with the fewest operations.
+ * Every step uses the largest SFDP erase type usable in the sector map region
+ * at the current address that is aligned there and fits in the rest of both
+ * the range and the region. The range is widened to whole units of the
+ * smallest erase type of the regions at its ends.
+ */
+static status_t flexspi_nor_Erase_Range(FLEXSPI_Type *base, nor_port_t *nor, uint8_t num, uint32_t address, uint32_t size)
+{
+    const sfdp_para *sfdp = &nor[0].flash->sfdp;
+    uint32_t end = address + size;
+    status_t result = kStatus_Success;
+    bool first = true;
+
+    while(address < end)
+    {
+        uint32_t region_end;
+        uint8_t types = flexspi_erase_types(nor[0].flash, address, &region_end);
+        uint8_t type = SFDP_SFDP_ERASE_TYPE_MAX_NUM;
+        uint8_t smallest;
+
+        if(types == 0) {
+            SFDP_DEBUG("No SFDP erase type available at 0x%08lX.", address);
+            return kStatus_Fail;
+        }
+        /* erase types are sorted from small to large */
+        for(smallest = SMALLEST_ERASER_INDEX; !(types & (1U << smallest)); smallest++);
+        if(first) {
+            address &= ~(sfdp->eraser[smallest].size - 1);
+            first = false;
+        }
+
+        for(uint8_t i = smallest; i < SFDP_SFDP_ERASE_TYPE_MAX_NUM; i++) {
+            uint32_t type_size = sfdp->eraser[i].size;
+            if((types & (1U << i)) && (address & (type_size - 1)) == 0 && end - address >= type_size && region_end - address >= type_size) {
+                type = i;
+            }
+        }
+        if(type == SFDP_SFDP_ERASE_TYPE_MAX_NUM) {
+            type = smallest;
+        }
+
+        /* the parts erase in parallel, each waits only for its own previous step */
+        for(uint8_t i = 0; i < num; i++) {
+            result = flexspi_nor_Erase(base, &nor[i], address, type);
+            if(kStatus_Success != result)
+            {
+                return result;
+            }
+        }
+
+        address += sfdp->eraser[type].size;
+    }
+
+    return result;
+}
+
+static status_t flexspi_nor_Erase(FLEXSPI_Type *base, nor_port_t *nor, uint32_t address, uint8_t type)
 {
     status_t result = kStatus_Success;
     flexspi_transfer_t flashXfer =
     {
-        .deviceAddress = address,
-        .port = kFLEXSPI_PortA1,
+        .deviceAddress = nor->base + address,
+        .port = nor->port,
         .cmdType = kFLEXSPI_Command,
     	.seqIndex = NOR_CMD_LUT_SEQ_IDX_ERASESECTOR,
         .SeqNumber = 1,
@@ -353,8 +1999,27 @@ static status_t flexspi_nor_Erase_Sector(FLEXSPI_Type *base, uint32_t address)
         .dataSize = 0,
     };
 
+    flexspi_select_device(nor);
+
+    /* Larger erase types share one LUT slot, reload it when the type changes. */
+    if(type != SMALLEST_ERASER_INDEX) {
+        if(type != erase_block_type) {
+            uint32_t seq_lut[4];
+            flexspi_erase_seq(nor->flash, type, seq_lut);
+            flexspi_update_lut_seq(NOR_CMD_LUT_SEQ_IDX_ERASEBLOCK, seq_lut);
+            erase_block_type = type;
+        }
+        flashXfer.seqIndex = NOR_CMD_LUT_SEQ_IDX_ERASEBLOCK;
+    }
+
+    result = flexspi_nor_Complete_Port(base, nor);
+    if(kStatus_Success != result)
+    {
+        return result;
+    }
+
     /* Enable Writting. */
-    flexspi_nor_Write_Enable(base);
+    flexspi_nor_Write_Enable(base, nor);
 
     /* Erase a Sector. */
     result = FLEXSPI_TransferBlocking(base, &flashXfer);
@@ -363,26 +2028,37 @@ static status_t flexspi_nor_Erase_Sector(FLEXSPI_Type *base, uint32_t address)
         return result;
     }
 
-    return flexspi_nor_Wait_Bus_If_Busy(base);
+    nor->pending_op = FLASH_OP_ERASE;
+    nor->pending_addr = address;
+
+    return kStatus_Success;
 }
 
-status_t flexspi_nor_Write_Page(FLEXSPI_Type *base, uint32_t dstAddr, uint32_t *src)
+status_t flexspi_nor_Write_Page(FLEXSPI_Type *base, nor_port_t *nor, uint32_t dstAddr, uint32_t *src, uint32_t size)
 {
-    extern sfdp_para_table_t *sfdp_para_table;
     status_t result = kStatus_Success;
     flexspi_transfer_t flashXfer =
     {
-        .deviceAddress = dstAddr,
-        .port = kFLEXSPI_PortA1,
+        .deviceAddress = nor->base + dstAddr,
+        .port = nor->port,
         .cmdType = kFLEXSPI_Write,
-        .seqIndex = NOR_CMD_LUT_SEQ_IDX_PAGEPROGRAM_SINGLE,
+        .seqIndex = nor->program_seq,
         .SeqNumber = 1,
         .data = src,
-        .dataSize = (1<<sfdp_para_table->DWORD11.page_size),
+        .dataSize = size,
     };
 
+    flexspi_select_device(nor);
+
+    /* The previous page program is waited for here, not after it was started. */
+    result = flexspi_nor_Complete_Port(base, nor);
+    if (kStatus_Success != result)
+    {
+        return result;
+    }
+
     /* Enable Writting. */
-    result = flexspi_nor_Write_Enable(base);
+    result = flexspi_nor_Write_Enable(base, nor);
     if (kStatus_Success != result)
     {
         SFDP_DEBUG("flexspi_nor_Write_Enable failure!");
@@ -396,16 +2072,332 @@ status_t flexspi_nor_Write_Page(FLEXSPI_Type *base, uint32_t dstAddr, uint32_t *
         return result;
     }
 
-    return flexspi_nor_Wait_Bus_If_Busy(base);
+    nor->pending_op = FLASH_OP_PROGRAM;
+    nor->pending_addr = dstAddr;
+
+    return kStatus_Success;
+}
+
+#if FLEXSPI_PARALLEL_MODE
+/**
+ * Program one page of the parallel array: the even bytes go to the part on A1,
+ * the odd bytes to the part on B1, both at half the array address. Bytes of
+ * the array outside [dstAddr, dstAddr + size) are programmed as 0xFF.
+ * The two halves are sent one after the other, each over its own IP command.
+ */
+static status_t flexspi_parallel_Write_Page(FLEXSPI_Type *base, uint32_t dstAddr, char const *src, uint32_t size)
+{
+    static uint32_t part_data[NOR_PORT_NUM][NOR_PARALLEL_PAGE_MAX/sizeof(uint32_t)];
+    uint32_t start = dstAddr & ~1U;
+    uint32_t part_size = (dstAddr + size - start + 1) / 2;
+    status_t result = kStatus_Success;
+
+    /* the data phases of the last page programs are over, the buffers are free */
+    if((dstAddr | size) & 1U) {
+        memset(part_data, 0xFF, sizeof(part_data));
+    }
+    for(uint32_t i = 0; i < size; i++) {
+        uint32_t offset = dstAddr - start + i;
+        ((uint8_t *)part_data[offset & 1U])[offset >> 1] = src[i];
+    }
+
+    for(uint8_t i = 0; i < NOR_PORT_NUM; i++) {
+        result = flexspi_nor_Write_Page(base, &nor_port[i], start / 2, part_data[i], part_size);
+        if(kStatus_Success != result)
+        {
+            return result;
+        }
+    }
+
+    return kStatus_Success;
 }
+#endif
 
-static status_t flexspi_nor_Write_Enable(FLEXSPI_Type *base)
+/**
+ * Wait for the page programs or erases started last on every part.
+ */
+static status_t flexspi_nor_Complete(FLEXSPI_Type *base)
 {
     status_t result = kStatus_Success;
+
+    for(uint8_t i = 0; i < nor_port_num; i++)
+    {
+        status_t port_result = flexspi_nor_Complete_Port(base, &nor_port[i]);
+        if(kStatus_Success != port_result)
+        {
+            result = port_result;
+        }
+    }
+
+    return result;
+}
+
+/**
+ * Whether an erase or page program of any part may still be running.
+ */
+static bool flexspi_nor_Pending(void)
+{
+    for(uint8_t i = 0; i < nor_port_num; i++)
+    {
+        if(FLASH_OP_NONE != nor_port[i].pending_op)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Wait for the page program or erase started last on one part, if any.
+ */
+static status_t flexspi_nor_Complete_Port(FLEXSPI_Type *base, nor_port_t *nor)
+{
+    status_t result;
+
+    if(FLASH_OP_NONE == nor->pending_op)
+    {
+        return kStatus_Success;
+    }
+
+    result = flexspi_nor_Wait_Bus_If_Busy(base, nor);
+    if(kStatus_Success != result)
+    {
+        SFDP_DEBUG("%s at 0x%08lX did not complete.", (nor->pending_op == FLASH_OP_ERASE) ? "Erase" : "Program",
+                   FlexSPI_AHB_BASE + nor->base + nor->pending_addr);
+    }
+
+    nor->pending_op = FLASH_OP_NONE;
+
+    return result;
+}
+
+/**
+ * Run the sector map configuration detection commands of the part and select
+ * the map of its configuration. Each command reads one register byte through
+ * the ERASEBLOCK slot.
+ */
+static void flexspi_sector_map(FLEXSPI_Type *base, nor_port_t *nor)
+{
+    const sfdp_para *sfdp = &nor->flash->sfdp;
+    uint8_t config_id = 0;
+
+    if(sfdp->detect_num == 0) {
+        return;
+    }
+
+    for(uint8_t i = 0; i < sfdp->detect_num; i++) {
+        uint32_t seq_lut[4];
+        uint16_t instr[4];
+        uint8_t num = 0;
+        uint32_t readValue = 0;
+        flexspi_transfer_t flashXfer =
+        {
+            .deviceAddress = nor->base + (sfdp->detect[i].addr_bytes ? sfdp->detect[i].addr : 0),
+            .port = nor->port,
+            .cmdType = kFLEXSPI_Read,
+            .seqIndex = NOR_CMD_LUT_SEQ_IDX_ERASEBLOCK,
+            .SeqNumber = 1,
+            .data = &readValue,
+            .dataSize = 1,
+        };
+
+        /* the register address goes through the window of the part */
+        if(sfdp->detect[i].addr_bytes && sfdp->detect[i].addr >= nor->size) {
+            SFDP_DEBUG("FlexSPI port %d: sector map register 0x%08lX is out of reach.", nor->port, sfdp->detect[i].addr);
+            return;
+        }
+
+        instr[num++] = FLEXSPI_LUT_INSTR(kFLEXSPI_Command_SDR, kFLEXSPI_1PAD, sfdp->detect[i].cmd);
+        if(sfdp->detect[i].addr_bytes) {
+            instr[num++] = FLEXSPI_LUT_INSTR(kFLEXSPI_Command_RADDR_SDR, kFLEXSPI_1PAD, 8 * sfdp->detect[i].addr_bytes);
+        }
+        if(sfdp->detect[i].dummy) {
+            instr[num++] = FLEXSPI_LUT_INSTR(kFLEXSPI_Command_DUMMY_SDR, kFLEXSPI_1PAD, sfdp->detect[i].dummy);
+        }
+        instr[num++] = FLEXSPI_LUT_INSTR(kFLEXSPI_Command_READ_SDR, kFLEXSPI_1PAD, FLEXSPI_INSTRUCTION_OPERAND_ANY_NONE_ZERO_VALUE);
+        flexspi_lut_pack(seq_lut, instr, num);
+
+        flexspi_update_lut_seq(NOR_CMD_LUT_SEQ_IDX_ERASEBLOCK, seq_lut);
+        erase_block_type = 0;
+        if(kStatus_Success != FLEXSPI_TransferBlocking(base, &flashXfer)) {
+            SFDP_DEBUG("FlexSPI port %d: sector map detection failed.", nor->port);
+            return;
+        }
+
+        config_id = (config_id << 1) | (((uint8_t)readValue & sfdp->detect[i].mask) != 0);
+    }
+
+    if(SFDP_SUCCESS == sfdp_sector_map(nor->flash, config_id)) {
+        SFDP_DEBUG("FlexSPI port %d: sector map configuration 0x%02X, %d regions.", nor->port, config_id,
+                   sfdp->region_num);
+    }
+}
+
+#if FLEXSPI_OCTAL_DDR
+/**
+ * Send the SFDP command sequences that switch the part to octal DDR, each one
+ * a train of 1S bytes through the ERASEBLOCK slot, and rebuild its sequences
+ * and address window for 8D-8D-8D.
+ */
+static void flexspi_octal_enter(FLEXSPI_Type *base, nor_port_t *nor, flexspi_device_config_t *flash_config)
+{
+    static const uint8_t octal_seqs[] = {
+        NOR_CMD_LUT_SEQ_IDX_WRITEENABLE,
+        NOR_CMD_LUT_SEQ_IDX_READSTATUSREG,
+        NOR_CMD_LUT_SEQ_IDX_ERASECHIP,
+    };
+    const sfdp_para *sfdp = &nor->flash->sfdp;
+    uint32_t seq_lut[4];
+
+    if(!flexspi_octal_capable(nor->flash)) {
+        return;
+    }
+
+    for(uint8_t i = 0; i < sfdp->octal.seq_num; i++) {
+        uint16_t instr[SFDP_OCTAL_SEQ_BYTE_MAX];
+        flexspi_transfer_t flashXfer =
+        {
+            .deviceAddress = nor->base,
+            .port = nor->port,
+            .cmdType = kFLEXSPI_Command,
+            .seqIndex = NOR_CMD_LUT_SEQ_IDX_ERASEBLOCK,
+            .SeqNumber = 1,
+            .data = 0x00000000UL,
+            .dataSize = 0,
+        };
+
+        for(uint8_t j = 0; j < sfdp->octal.seq[i].len; j++) {
+            instr[j] = FLEXSPI_LUT_INSTR(kFLEXSPI_Command_SDR, kFLEXSPI_1PAD, sfdp->octal.seq[i].byte[j]);
+        }
+        flexspi_lut_pack(seq_lut, instr, sfdp->octal.seq[i].len);
+        flexspi_update_lut_seq(NOR_CMD_LUT_SEQ_IDX_ERASEBLOCK, seq_lut);
+        erase_block_type = 0;
+        if(kStatus_Success != FLEXSPI_TransferBlocking(base, &flashXfer)) {
+            SFDP_DEBUG("FlexSPI port %d: octal DDR command sequence %d failed.", nor->port, i + 1);
+            return;
+        }
+    }
+
+    /* from here on the part only answers 8D-8D-8D */
+    octal_flash = nor->flash;
+    for(uint8_t i = 0; i < sizeof(octal_seqs)/sizeof(octal_seqs[0]); i++) {
+        flexspi_octal_seq(nor->flash, octal_seqs[i], seq_lut);
+        flexspi_update_lut_seq(octal_seqs[i], seq_lut);
+    }
+    flexspi_octal_seq(nor->flash, nor->read_seq, seq_lut);
+    flexspi_update_lut_seq(nor->read_seq, seq_lut);
+    lut_flash = NULL;
+    flexspi_select_device(nor);
+
+#if (FLEXSPI_RX_SAMPLE_CLOCK == 3)
+    /* 8D-8D-8D reads are strobed by the DQS of the part */
+    flexspi_set_clock(CLOCK_GetDiv(kCLOCK_FlexspiDiv), kFLEXSPI_ReadSampleClkExternalInputFromDqsPad);
+#endif
+
+    /* a configuration register write may still be running */
+    flexspi_nor_Wait_Bus_If_Busy(base, nor);
+
+    /* 4-byte addresses reach the whole part */
+    flash_config->flashSize = flexspi_flash_size(nor->flash);
+    flash_config->ARDSeqIndex = nor->read_seq;
+    flexspi_config_port(flash_config, nor->port);
+    nor->size = flash_config->flashSize * 1024U;
+    nor->program_seq = NOR_CMD_LUT_SEQ_IDX_PAGEPROGRAM_SINGLE;
+
+    SFDP_DEBUG("FlexSPI port %d: octal DDR, read command 0x%02X with %d dummy clocks, %ld KB.", nor->port,
+               sfdp->octal.read_cmd, sfdp->octal.read_dummy, nor->size / 1024U);
+}
+
+/**
+ * Reset the part from octal DDR to 1S-1S-1S by the 66h/99h soft reset, if it has one.
+ */
+static void flexspi_octal_exit(FLEXSPI_Type *base, nor_port_t *nor)
+{
+    static const uint8_t reset_cmds[] = {SFDP_CMD_ENABLE_RESET, SFDP_CMD_RESET};
     flexspi_transfer_t flashXfer =
     {
-        .deviceAddress = 0x00000000UL,
-        .port = kFLEXSPI_PortA1,
+        .deviceAddress = nor->base,
+        .port = nor->port,
+        .cmdType = kFLEXSPI_Command,
+        .seqIndex = NOR_CMD_LUT_SEQ_IDX_ERASEBLOCK,
+        .SeqNumber = 1,
+        .data = 0x00000000UL,
+        .dataSize = 0,
+    };
+
+    if(!flexspi_octal(nor->flash)) {
+        return;
+    }
+    if(!(nor->flash->sfdp_table->DWORD16.value & SFDP_SOFT_RESET_66_99)) {
+        SFDP_DEBUG("FlexSPI port %d: no soft reset, the part stays in octal DDR until power-up.", nor->port);
+        return;
+    }
+
+    for(uint8_t i = 0; i < sizeof(reset_cmds)/sizeof(reset_cmds[0]); i++) {
+        uint32_t seq_lut[4] = { flexspi_octal_cmd(nor->flash, reset_cmds[i]) };
+
+        flexspi_update_lut_seq(NOR_CMD_LUT_SEQ_IDX_ERASEBLOCK, seq_lut);
+        FLEXSPI_TransferBlocking(base, &flashXfer);
+    }
+    erase_block_type = 0;
+    octal_flash = NULL;
+
+#if (FLEXSPI_RX_SAMPLE_CLOCK == 3)
+    /* no DQS in 1S-1S-1S */
+    flexspi_set_clock(CLOCK_GetDiv(kCLOCK_FlexspiDiv), kFLEXSPI_ReadSampleClkLoopbackFromDqsPad);
+#endif
+
+    SFDP_DEBUG("FlexSPI port %d: back to 1S-1S-1S.", nor->port);
+}
+#endif
+
+static status_t flexspi_nor_Read_Register(FLEXSPI_Type *base, nor_port_t *nor, uint32_t seq, uint8_t *value)
+{
+    uint32_t readValue = 0;
+    status_t result;
+    flexspi_transfer_t flashXfer =
+    {
+        .deviceAddress = nor->base,
+        .port = nor->port,
+        .cmdType = kFLEXSPI_Read,
+    	.seqIndex = seq,
+        .SeqNumber = 1,
+        .data = &readValue,
+        .dataSize = 1,
+    };
+
+    result = FLEXSPI_TransferBlocking(base, &flashXfer);
+    *value = (uint8_t)readValue;
+
+    return result;
+}
+
+#if !NOR_MULTI_DEVICE
+static status_t flexspi_nor_Read_SFDP(FLEXSPI_Type *base, nor_port_t *nor, uint32_t address, uint32_t *data, uint32_t size)
+{
+    flexspi_transfer_t flashXfer =
+    {
+        .deviceAddress = nor->base + address,
+        .port = nor->port,
+        .cmdType = kFLEXSPI_Read,
+    	.seqIndex = NOR_CMD_LUT_SEQ_IDX_READ_SFDP,
+        .SeqNumber = 1,
+        .data = data,
+        .dataSize = size,
+    };
+
+    return FLEXSPI_TransferBlocking(base, &flashXfer);
+}
+#endif
+
+static status_t flexspi_nor_Write_Enable(FLEXSPI_Type *base, nor_port_t *nor)
+{
+    status_t result = kStatus_Success;
+    flexspi_transfer_t flashXfer =
+    {
+        .deviceAddress = nor->base,
+        .port = nor->port,
         .cmdType = kFLEXSPI_Command,
     	.seqIndex = NOR_CMD_LUT_SEQ_IDX_WRITEENABLE,
         .SeqNumber = 1,
@@ -423,7 +2415,53 @@ static status_t flexspi_nor_Write_Enable(FLEXSPI_Type *base)
     return kStatus_Success;
 }
 
-static status_t flexspi_nor_Wait_Bus_If_Busy(FLEXSPI_Type *base)
+/**
+ * End the continuous read of checksum(): Fh on IO0-3 over the address and mode
+ * clocks through the ERASEBLOCK slot, then the usual AHB read sequences and a
+ * software reset that forgets the JMP_ON_CS instruction pointer.
+ */
+static status_t flexspi_nor_Exit_Continuous(FLEXSPI_Type *base)
+{
+    status_t result = kStatus_Success;
+    uint32_t seq_lut[4];
+
+    for(uint8_t i = 0; i < nor_port_num; i++) {
+        nor_port_t *nor = &nor_port[i];
+        /* a byte is two clocks on four lines: 8 clocks with 3-byte addresses, 10 with 4-byte */
+        const uint8_t num = flexspi_addr_bits(nor->flash) / 8U + 1U;
+        uint16_t instr[5];
+        flexspi_transfer_t flashXfer =
+        {
+            .deviceAddress = nor->base,
+            .port = nor->port,
+            .cmdType = kFLEXSPI_Command,
+            .seqIndex = NOR_CMD_LUT_SEQ_IDX_ERASEBLOCK,
+            .SeqNumber = 1,
+            .data = 0x00000000UL,
+            .dataSize = 0,
+        };
+
+        for(uint8_t j = 0; j < num; j++) {
+            instr[j] = FLEXSPI_LUT_INSTR(kFLEXSPI_Command_SDR, kFLEXSPI_4PAD, 0xFF);
+        }
+        flexspi_lut_pack(seq_lut, instr, num);
+        flexspi_update_lut_seq(NOR_CMD_LUT_SEQ_IDX_ERASEBLOCK, seq_lut);
+        erase_block_type = 0;
+        if(kStatus_Success != FLEXSPI_TransferBlocking(base, &flashXfer)) {
+            SFDP_DEBUG("FlexSPI port %d: continuous read exit failed.", nor->port);
+            result = kStatus_Fail;
+        }
+
+        flexspi_device_seq(nor->flash, nor->read_seq, seq_lut);
+        flexspi_update_lut_seq(nor->read_seq, seq_lut);
+    }
+
+    FLEXSPI_SoftwareReset(base);
+
+    return result;
+}
+
+static status_t flexspi_nor_Wait_Bus_If_Busy(FLEXSPI_Type *base, nor_port_t *nor)
 {
     /* Wait result ready. */
     bool isBusy = true;
@@ -431,8 +2469,8 @@ static status_t flexspi_nor_Wait_Bus_If_Busy(FLEXSPI_Type *base)
     status_t result;
     flexspi_transfer_t flashXfer =
     {
-        .deviceAddress = 0x00000000UL,
-        .port = kFLEXSPI_PortA1,
+        .deviceAddress = nor->base,
+        .port = nor->port,
         .cmdType = kFLEXSPI_Read,
     	.seqIndex = NOR_CMD_LUT_SEQ_IDX_READSTATUSREG,
         .SeqNumber = 1,
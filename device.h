@@ -22,6 +22,9 @@
 #elif defined(CPU_MIMXRT1052)
 	#include "MIMXRT1052.h"
 #endif
+
+#include "fsl_flexspi.h"
+#include "sfdp.h"
      
 ////////////////////////////////////////////////////////////////////////////////
 /*
@@ -29,12 +32,142 @@
  */
      
 #define FLASH_SIZE 		0x1000          // 4MBytes
+
+//1: FlashWrite returns while the last page program is still running, the next
+//   flashloader entry waits for it. Overlaps tPP with the debugger's SWD transfer.
+//0: FlashWrite waits for its last page program before it returns.
+#ifndef DEFERRED_WRITE_COMPLETION
+#define DEFERRED_WRITE_COMPLETION       1
+#endif
+#if (DEFERRED_WRITE_COMPLETION != 0) && (DEFERRED_WRITE_COMPLETION != 1)
+#error "DEFERRED_WRITE_COMPLETION must be 0 or 1"
+#endif
+//1: FlashErase returns while the last erase is still running, the same way.
+//0: FlashErase waits for its last erase before it returns.
+#ifndef DEFERRED_ERASE_COMPLETION
+#define DEFERRED_ERASE_COMPLETION       1
+#endif
+#if (DEFERRED_ERASE_COMPLETION != 0) && (DEFERRED_ERASE_COMPLETION != 1)
+#error "DEFERRED_ERASE_COMPLETION must be 0 or 1"
+#endif
+
+//Gang programming: up to 4 identical parts on FlexSPI ports A1, A2, B1, B2 get the same image.
+//A port joins when its SFDP data matches the part on A1. Ports A2/B1/B2 use the SD_B0/SD_B1 pads.
+#ifndef FLEXSPI_GANG_PORT_NUM
+#define FLEXSPI_GANG_PORT_NUM           1
+#endif
+#if (FLEXSPI_GANG_PORT_NUM < 1) || (FLEXSPI_GANG_PORT_NUM > 4)
+#error "FLEXSPI_GANG_PORT_NUM must be 1..4"
+#endif
+
+//1: two identical quad parts on FlexSPI A1 and B1 form one array in FlexSPI parallel mode.
+//AHB reads fetch from both parts at once, even bytes from A1 and odd bytes from B1, so
+//addresses, erase blocks and pages of the array are twice those of one part.
+//Programs and erases address each part on its own, status polling covers both. The KSDK
+//FLEXSPI_TransferBlocking rewrites IPCR1 without IPAREN, so a page is split in software and
+//programmed on A1 and then on B1 over two IP commands: the data phases do not overlap, only
+//the page program time of one part runs while the other part is being programmed.
+#ifndef FLEXSPI_PARALLEL_MODE
+#define FLEXSPI_PARALLEL_MODE           0
+#endif
+#if FLEXSPI_PARALLEL_MODE && (FLEXSPI_GANG_PORT_NUM > 1)
+#error "FLEXSPI_PARALLEL_MODE and FLEXSPI_GANG_PORT_NUM > 1 exclude each other"
+#endif
+
+//1: an octal part on FlexSPI A1 is switched to octal DDR (8D-8D-8D) after its SFDP read, when
+//it has the xSPI profile 1.0 and octal DDR command sequence tables. Its upper data lines use
+//the port B data pads (FlexSPI combination mode), no device is probed on B1/B2. The part is
+//reset to 1S-1S-1S at signoff.
+#ifndef FLEXSPI_OCTAL_DDR
+#define FLEXSPI_OCTAL_DDR               0
+#endif
+#if FLEXSPI_OCTAL_DDR && (FLEXSPI_PARALLEL_MODE || (FLEXSPI_GANG_PORT_NUM > 1))
+#error "FLEXSPI_OCTAL_DDR takes the port B data pads, no gang or parallel mode"
+#endif
+
+//1: AHB reads of quad parts (checksum, blank checks, C-SPY's read-back) use the 1-4-4 DTR read
+//EDh when SFDP reports DTR and 1-4-4 fast read, parts above 16 MB need EEh in their 4-byte address
+//instruction table. checksum() raises the FlexSPI root clock so the DDR SCK gets close to the SDR SCK.
+#ifndef FLEXSPI_DTR_READ
+#define FLEXSPI_DTR_READ                0
+#endif
+//Dummy clocks of the DTR read after its mode byte. 0: the 1-4-4 mode + wait clocks of SFDP less
+//the mode byte clock, the DTR latency of Macronix parts. Winbond DTR parts need 7.
+#ifndef FLEXSPI_DTR_READ_DUMMY
+#define FLEXSPI_DTR_READ_DUMMY          0
+#endif
+//1: checksum() reads quad parts whose SFDP reports 0-4-4 mode (entry by mode bits A5h, exit by Fh on
+//IO0-3) in continuous read: the first AHB burst sends the 1-4-4 read with mode bits A5h, the following
+//bursts start at the address. The parts leave continuous read before checksum() returns, programs,
+//erases and C-SPY's own reads find them as usual.
+#ifndef FLEXSPI_CONTINUOUS_READ
+#define FLEXSPI_CONTINUOUS_READ         0
+#endif
+//FlexSPI read sample clock: 0 internal loopback, 1 loopback from the DQS pad, 3 DQS driven by the
+//flash (octal DDR only, reads before 8D-8D-8D sample on the DQS pad loopback). DDR reads above 30 MHz
+//SCK need 1 or 3. The port A DQS pad is the port B chip select SS0.
+#ifndef FLEXSPI_RX_SAMPLE_CLOCK
+#if FLEXSPI_DTR_READ || FLEXSPI_OCTAL_DDR
+#define FLEXSPI_RX_SAMPLE_CLOCK         1
+#else
+#define FLEXSPI_RX_SAMPLE_CLOCK         0
+#endif
+#endif
+#if (FLEXSPI_RX_SAMPLE_CLOCK != 0) && (FLEXSPI_RX_SAMPLE_CLOCK != 1) && (FLEXSPI_RX_SAMPLE_CLOCK != 3)
+#error "FLEXSPI_RX_SAMPLE_CLOCK must be 0, 1 or 3"
+#endif
+#if (FLEXSPI_RX_SAMPLE_CLOCK == 3) && !FLEXSPI_OCTAL_DDR
+#error "quad parts drive no DQS, FLEXSPI_RX_SAMPLE_CLOCK 3 needs FLEXSPI_OCTAL_DDR"
+#endif
+
+//Otherwise every flash_table entry (sfdp_cfg.h) is a device of its own on the next chip select,
+//the address windows of the devices found follow each other from 0x60000000.
+#if FLEXSPI_PARALLEL_MODE
+#define NOR_PORT_NUM                    2
+#define NOR_PARALLEL_FACTOR             2
+#define NOR_PARALLEL_PAGE_MAX           256             // bytes per part and page program
+#define NOR_MULTI_DEVICE                0
+#elif (FLEXSPI_GANG_PORT_NUM > 1)
+#define NOR_PORT_NUM                    FLEXSPI_GANG_PORT_NUM
+#define NOR_PARALLEL_FACTOR             1
+#define NOR_MULTI_DEVICE                0
+#else
+#define NOR_PORT_NUM                    SFDP_FLASH_DEVICE_NUM
+#define NOR_PARALLEL_FACTOR             1
+#define NOR_MULTI_DEVICE                1
+#endif
+#if (NOR_PORT_NUM > 4)
+#error "FlexSPI has 4 chip selects, SFDP_FLASH_DEVICE_NUM must be 1..4"
+#endif
+//More devices mux the pads of chip selects A2, B1 and B2 only for their probe and keep them
+//when a flash answers, octal DDR keeps the port B data pads as DATA4..7 of port A.
+#define NOR_PROBE_IOMUX                 (NOR_MULTI_DEVICE && (NOR_PORT_NUM > 1) && !FLEXSPI_OCTAL_DDR)
+#if (FLEXSPI_RX_SAMPLE_CLOCK != 0) && !FLEXSPI_OCTAL_DDR && ((NOR_PORT_NUM > 2) || FLEXSPI_PARALLEL_MODE)
+#error "the port A DQS pad is the chip select of port B1, FLEXSPI_RX_SAMPLE_CLOCK must be 0"
+#endif
+
+//3-byte addresses reach 16MB, larger parts need their 4-byte address instruction table (SFDP 0xFF84)
+#define NOR_3BYTE_ADDR_SIZE             (16UL << 20)
+
+//FlexRAM, 32KB banks shared by ITCM/DTCM/OCRAM. OCRAM banks are mapped from OCRAM_BASE.
+//The default bank configuration is the unfused one the .icf files are laid out for.
+#define OCRAM_BASE                      0x20200000U
+#define FLEXRAM_BANK_SIZE               0x8000U
+#define FLEXRAM_BANK_OCRAM              1U
+#if defined(CPU_MIMXRT1021)
+#define FLEXRAM_BANK_NUM                8               // 64KB ITCM, 64KB DTCM, 128KB OCRAM
+#define FLEXRAM_DEFAULT_BANK_CFG        0x0000FA55U
+#else
+#define FLEXRAM_BANK_NUM                16              // 128KB ITCM, 128KB DTCM, 256KB OCRAM
+#define FLEXRAM_DEFAULT_BANK_CFG        0xFFAA5555U
+#endif
      
 //LUT index
 #define NOR_CMD_LUT_SEQ_IDX_READ_NORMAL 			0
 //#define NOR_CMD_LUT_SEQ_IDX_READ_FAST                         1
+#define NOR_CMD_LUT_SEQ_IDX_READ_FAST_QUAD_DEV1 		1       // AHB read of flash_table[1]
 #define NOR_CMD_LUT_SEQ_IDX_READ_FAST_QUAD 			2
-//#define NOR_CMD_LUT_SEQ_IDX_READ_EA_STATUS 			3
+#define NOR_CMD_LUT_SEQ_IDX_READ_QE_REG 			3
 #define NOR_CMD_LUT_SEQ_IDX_WRITEENABLE 			4
 
 #define NOR_CMD_LUT_SEQ_IDX_ERASESECTOR 			5
@@ -42,13 +175,15 @@
 
 #define NOR_CMD_LUT_SEQ_IDX_ERASECHIP				7 		 		
 #define NOR_CMD_LUT_SEQ_IDX_PAGEPROGRAM_SINGLE 		        8
-//#define NOR_CMD_LUT_SEQ_IDX_PAGEPROGRAM_QUAD 		        9
+#define NOR_CMD_LUT_SEQ_IDX_PAGEPROGRAM_QUAD 		        9
 //#define NOR_CMD_LUT_SEQ_IDX_READID                            9
 #define NOR_CMD_LUT_SEQ_IDX_WRITESTATUSREG 			10
 //#define NOR_CMD_LUT_SEQ_IDX_ENTERQPI 				11
-//#define NOR_CMD_LUT_SEQ_IDX_EXITQPI 				12
+#define NOR_CMD_LUT_SEQ_IDX_READ_FAST_QUAD_DEV2 		11      // AHB read of flash_table[2]
+#define NOR_CMD_LUT_SEQ_IDX_READ_SFDP 				12
 #define NOR_CMD_LUT_SEQ_IDX_READSTATUSREG 			13
 //#define NOR_CMD_LUT_SEQ_IDX_WRITE_EA_STATUS			14
+#define NOR_CMD_LUT_SEQ_IDX_READ_FAST_QUAD_DEV3 		14      // AHB read of flash_table[3]
 #define NOR_CMD_LUT_SEQ_IDX_WRITE_ENABLE_VOLATILE               15
      
 //Control Definitions
@@ -57,6 +192,18 @@
      
 //FLEXSPI Instruction operand[7:0]
 #define FLEXSPI_INSTRUCTION_OPERAND_ANY_NONE_ZERO_VALUE         0x04
+
+//Quad page program instructions, SFDP basic table does not describe them
+//{JEDEC manufacturer ID, opcode, address pads}: 1-1-4 or 1-4-4
+#define QUAD_PAGE_PROGRAM_TABLE                                 \
+{                                                               \
+    {0xEF, 0x32, kFLEXSPI_1PAD},    /* Winbond */               \
+    {0xC8, 0x32, kFLEXSPI_1PAD},    /* GigaDevice */            \
+    {0x9D, 0x32, kFLEXSPI_1PAD},    /* ISSI */                  \
+    {0x20, 0x32, kFLEXSPI_1PAD},    /* Micron */                \
+    {0x01, 0x32, kFLEXSPI_1PAD},    /* Cypress/Spansion */      \
+    {0xC2, 0x38, kFLEXSPI_4PAD},    /* Macronix */              \
+}
      
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -68,32 +215,62 @@ typedef struct{
   uint32_t (*init)(void *base_of_flash);
 #endif /* USE_ARGC_ARGV */
   uint32_t (*write)(uint32_t addr,uint32_t count,char const *buffer);
-  uint32_t (*erase)(void *block_start);
+  uint32_t (*erase)(void *block_start, uint32_t size);
   uint32_t (*erase_chip)(void);
+  uint32_t (*checksum)(void const *begin, uint32_t count);
   uint32_t (*signoff)(void);
+  uint32_t (*layout)(char *layout, uint32_t *page_size);
+  uint32_t (*buffer_size)(uint32_t start, uint32_t size);
 } device_t;
 
-/** necessary functions as device_t call-backs **/
-#if USE_ARGC_ARGV
-static uint32_t init(void *base_of_flash,int argc, char const *argv[]);
-#else
-static uint32_t init(void *base_of_flash);
-#endif /* USE_ARGC_ARGV */
-static uint32_t write(uint32_t addr,uint32_t count,char const *buffer);
-static uint32_t erase(void *block_start);
-static uint32_t erase_chip(void);
-static uint32_t signoff(void);
+/*device statistics, reset by init and reported at signoff*/
+typedef struct{
+  uint32_t pages_programmed;
+  uint32_t pages_skipped;               /* all 0xFF, nothing to program */
+} device_stats_t;
 
-extern const device_t flash_device;
+extern device_stats_t device_stats;
 
-////////////////////////////////////////////////////////////////////////////////
+/*flash operation started and not waited for yet*/
+typedef enum{
+  FLASH_OP_NONE,
+  FLASH_OP_PROGRAM,
+  FLASH_OP_ERASE,
+} flash_op_t;
+
+/*QE bit left by signoff: --setQE, --clrQE, or as init found it*/
+typedef enum{
+  QE_KEEP,
+  QE_SET,
+  QE_CLEAR,
+} qe_request_t;
+
+/*one part of the gang or of the parallel array, or one device*/
+typedef struct{
+  flexspi_port_t port;
+  uint32_t base;                        /* FlexSPI address of the part */
+  uint32_t size;                        /* bytes, address window of a device */
+  sfdp_flash *flash;                    /* SFDP data the LUT sequences are built from */
+  uint8_t read_seq;                     /* AHB read sequence */
+  uint8_t program_seq;                  /* page program sequence, single or quad */
+  bool qe_set_by_init;                  /* QE was clear, signoff clears it again unless --setQE */
+  bool qe_volatile;                     /* init set QE in the volatile status register only */
+  bool read_dtr;                        /* AHB read sequence is the 1-4-4 DTR read */
+  bool read_continuous;                 /* checksum() reads in continuous read */
+  flash_op_t pending_op;
+  uint32_t pending_addr;
+} nor_port_t;
+
+/*quad page program table entry*/
+typedef struct{
+  uint8_t mf_id;
+  uint8_t cmd;
+  uint8_t addr_pads;
+} quad_program_t;
 
-static void flexspi_set_iomux(void);
-static void flexspi_init(void);
-static void flexspi_set_lut(void);
+extern const device_t flash_device;
 
-/** internal functions to check status **/
-static status_t flexspi_nor_Erase_Sector(FLEXSPI_Type *base, uint32_t address);
-static status_t flexspi_nor_Write_Page(FLEXSPI_Type *base, uint32_t dstAddr, uint32_t *src);
-static status_t flexspi_nor_Write_Enable(FLEXSPI_Type *base);
-static status_t flexspi_nor_Wait_Bus_If_Busy(FLEXSPI_Type *base);
+#if USE_ARGC_ARGV
+/* Flashloader_IMXRT.c */
+const char* FlFindOption(char* option, int with_value, int argc, char const* argv[]);
+#endif
@@ -0,0 +1,36 @@
+/*************************************************************************
+ *
+ * FlexSPI LUT sequence update shared by the loader and the SFDP port
+ *
+ **************************************************************************/
+#ifndef _FLEXSPI_LUT_H_
+#define _FLEXSPI_LUT_H_
+
+#include <stdint.h>
+#include "fsl_flexspi.h"
+
+/* LUTKEY value, private to fsl_flexspi.c */
+#ifndef FLEXSPI_LUT_KEY_VAL
+#define FLEXSPI_LUT_KEY_VAL (0x5AF05AF0ul)
+#endif
+
+/**
+ * Reprogram the four LUT words of one sequence.
+ *
+ * FLEXSPI_UpdateLUT() of the RT1052 driver copies count - index words to
+ * LUT[index], the RT1021 driver count words, so with index > 0 no count is
+ * right for both. The LUT is unlocked and written here directly instead.
+ */
+static inline void flexspi_lut_write_seq(FLEXSPI_Type *base, uint32_t seq, const uint32_t *seq_lut) {
+    while(!FLEXSPI_GetBusIdleStatus(base));
+
+    base->LUTKEY = FLEXSPI_LUT_KEY_VAL;
+    base->LUTCR = FLEXSPI_LUTCR_UNLOCK_MASK;
+    for(uint32_t i = 0; i < 4; i++) {
+        base->LUT[4*seq + i] = seq_lut[i];
+    }
+    base->LUTKEY = FLEXSPI_LUT_KEY_VAL;
+    base->LUTCR = FLEXSPI_LUTCR_LOCK_MASK;
+}
+
+#endif
@@ -1,11 +1,13 @@
 #include "sfdp.h"
 
 void NMI_Handler(void) {
+    SFDP_LOG_SYNC();
     SFDP_DEBUG("NMI has occured in Flashloader.");
     while(1);
 }
 
 void DefaultISR(void) {
+    SFDP_LOG_SYNC();
     SFDP_DEBUG("Undefined Interrupt has occured in Flashloader.");
     while(1);
 }
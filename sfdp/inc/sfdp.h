@@ -33,5 +33,8 @@
 
 extern void sfdp_log_debug(const char *file, const long line, const char *format, ...);
 sfdp_err sfdp_init(void);
+sfdp_err sfdp_device_init(sfdp_flash *flash);
+const sfdp_param_t *sfdp_find_param(const sfdp_flash *flash, uint16_t id);
+sfdp_err sfdp_sector_map(sfdp_flash *flash, uint8_t config_id);
 
 #endif
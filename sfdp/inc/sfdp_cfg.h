@@ -36,7 +36,34 @@
 
 ////////////////////////////////////////////////////////////////////////////////
 
-/* flashͺűע, Ӱ칦 */
+/* flash豸, nΪFlexSPInƬѡ(A1, A2, B1, B2)ϵflash, 4; nameע */
+/* 0SFDP_PORT_LPSPIͨFlexSPI A1LPSPI2ȡSFDP, ͨFlexSPIȡ, δӵƬѡ */
+/* 豸ĵַڰƬѡ˳0x60000000֮ */
+/* ĬΪ1, ֻʹA1ϵflash; Ϊ2~4ʱŻ̽A2, B1, B2, Ž̽ڼ估ҵflashΪFlexSPI */
+#ifndef SFDP_FLASH_DEVICE_NUM
+#define SFDP_FLASH_DEVICE_NUM   1
+#endif
+
+/* false: 0ֱͨFlexSPI A1ȡSFDP, ʡȥLPSPI2ĳʼŸõл */
+/* true: ͨLPSPI2ȡ, FlexSPI A1, flexspi_init()лFlexSPI */
+#ifndef SFDP_PORT_LPSPI
+#define SFDP_PORT_LPSPI         false
+#endif
+
+/* 豸SFDPCRCУ鱣__no_init RAM, ٴγʼʱJEDEC IDͬ豸ٶȡSFDP */
+/* JEDEC IDͬSFDPͬʱ, ϵΪfalse */
+/* ˿ڳʼ(ʱ//LPUART1/FlexSPILPSPI2)JEDEC IDȡճ; gang/ģʽ˿ڲʹû */
+#ifndef SFDP_CACHE
+#define SFDP_CACHE              true
+#endif
+
+/* LOGд뻷λ, eDMAں̨˵LPUART1; ʱж */
+/* FlashSignoffʱȴ, ӡ; false: ÿLOGֱ */
+/* λλeDMAɷʵRAM(OCRAM); 쳣в, ֱдLPUART1 */
+#ifndef SFDP_LOG_ASYNC
+#define SFDP_LOG_ASYNC          true
+#endif
+
 enum {
     SFDP_W25QxxxJV_DEVICE_INDEX = 0,
     SFDP_W25QxxxFV_DEVICE_INDEX = 1
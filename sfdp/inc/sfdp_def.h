@@ -55,12 +55,29 @@
     #define SFDP_INFO(...)
 #endif
 
+/* wait until every log line queued so far is sent */
+extern void sfdp_log_flush(void);
+#if SFDP_DEBUG_MODE == true
+    #define SFDP_LOG_FLUSH() sfdp_log_flush()
+#else
+    #define SFDP_LOG_FLUSH()
+#endif
+
+/* send every later log line blocking, bypassing the ring, for fault handlers */
+extern void sfdp_log_sync(void);
+#if SFDP_DEBUG_MODE == true
+    #define SFDP_LOG_SYNC() sfdp_log_sync()
+#else
+    #define SFDP_LOG_SYNC()
+#endif
+
 /* assert for developer. */
 #if SFDP_DEBUG_MODE == true
     #define SFDP_ASSERT(EXPR)                                                      \
     if (!(EXPR))                                                                   \
     {                                                                              \
         SFDP_DEBUG("(%s) has assert failed at %s.", #EXPR, __FUNCTION__);          \
+        SFDP_LOG_FLUSH();                                                          \
         while (1);                                                                 \
     }
 #else
@@ -81,6 +98,74 @@
 /* maximum number of erase type support on JESD216 (V1.0) */
 #define SFDP_SFDP_ERASE_TYPE_MAX_NUM                4
 
+/* maximum number of parameter headers kept per device, the basic one included */
+#ifndef SFDP_PARAM_MAX_NUM
+#define SFDP_PARAM_MAX_NUM                          8
+#endif
+
+/* bytes of the SFDP region kept per device from address 0, parameter tables past it are not read */
+#ifndef SFDP_IMAGE_SIZE
+#define SFDP_IMAGE_SIZE                             512
+#endif
+
+/* sector map configuration detection commands and regions kept per device */
+#ifndef SFDP_SECTOR_MAP_CMD_MAX_NUM
+#define SFDP_SECTOR_MAP_CMD_MAX_NUM                 4
+#endif
+
+#ifndef SFDP_SECTOR_MAP_REGION_MAX_NUM
+#define SFDP_SECTOR_MAP_REGION_MAX_NUM              8
+#endif
+
+/* command sequences to enter octal DDR mode kept per device */
+#ifndef SFDP_OCTAL_SEQ_MAX_NUM
+#define SFDP_OCTAL_SEQ_MAX_NUM                      4
+#endif
+
+/* largest read the SPI port takes in one transfer, 0: no limit */
+#ifndef SFDP_READ_DATA_MAX
+#define SFDP_READ_DATA_MAX                          0
+#endif
+
+/* the port reads flash_table[0] through LPSPI2 on the pins of FlexSPI port A1 instead of FlexSPI itself, set in sfdp_cfg.h */
+#ifndef SFDP_PORT_LPSPI
+#error "SFDP_PORT_LPSPI must be defined in sfdp_cfg.h"
+#endif
+
+/* keep the parameters read from every device in no-init RAM, a later init of a device with the same JEDEC ID takes
+   them from there. Set in sfdp_cfg.h only, a default here could differ from it in another translation unit. */
+#ifndef SFDP_CACHE
+#error "SFDP_CACHE must be defined in sfdp_cfg.h"
+#endif
+
+/* log lines are queued in a ring that eDMA copies to LPUART1, the caller does not wait for the UART, set in sfdp_cfg.h */
+#ifndef SFDP_LOG_ASYNC
+#error "SFDP_LOG_ASYNC must be defined in sfdp_cfg.h"
+#endif
+
+/* bytes of the log ring, a power of two no larger than the eDMA major loop count (32767) */
+#ifndef SFDP_LOG_RING_SIZE
+#define SFDP_LOG_RING_SIZE                          4096
+#endif
+
+/* eDMA channel fed by the LPUART1 transmit request */
+#ifndef SFDP_LOG_DMA_CHANNEL
+#define SFDP_LOG_DMA_CHANNEL                        0
+#endif
+
+/* parameter IDs (ID MSB << 8 | ID LSB) of the JEDEC defined tables, ID MSB of a vendor table is not FFh */
+#define SFDP_PARAM_ID_BASIC                         0xFF00
+#define SFDP_PARAM_ID_SECTOR_MAP                    0xFF81
+#define SFDP_PARAM_ID_RPMC                          0xFF03
+#define SFDP_PARAM_ID_4BYTE_ADDR                    0xFF84
+#define SFDP_PARAM_ID_XSPI_PROFILE_1                0xFF05
+#define SFDP_PARAM_ID_XSPI_PROFILE_2                0xFF06
+#define SFDP_PARAM_ID_SCCR_MAP                      0xFF87
+#define SFDP_PARAM_ID_SCCR_MAP_MULTI_CHIP           0xFF88
+#define SFDP_PARAM_ID_SCCR_MAP_XSPI_2               0xFF09
+#define SFDP_PARAM_ID_OCTAL_DDR_SEQ                 0xFF0A
+#define SFDP_PARAM_ID_IS_VENDOR(id)                 (((id) >> 8) != 0xFF)
+
 /*
  * all defined supported command
  */
@@ -152,6 +237,90 @@
 #define SFDP_CMD_EXIT_4B_ADDRESS_MODE                  0xE9
 #endif
 
+/* 1-4-4 DTR read, SFDP reports DTR support (DWORD1) but not its instruction */
+#ifndef SFDP_CMD_DTR_READ_144
+#define SFDP_CMD_DTR_READ_144                          0xED
+#endif
+
+/* instructions with 4-byte address, independent of the address mode */
+#ifndef SFDP_CMD_4B_PAGE_PROGRAM
+#define SFDP_CMD_4B_PAGE_PROGRAM                       0x12
+#endif
+
+#ifndef SFDP_CMD_4B_QUAD_PAGE_PROGRAM_114
+#define SFDP_CMD_4B_QUAD_PAGE_PROGRAM_114              0x34
+#endif
+
+#ifndef SFDP_CMD_4B_QUAD_PAGE_PROGRAM_144
+#define SFDP_CMD_4B_QUAD_PAGE_PROGRAM_144              0x3E
+#endif
+
+#ifndef SFDP_CMD_4B_FAST_READ_114
+#define SFDP_CMD_4B_FAST_READ_114                      0x6C
+#endif
+
+#ifndef SFDP_CMD_4B_FAST_READ_144
+#define SFDP_CMD_4B_FAST_READ_144                      0xEC
+#endif
+
+#ifndef SFDP_CMD_4B_DTR_READ_144
+#define SFDP_CMD_4B_DTR_READ_144                       0xEE
+#endif
+
+/* DWORD1 of the 4-byte address instruction table, 1: instruction supported */
+#define SFDP_4B_READ_111                               (1UL << 0)
+#define SFDP_4B_FAST_READ_111                          (1UL << 1)
+#define SFDP_4B_FAST_READ_112                          (1UL << 2)
+#define SFDP_4B_FAST_READ_122                          (1UL << 3)
+#define SFDP_4B_FAST_READ_114                          (1UL << 4)
+#define SFDP_4B_FAST_READ_144                          (1UL << 5)
+#define SFDP_4B_PAGE_PROGRAM_111                       (1UL << 6)
+#define SFDP_4B_PAGE_PROGRAM_114                       (1UL << 7)
+#define SFDP_4B_PAGE_PROGRAM_144                       (1UL << 8)
+#define SFDP_4B_ERASE_TYPE_1                           (1UL << 9)    /* types 2..4 follow */
+#define SFDP_4B_DTR_READ_111                           (1UL << 13)
+#define SFDP_4B_DTR_READ_122                           (1UL << 14)
+#define SFDP_4B_DTR_READ_144                           (1UL << 15)
+
+/* sector map table (JESD216B), DWORD1 of every descriptor */
+#define SFDP_SMPT_DESC_END                             (1UL << 0)    /* last descriptor of the table */
+#define SFDP_SMPT_DESC_MAP                             (1UL << 1)    /* 1: map, 0: configuration detection command */
+#define SFDP_SMPT_CMD_INSTR(d)                         (((d) >> 8) & 0xFF)
+#define SFDP_SMPT_CMD_DUMMY(d)                         (((d) >> 16) & 0x0F)    /* 0Fh: variable */
+#define SFDP_SMPT_CMD_ADDR_LEN(d)                      (((d) >> 22) & 0x03)    /* 0: none, 1: 3 bytes, 2: 4 bytes, 3: current mode */
+#define SFDP_SMPT_CMD_MASK(d)                          (((d) >> 24) & 0xFF)
+#define SFDP_SMPT_MAP_ID(d)                            (((d) >> 8) & 0xFF)
+#define SFDP_SMPT_MAP_REGIONS(d)                       ((((d) >> 16) & 0xFF) + 1)
+#define SFDP_SMPT_REGION_SIZE(r)                       ((((r) >> 8) + 1) * 256)
+#define SFDP_SMPT_REGION_TYPES(r)                      ((r) & 0x0F)    /* bit n: erase type n + 1 */
+
+/* xSPI profile 1.0 table (JESD216C) */
+#define SFDP_XSPI_READ_FAST_CMD(d1)                    (((d1) >> 8) & 0xFF)    /* DWORD1, 8D-8D-8D fast read */
+#define SFDP_XSPI_RDSR_DUMMY_8                         (1UL << 28)   /* DWORD1, 0: 4 dummy clocks */
+#define SFDP_XSPI_RDSR_ADDR_4                          (1UL << 29)   /* DWORD1, 0: no address */
+#define SFDP_XSPI_DUMMY_200MHZ(d4)                     (((d4) >> 7) & 0x1F)
+#define SFDP_XSPI_DUMMY_166MHZ(d5)                     (((d5) >> 27) & 0x1F)
+#define SFDP_XSPI_DUMMY_133MHZ(d5)                     (((d5) >> 17) & 0x1F)
+#define SFDP_XSPI_DUMMY_100MHZ(d5)                     (((d5) >> 7) & 0x1F)
+
+/* basic table DWORD16, soft reset by the 66h/99h instruction pair */
+#define SFDP_SOFT_RESET_66_99                          (1UL << 12)
+/* basic table DWORD16, status register 1: volatile only, written after 06h / after 50h */
+#define SFDP_SR1_VOLATILE_06H                          (1UL << 1)
+#define SFDP_SR1_VOLATILE_50H                          (1UL << 2)
+/* basic table DWORD16, status register 1: non-volatile by 06h, its volatile copy by 50h */
+#define SFDP_SR1_NV_VOLATILE_50H                       (1UL << 3)
+
+/* basic table DWORD18, command extension of the 8D-8D-8D instructions */
+#define SFDP_OCTAL_CMD_EXT(d18)                        (((d18) >> 29) & 0x03)
+#define SFDP_OCTAL_CMD_EXT_REPEAT                      0    /* extension is the command */
+#define SFDP_OCTAL_CMD_EXT_INVERT                      1    /* extension is the inverted command */
+#define SFDP_OCTAL_CMD_EXT_16BIT                       3    /* 16-bit instructions, not supported */
+
+/* octal DDR command sequence table (JESD216C), 2 DWORDs per sequence */
+#define SFDP_OCTAL_SEQ_LEN(d)                          (((d) >> 24) & 0xFF)
+#define SFDP_OCTAL_SEQ_BYTE_MAX                        7
+
 #ifndef SFDP_WRITE_MAX_PAGE_SIZE
 #define SFDP_WRITE_MAX_PAGE_SIZE                        256
 #endif
@@ -192,7 +361,35 @@ typedef struct {
     struct {
         uint32_t size;                           /**< erase sector size (bytes). 0x00: not available */
         uint8_t cmd;                             /**< erase command */
-    } eraser[3];                                 /**< supported eraser types table */
+        uint8_t type;                            /**< erase type number in the basic table, 1..4 */
+        uint8_t cmd_4b;                          /**< erase command with 4-byte address, 0x00: not available */
+    } eraser[SFDP_SFDP_ERASE_TYPE_MAX_NUM];      /**< supported eraser types table */
+    uint32_t instr_4b;                           /**< 4-byte address instructions, SFDP_4B_xxx. 0: no such table */
+    struct {
+        uint8_t cmd;                             /**< read register instruction */
+        uint8_t addr_bytes;                      /**< address bytes, 0, 3 or 4 */
+        uint8_t dummy;                           /**< dummy clocks before the data */
+        uint8_t mask;                            /**< bits of the data byte that give the result */
+        uint32_t addr;                           /**< register address */
+    } detect[SFDP_SECTOR_MAP_CMD_MAX_NUM];       /**< sector map configuration detection commands */
+    uint8_t detect_num;
+    struct {
+        uint32_t size;                           /**< region size (bytes) */
+        uint8_t erasers;                         /**< bit n: eraser[n] is usable in the region */
+    } region[SFDP_SECTOR_MAP_REGION_MAX_NUM];    /**< sector map from address 0 */
+    uint8_t region_num;                          /**< 0: every eraser is usable throughout the device */
+    struct {
+        uint8_t read_cmd;                        /**< 8D-8D-8D fast read instruction, 0x00: no xSPI profile 1.0 */
+        uint8_t read_dummy;                      /**< fast read dummy clocks */
+        uint8_t rdsr_dummy;                      /**< read status register dummy clocks */
+        uint8_t rdsr_addr_bytes;                 /**< read status register address bytes, 0 or 4 */
+        uint8_t cmd_ext;                         /**< command extension, SFDP_OCTAL_CMD_EXT_xxx */
+        struct {
+            uint8_t len;
+            uint8_t byte[SFDP_OCTAL_SEQ_BYTE_MAX];
+        } seq[SFDP_OCTAL_SEQ_MAX_NUM];           /**< sequences entering octal DDR mode, sent in 1S-1S-1S */
+        uint8_t seq_num;                         /**< 0: no octal DDR command sequence table */
+    } octal;
     //TODO lots of fast read-related stuff (like modes supported and number of wait states/dummy cycles needed in each)
     
 } sfdp_para, *sfdp_para_t;
@@ -208,10 +405,22 @@ typedef struct {
     uint32_t ptp;                                /**< Parameter table 24bit pointer (byte address) */
 } sfdp_para_header_t;
 
+/**
+ *  SFDP parameter table, one entry of the registry of a device
+ */
+typedef struct {
+    uint16_t id;                                 /**< Parameter ID, MSB << 8 | LSB */
+    uint8_t minor_rev;                           /**< Parameter minor revision */
+    uint8_t major_rev;                           /**< Parameter major revision */
+    uint8_t len;                                 /**< Parameter table length(in double words) */
+    uint32_t ptp;                                /**< Parameter table 24bit pointer (byte address) */
+    const uint32_t *dword;                       /**< table content, NULL when it could not be read */
+} sfdp_param_t;
+
 /**
  *  SFDP parameter table structure
  */
-#pragma pack(1)
+#pragma pack(push, 1)
 typedef struct {
     union {
         struct {
@@ -222,12 +431,13 @@ typedef struct {
             uint32_t we_instruction_sel:1;          //ѡʹ50h06hΪWrite Enableָ(ֻеis_status_reg_volatile==1ʱЧ)
             uint32_t :3;
             uint32_t erase_4k_cmd:8;                //4kָ
+            uint32_t support_112_fastread:1;        //ָʾflashǷ֧ 1-1-2 fastread ģʽ
             uint32_t addr_mode:2;                   //ָʾflashַģʽ
             uint32_t support_dtr:1;                 //ָʾflashǷ֧DTR(˫)ģʽ
-            uint32_t support_112_fastread:1;        //ָʾflashǷ֧ 1-2-2 fastread ģʽ
+            uint32_t support_122_fastread:1;        //ָʾflashǷ֧ 1-2-2 fastread ģʽ
             uint32_t support_144_fastread:1;        //ָʾflashǷ֧ 1-4-4 fastread ģʽ
             uint32_t support_114_fastread:1;        //ָʾflashǷ֧ 1-1-4 fastread ģʽ
-            uint32_t :10;
+            uint32_t :9;
             /*MSB*/
         };
         uint32_t value;
@@ -371,6 +581,18 @@ typedef struct {
     }DWORD14;
     
     union {
+        struct {
+            /*LSB*/
+            uint32_t mode_444_disable:4;                        //4-4-4 mode disable sequences
+            uint32_t mode_444_enable:5;                         //4-4-4 mode enable sequences
+            uint32_t support_044_mode:1;                        //0-4-4 (continuous read) mode supported
+            uint32_t mode_044_exit:6;                           //0-4-4 mode exit method
+            uint32_t mode_044_entry:4;                          //0-4-4 mode entry method
+            uint32_t quad_enable_requirements:3;                //Quad Enable Requirements (QER)
+            uint32_t hold_reset_disable:1;                      //HOLD or RESET disable by bit 4 of extended SR
+            uint32_t :8;
+            /*MSB*/
+        };
         uint32_t value;
     }DWORD15;
     
@@ -404,6 +626,7 @@ typedef struct {
     }DWORD20;
 
 }sfdp_para_table_t;
+#pragma pack(pop)
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -454,6 +677,10 @@ typedef struct {
     sfdp_para          sfdp;                    /**< serial flash discoverable parameters by JEDEC standard */
     sfdp_para_header_t sfdp_header;
     sfdp_para_table_t  *sfdp_table;
+    sfdp_param_t       params[SFDP_PARAM_MAX_NUM];  /**< parameter tables by parameter header order */
+    uint8_t            param_num;
+    const uint8_t      *image;                  /**< SFDP region as read from address 0, params[].dword point into it */
+    uint32_t           image_len;               /**< bytes of image read */
 
 } sfdp_flash, *sfdp_flash_t;
 
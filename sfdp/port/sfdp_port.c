@@ -33,12 +33,30 @@
 #include "string.h"
 #include "fsl_lpuart.h"
 #include "fsl_lpspi.h"
+#include "fsl_flexspi.h"
 #include "fsl_gpio.h"
 #include "fsl_iomuxc.h"
 #include "clock_config.h"
+#include "flexspi_lut.h"
 
 static char log_buf[256];
 
+#if SFDP_LOG_ASYNC == true
+/**
+ * Log ring, written by the log functions and read by eDMA. head and tail run
+ * freely and are taken modulo the ring size, the channel copies the bytes from
+ * tail up to head or the end of the ring, log_dma_len of them, into LPUART1.
+ */
+static uint8_t log_ring[SFDP_LOG_RING_SIZE];
+static volatile uint32_t log_head;
+static volatile uint32_t log_tail;
+static uint32_t log_dma_len;
+/* lines that did not fit into the ring since the last flush */
+static uint32_t log_dropped;
+/* set by sfdp_log_sync(), the ring is left as it is and lines go out blocking */
+static volatile bool log_sync;
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////
 
 static void clock_init() {
@@ -51,10 +69,12 @@ static void clock_init() {
     
     CLOCK_EnableClock(kCLOCK_Lpuart1);
     
+#if SFDP_PORT_LPSPI == true
     CLOCK_DisableClock(kCLOCK_Lpspi2);
     CLOCK_SetMux(kCLOCK_LpspiMux, 1);      /* Choose PLL3 PFD0 clock as lpspi2 source clock. */
     CLOCK_SetDiv(kCLOCK_LpspiDiv, 4);      /* flexspi clock 360/(4+1)=72M. */
     CLOCK_EnableClock(kCLOCK_Lpspi2);
+#endif
     
     CLOCK_DisableClock(kCLOCK_FlexSpi);
     CLOCK_SetMux(kCLOCK_FlexspiMux, 0x3);  /* Choose PLL3 PFD0 clock as flexspi source clock. */
@@ -72,6 +92,13 @@ static void iomux_init() {
     IOMUXC_SetPinMux(IOMUXC_GPIO_AD_B0_12_LPUART1_TX, 1U); 
     IOMUXC_SetPinMux(IOMUXC_GPIO_AD_B0_13_LPUART1_RX, 1U); 
     
+    IOMUXC_SetPinConfig(IOMUXC_GPIO_AD_B0_12_LPUART1_TX, 0x10F1);
+    IOMUXC_SetPinConfig(IOMUXC_GPIO_AD_B0_13_LPUART1_RX, 0x10F1);
+    
+    ////////////////////////////////////////////////////////////
+    
+#if SFDP_PORT_LPSPI == true
+    
     IOMUXC_SetPinMux(IOMUXC_GPIO_SD_B1_06_LPSPI2_PCS0, 1U);
     IOMUXC_SetPinMux(IOMUXC_GPIO_SD_B1_07_LPSPI2_SCK,  1U);
     IOMUXC_SetPinMux(IOMUXC_GPIO_SD_B1_08_LPSPI2_SD0,  1U);
@@ -80,11 +107,6 @@ static void iomux_init() {
     IOMUXC_SetPinMux(IOMUXC_GPIO_SD_B1_10_GPIO3_IO10,  1U);
     IOMUXC_SetPinMux(IOMUXC_GPIO_SD_B1_11_GPIO3_IO11,  1U);
     
-    ////////////////////////////////////////////////////////////
-    
-    IOMUXC_SetPinConfig(IOMUXC_GPIO_AD_B0_12_LPUART1_TX, 0x10F1);
-    IOMUXC_SetPinConfig(IOMUXC_GPIO_AD_B0_13_LPUART1_RX, 0x10F1);
-    
     IOMUXC_SetPinConfig(IOMUXC_GPIO_SD_B1_06_LPSPI2_PCS0, 0x10F1);
     IOMUXC_SetPinConfig(IOMUXC_GPIO_SD_B1_07_LPSPI2_SCK,  0x10F1);
     IOMUXC_SetPinConfig(IOMUXC_GPIO_SD_B1_08_LPSPI2_SD0,  0x10F1);
@@ -98,32 +120,72 @@ static void iomux_init() {
     GPIO_PinInit(GPIO3, 10U, &(gpio_pin_config_t){kGPIO_DigitalInput, 1, kGPIO_NoIntmode});
     GPIO_PinInit(GPIO3, 11U, &(gpio_pin_config_t){kGPIO_DigitalInput, 1, kGPIO_NoIntmode});
     
+#else
+    
+    /* the pins of FlexSPI port A1, flexspi_init() of device.c keeps them */
+    IOMUXC_SetPinMux(IOMUXC_GPIO_SD_B1_06_FLEXSPIA_SS0_B,  1U);
+    IOMUXC_SetPinMux(IOMUXC_GPIO_SD_B1_07_FLEXSPIA_SCLK,   1U);
+    IOMUXC_SetPinMux(IOMUXC_GPIO_SD_B1_08_FLEXSPIA_DATA00, 1U);
+    IOMUXC_SetPinMux(IOMUXC_GPIO_SD_B1_09_FLEXSPIA_DATA01, 1U);
+    IOMUXC_SetPinMux(IOMUXC_GPIO_SD_B1_10_FLEXSPIA_DATA02, 1U);
+    IOMUXC_SetPinMux(IOMUXC_GPIO_SD_B1_11_FLEXSPIA_DATA03, 1U);
+    
+    IOMUXC_SetPinConfig(IOMUXC_GPIO_SD_B1_06_FLEXSPIA_SS0_B,  0x10F1);
+    IOMUXC_SetPinConfig(IOMUXC_GPIO_SD_B1_07_FLEXSPIA_SCLK,   0x10F1);
+    IOMUXC_SetPinConfig(IOMUXC_GPIO_SD_B1_08_FLEXSPIA_DATA00, 0x10F1);
+    IOMUXC_SetPinConfig(IOMUXC_GPIO_SD_B1_09_FLEXSPIA_DATA01, 0x10F1);
+    IOMUXC_SetPinConfig(IOMUXC_GPIO_SD_B1_10_FLEXSPIA_DATA02, 0x10F1);
+    IOMUXC_SetPinConfig(IOMUXC_GPIO_SD_B1_11_FLEXSPIA_DATA03, 0x10F1);
+    
+#endif
+    
 #elif defined ( SPHINX_DAP )
     
     /* Set LPUART1/FlexSPI2/GPIO3 Pin mux && Pin config */
     IOMUXC_SetPinMux(IOMUXC_GPIO_AD_B0_06_LPUART1_TX, 1U); 
     IOMUXC_SetPinMux(IOMUXC_GPIO_AD_B0_07_LPUART1_RX, 1U); 
     
-    IOMUXC_SetPinMux(IOMUXC_GPIO_SD_B1_06_LPSPI2_PCS0, 1U);
-    IOMUXC_SetPinMux(IOMUXC_GPIO_SD_B1_07_LPSPI2_SCK,  1U);
-    IOMUXC_SetPinMux(IOMUXC_GPIO_SD_B1_08_LPSPI2_SDO,  1U);
-    IOMUXC_SetPinMux(IOMUXC_GPIO_SD_B1_09_LPSPI2_SDI,  1U);
-    
     IOMUXC_SetPinMux(IOMUXC_GPIO_AD_B1_14_GPIO1_IO30,  1U);
     IOMUXC_SetPinMux(IOMUXC_GPIO_AD_B1_15_GPIO1_IO31,  1U);
     
-    ////////////////////////////////////////////////////////////
-    
     IOMUXC_SetPinConfig(IOMUXC_GPIO_AD_B0_06_LPUART1_TX, 0x10F1);
     IOMUXC_SetPinConfig(IOMUXC_GPIO_AD_B0_07_LPUART1_RX, 0x10F1);
     
+    IOMUXC_SetPinConfig(IOMUXC_GPIO_AD_B1_14_GPIO1_IO30,  0x10F1);
+    IOMUXC_SetPinConfig(IOMUXC_GPIO_AD_B1_15_GPIO1_IO31,  0x10F1);
+    
+    ////////////////////////////////////////////////////////////
+    
+#if SFDP_PORT_LPSPI == true
+    
+    IOMUXC_SetPinMux(IOMUXC_GPIO_SD_B1_06_LPSPI2_PCS0, 1U);
+    IOMUXC_SetPinMux(IOMUXC_GPIO_SD_B1_07_LPSPI2_SCK,  1U);
+    IOMUXC_SetPinMux(IOMUXC_GPIO_SD_B1_08_LPSPI2_SDO,  1U);
+    IOMUXC_SetPinMux(IOMUXC_GPIO_SD_B1_09_LPSPI2_SDI,  1U);
+    
     IOMUXC_SetPinConfig(IOMUXC_GPIO_SD_B1_06_LPSPI2_PCS0, 0x10F1);
     IOMUXC_SetPinConfig(IOMUXC_GPIO_SD_B1_07_LPSPI2_SCK,  0x10F1);
     IOMUXC_SetPinConfig(IOMUXC_GPIO_SD_B1_08_LPSPI2_SDO,  0x10F1);
     IOMUXC_SetPinConfig(IOMUXC_GPIO_SD_B1_09_LPSPI2_SDI,  0x10F1);
     
-    IOMUXC_SetPinConfig(IOMUXC_GPIO_AD_B1_14_GPIO1_IO30,  0x10F1);
-    IOMUXC_SetPinConfig(IOMUXC_GPIO_AD_B1_15_GPIO1_IO31,  0x10F1);
+#else
+    
+    /* the pins of FlexSPI port A1, flexspi_init() of device.c keeps them */
+    IOMUXC_SetPinMux(IOMUXC_GPIO_SD_B1_06_FLEXSPI_A_DATA03, 1U);
+    IOMUXC_SetPinMux(IOMUXC_GPIO_SD_B1_07_FLEXSPI_A_SCLK,   1U);
+    IOMUXC_SetPinMux(IOMUXC_GPIO_SD_B1_08_FLEXSPI_A_DATA00, 1U);
+    IOMUXC_SetPinMux(IOMUXC_GPIO_SD_B1_09_FLEXSPI_A_DATA02, 1U);
+    IOMUXC_SetPinMux(IOMUXC_GPIO_SD_B1_10_FLEXSPI_A_DATA01, 1U);
+    IOMUXC_SetPinMux(IOMUXC_GPIO_SD_B1_11_FLEXSPI_A_SS0_B,  1U);
+    
+    IOMUXC_SetPinConfig(IOMUXC_GPIO_SD_B1_06_FLEXSPI_A_DATA03, 0x10F1);
+    IOMUXC_SetPinConfig(IOMUXC_GPIO_SD_B1_07_FLEXSPI_A_SCLK,   0x10F1);
+    IOMUXC_SetPinConfig(IOMUXC_GPIO_SD_B1_08_FLEXSPI_A_DATA00, 0x10F1);
+    IOMUXC_SetPinConfig(IOMUXC_GPIO_SD_B1_09_FLEXSPI_A_DATA02, 0x10F1);
+    IOMUXC_SetPinConfig(IOMUXC_GPIO_SD_B1_10_FLEXSPI_A_DATA01, 0x10F1);
+    IOMUXC_SetPinConfig(IOMUXC_GPIO_SD_B1_11_FLEXSPI_A_SS0_B,  0x10F1);
+    
+#endif
     
     ////////////////////////////////////////////////////////////
     
@@ -143,8 +205,17 @@ static void lpuart_init() {
     lpuart_config.enableRx = true;
     
     LPUART_Init(LPUART1, &lpuart_config, ((CLOCK_GetPllFreq(kCLOCK_PllUsb1)/6U) / (CLOCK_GetDiv(kCLOCK_UartDiv) + 1U)));
+#if SFDP_LOG_ASYNC == true
+    /* the transmit data register empty flag requests the log channel */
+    CLOCK_EnableClock(kCLOCK_Dma);
+    DMA0->ERQ &= ~(1UL << SFDP_LOG_DMA_CHANNEL);
+    DMAMUX->CHCFG[SFDP_LOG_DMA_CHANNEL] = DMAMUX_CHCFG_SOURCE(kDmaRequestMuxLPUART1Tx) | DMAMUX_CHCFG_ENBL_MASK;
+    LPUART_EnableTxDMA(LPUART1, true);
+    log_dma_len = 0;
+#endif
 }
 
+#if SFDP_PORT_LPSPI == true
 static void lpspi_init() {
     static lpspi_master_config_t lpspi_config = {
         .baudRate = 36*1000*1000U,
@@ -167,6 +238,40 @@ static void lpspi_init() {
     LPSPI_Deinit(LPSPI2);
     LPSPI_MasterInit(LPSPI2, p_lpspi_config, CLOCK_GetFreq(kCLOCK_Usb1PllPfd0Clk)/(CLOCK_GetDiv(kCLOCK_LpspiDiv) + 1U));
 }
+#else
+/* LUT sequences of the SFDP read, flexspi_init() of device.c loads its own LUT over them */
+#define FLEXSPI_SEQ_READ_SFDP               0
+#define FLEXSPI_SEQ_READ_REGISTER           1
+
+static void flexspi_sfdp_init() {
+    flexspi_config_t flexspi_config;
+    flexspi_device_config_t flash_config = {
+        .flexspiRootClk = CLOCK_GetFreq(kCLOCK_Usb1PllPfd0Clk)/(CLOCK_GetDiv(kCLOCK_FlexspiDiv) + 1U),
+        .flashSize = (1UL << 24) / 1024U,   /* KB, the 24-bit address space of SFDP */
+        .CSIntervalUnit = kFLEXSPI_CsIntervalUnit1SckCycle,
+        .CSInterval = 2,
+        .CSHoldTime = 3,
+        .CSSetupTime = 3,
+        .ARDSeqIndex = FLEXSPI_SEQ_READ_SFDP,
+        .ARDSeqNumber = 1,
+        .AHBWriteWaitUnit = kFLEXSPI_AhbWriteWaitUnit2AhbCycle,
+    };
+    const uint32_t lut[] = {
+        [4*FLEXSPI_SEQ_READ_SFDP] =
+            FLEXSPI_LUT_SEQ(kFLEXSPI_Command_SDR, kFLEXSPI_1PAD, SFDP_CMD_READ_SFDP_REGISTER, kFLEXSPI_Command_RADDR_SDR, kFLEXSPI_1PAD, 24),
+        [4*FLEXSPI_SEQ_READ_SFDP+1] =
+            FLEXSPI_LUT_SEQ(kFLEXSPI_Command_DUMMY_SDR, kFLEXSPI_1PAD, 8, kFLEXSPI_Command_READ_SDR, kFLEXSPI_1PAD, 0x04),
+        /* the instruction is replaced by the one spi_write_read() sends */
+        [4*FLEXSPI_SEQ_READ_REGISTER] =
+            FLEXSPI_LUT_SEQ(kFLEXSPI_Command_SDR, kFLEXSPI_1PAD, SFDP_CMD_JEDEC_ID, kFLEXSPI_Command_READ_SDR, kFLEXSPI_1PAD, 0x04),
+    };
+    
+    FLEXSPI_GetDefaultConfig(&flexspi_config);
+    FLEXSPI_Init(FLEXSPI, &flexspi_config);
+    FLEXSPI_SetFlashConfig(FLEXSPI, &flash_config, kFLEXSPI_PortA1);
+    FLEXSPI_UpdateLUT(FLEXSPI, 0, lut, sizeof(lut)/sizeof(uint32_t));
+}
+#endif
 
 static void spi_lock(const sfdp_spi *spi) {
     __disable_irq();
@@ -184,30 +289,92 @@ static void retry_delay_100us(void) {
 
 ////////////////////////////////////////////////////////////////////////////////
 
+#if SFDP_PORT_LPSPI == true
 /**
- * SPI write data then read data
+ * SPI write data then read data, one PCS frame of any length.
+ * The command goes out of write_buf and the answer lands in read_buf, byte frames
+ * are kept no further ahead of the reads than the RX FIFO holds.
  */
 static sfdp_err spi_write_read(const sfdp_spi *spi, const uint8_t *write_buf, size_t write_size, uint8_t *read_buf,
         size_t read_size) {
-    sfdp_err result = SFDP_SUCCESS;
-    static uint8_t lpspiXfer_buf[48];
-    
-    memset(lpspiXfer_buf, SFDP_DUMMY_DATA, (sizeof(lpspiXfer_buf)/sizeof(uint8_t)));
-    
-    memcpy((uint8_t *)lpspiXfer_buf, (uint8_t *)write_buf, write_size);
-    
-    lpspi_transfer_t lpspiXfer = {
-        .rxData = (uint8_t *)lpspiXfer_buf,
-        .txData = (uint8_t *)lpspiXfer_buf,
-        .dataSize = write_size+read_size,
-        .configFlags = kLPSPI_MasterPcs0|kLPSPI_MasterPcsContinuous,
-    };
-    
-    result = (sfdp_err)LPSPI_MasterTransferBlocking(LPSPI2, &lpspiXfer);
-    memcpy((uint8_t *)read_buf, (uint8_t *)(lpspiXfer_buf+write_size), read_size);
-    
-    return result;
+    const size_t size = write_size + read_size;
+    const size_t fifo_size = LPSPI_GetRxFifoSize(LPSPI2);
+    size_t tx = 0, rx = 0;
+    
+    LPSPI_FlushFifo(LPSPI2, true, true);
+    LPSPI_ClearStatusFlags(LPSPI2, kLPSPI_AllStatusFlag);
+    
+    /* PCS0 stays asserted from the first frame until CONT is cleared */
+    LPSPI2->TCR = (LPSPI2->TCR & ~(LPSPI_TCR_CONTC_MASK | LPSPI_TCR_RXMSK_MASK | LPSPI_TCR_TXMSK_MASK | LPSPI_TCR_PCS_MASK))
+                | LPSPI_TCR_CONT_MASK | LPSPI_TCR_PCS(kLPSPI_Pcs0);
+    
+    while (rx < size) {
+        if (tx < size && tx - rx < fifo_size && LPSPI_GetTxFifoCount(LPSPI2) < fifo_size) {
+            LPSPI_WriteData(LPSPI2, (tx < write_size) ? write_buf[tx] : SFDP_DUMMY_DATA);
+            tx++;
+        }
+        if (LPSPI_GetRxFifoCount(LPSPI2)) {
+            uint8_t data = (uint8_t)LPSPI_ReadData(LPSPI2);
+            if (rx >= write_size) {
+                read_buf[rx - write_size] = data;
+            }
+            rx++;
+        }
+    }
+    
+    /* PCS negates after the last frame */
+    LPSPI2->TCR &= ~(LPSPI_TCR_CONTC_MASK | LPSPI_TCR_CONT_MASK);
+    while (LPSPI_GetStatusFlags(LPSPI2) & kLPSPI_ModuleBusyFlag);
+    
+    return (LPSPI_GetStatusFlags(LPSPI2) & kLPSPI_ReceiveErrorFlag) ? SFDP_ERR_READ : SFDP_SUCCESS;
 }
+#else
+/**
+ * SPI write data then read data, through FlexSPI port A1.
+ * Read SFDP sends the address of write_buf, any other instruction is followed by its read.
+ */
+static sfdp_err spi_write_read(const sfdp_spi *spi, const uint8_t *write_buf, size_t write_size, uint8_t *read_buf,
+        size_t read_size) {
+    uint32_t data[32];
+    uint32_t address = 0;
+    uint32_t seq = FLEXSPI_SEQ_READ_SFDP;
+    
+    if (write_buf[0] == SFDP_CMD_READ_SFDP_REGISTER && write_size >= 4) {
+        address = ((uint32_t)write_buf[1] << 16) | ((uint32_t)write_buf[2] << 8) | write_buf[3];
+    } else {
+        const uint32_t seq_lut[4] = {
+            FLEXSPI_LUT_SEQ(kFLEXSPI_Command_SDR, kFLEXSPI_1PAD, write_buf[0], kFLEXSPI_Command_READ_SDR, kFLEXSPI_1PAD, 0x04),
+        };
+        flexspi_lut_write_seq(FLEXSPI, FLEXSPI_SEQ_READ_REGISTER, seq_lut);
+        seq = FLEXSPI_SEQ_READ_REGISTER;
+    }
+    
+    /* the IP RX FIFO is read in words, data keeps read_buf free of alignment */
+    while (read_size) {
+        size_t size = (read_size < sizeof(data)) ? read_size : sizeof(data);
+        flexspi_transfer_t flexspiXfer = {
+            .deviceAddress = address,
+            .port = kFLEXSPI_PortA1,
+            .cmdType = kFLEXSPI_Read,
+            .seqIndex = seq,
+            .SeqNumber = 1,
+            .data = data,
+            .dataSize = size,
+        };
+        
+        if (kStatus_Success != FLEXSPI_TransferBlocking(FLEXSPI, &flexspiXfer)) {
+            return SFDP_ERR_READ;
+        }
+        memcpy(read_buf, data, size);
+        
+        read_buf += size;
+        read_size -= size;
+        address += size;
+    }
+    
+    return SFDP_SUCCESS;
+}
+#endif
 
 sfdp_err sfdp_spi_port_init(sfdp_flash *flash) {
     sfdp_err result = SFDP_SUCCESS;
@@ -226,10 +393,21 @@ sfdp_err sfdp_spi_port_init(sfdp_flash *flash) {
      *    flash->retry.times = 10000; //Required
      */
     
+#if SFDP_LOG_ASYNC == true
+    /* lines an earlier FlashInit left in the ring go out before LPUART1 is reset */
+    if(log_head != log_tail) {
+        sfdp_log_flush();
+    }
+#endif
+    
     clock_init();
     iomux_init();
     lpuart_init();
+#if SFDP_PORT_LPSPI == true
     lpspi_init();
+#else
+    flexspi_sfdp_init();
+#endif
     
     /* ͬ Flash ֲĽӿڼ */
     flash->spi.wr = spi_write_read;
@@ -243,6 +421,95 @@ sfdp_err sfdp_spi_port_init(sfdp_flash *flash) {
     return result;
 }
 
+#if SFDP_LOG_ASYNC == true
+/**
+ * Retire the eDMA transfer once it is done and start the next one over the
+ * bytes queued behind it.
+ *
+ * @return bytes still queued, including those of the running transfer
+ */
+static uint32_t log_drain(void) {
+    uint32_t start, len;
+    
+    if(log_dma_len != 0) {
+        if(!(DMA0->TCD[SFDP_LOG_DMA_CHANNEL].CSR & DMA_CSR_DONE_MASK)) {
+            return log_head - log_tail;
+        }
+        log_tail += log_dma_len;
+        log_dma_len = 0;
+    }
+    if(log_head == log_tail) {
+        return 0;
+    }
+    
+    /* up to the end of the ring, a wrapped line goes out with the next transfer */
+    start = log_tail % SFDP_LOG_RING_SIZE;
+    len = log_head - log_tail;
+    if(len > SFDP_LOG_RING_SIZE - start) {
+        len = SFDP_LOG_RING_SIZE - start;
+    }
+    
+    DMA0->TCD[SFDP_LOG_DMA_CHANNEL].SADDR = (uint32_t)(uintptr_t)&log_ring[start];
+    DMA0->TCD[SFDP_LOG_DMA_CHANNEL].SOFF = 1;
+    DMA0->TCD[SFDP_LOG_DMA_CHANNEL].ATTR = DMA_ATTR_SSIZE(0) | DMA_ATTR_DSIZE(0);
+    DMA0->TCD[SFDP_LOG_DMA_CHANNEL].NBYTES_MLNO = 1;
+    DMA0->TCD[SFDP_LOG_DMA_CHANNEL].SLAST = 0;
+    DMA0->TCD[SFDP_LOG_DMA_CHANNEL].DADDR = (uint32_t)(uintptr_t)&LPUART1->DATA;
+    DMA0->TCD[SFDP_LOG_DMA_CHANNEL].DOFF = 0;
+    DMA0->TCD[SFDP_LOG_DMA_CHANNEL].CITER_ELINKNO = DMA_CITER_ELINKNO_CITER(len);
+    DMA0->TCD[SFDP_LOG_DMA_CHANNEL].BITER_ELINKNO = DMA_BITER_ELINKNO_BITER(len);
+    DMA0->TCD[SFDP_LOG_DMA_CHANNEL].DLAST_SGA = 0;
+    /* clears DONE, the request is disabled again at the end of the major loop */
+    DMA0->TCD[SFDP_LOG_DMA_CHANNEL].CSR = DMA_CSR_DREQ_MASK;
+    log_dma_len = len;
+    /* the ring is written out before the channel reads it */
+    __DSB();
+    DMA0->ERQ |= 1UL << SFDP_LOG_DMA_CHANNEL;
+    
+    return log_head - log_tail;
+}
+#endif
+
+/**
+ * Format one log line and queue it, or send it right away without the ring.
+ * A line that does not fit into the ring is dropped whole and counted.
+ */
+static void log_line(const char *format, va_list args) {
+    const uint32_t prefix = strlen("[SFDP]");
+    /* must use vprintf to print, a line too long for log_buf is cut */
+    int n = vsnprintf(&log_buf[prefix], sizeof(log_buf) - prefix - strlen("\r\n"), format, args);
+    uint32_t len = prefix + ((n < 0) ? 0 : strlen(&log_buf[prefix]));
+    
+    memcpy(log_buf, "[SFDP]", prefix);
+    log_buf[len++] = '\r';
+    log_buf[len++] = '\n';
+    
+#if SFDP_LOG_ASYNC == true
+    if(log_sync) {
+        LPUART_WriteBlocking(LPUART1, (const uint8_t *)log_buf, len);
+        return;
+    }
+    
+    uint32_t head = log_head;
+    uint32_t start = head % SFDP_LOG_RING_SIZE;
+    uint32_t first = SFDP_LOG_RING_SIZE - start;
+    
+    if(SFDP_LOG_RING_SIZE - (head - log_tail) < len) {
+        log_dropped++;
+        return;
+    }
+    if(first > len) {
+        first = len;
+    }
+    memcpy(&log_ring[start], log_buf, first);
+    memcpy(log_ring, &log_buf[first], len - first);
+    log_head = head + len;
+    log_drain();
+#else
+    LPUART_WriteBlocking(LPUART1, (const uint8_t *)log_buf, len);
+#endif
+}
+
 /**
  * This function is print debug info.
  *
@@ -256,11 +523,7 @@ void sfdp_log_debug(const char *file, const long line, const char *format, ...)
 
     /* args point to the first variable parameter */
     va_start(args, format);
-    LPUART_WriteBlocking(LPUART1, "[SFDP]", strlen("[SFDP]"));
-    /* must use vprintf to print */
-    vsnprintf(log_buf, sizeof(log_buf), format, args);
-    LPUART_WriteBlocking(LPUART1, (const uint8_t *)log_buf, strlen(log_buf));
-    LPUART_WriteBlocking(LPUART1, "\r\n", strlen("\r\n"));
+    log_line(format, args);
     va_end(args);
 }
 
@@ -275,10 +538,46 @@ void sfdp_log_info(const char *format, ...) {
 
     /* args point to the first variable parameter */
     va_start(args, format);
-    LPUART_WriteBlocking(LPUART1, "[SFDP]", strlen("[SFDP]"));
-    /* must use vprintf to print */
-    vsnprintf(log_buf, sizeof(log_buf), format, args);
-    LPUART_WriteBlocking(LPUART1, (const uint8_t *)log_buf, strlen(log_buf));
-    LPUART_WriteBlocking(LPUART1, "\r\n", strlen("\r\n"));
+    log_line(format, args);
     va_end(args);
 }
+
+/**
+ * This function waits until every log line queued so far is on the wire,
+ * then reports the lines dropped since the last flush.
+ */
+void sfdp_log_flush(void) {
+#if SFDP_LOG_ASYNC == true
+    if(log_sync) {
+        return;
+    }
+    
+    /* TC may be seen before eDMA moves the first byte, only after DONE it tells the last one is out */
+    while(log_drain() != 0) {
+        while(!(LPUART_GetStatusFlags(LPUART1) & kLPUART_TransmissionCompleteFlag));
+    }
+    while(!(LPUART_GetStatusFlags(LPUART1) & kLPUART_TransmissionCompleteFlag));
+    
+    if(log_dropped != 0) {
+        snprintf(log_buf, sizeof(log_buf), "[SFDP]%lu log lines dropped.\r\n", (unsigned long)log_dropped);
+        LPUART_WriteBlocking(LPUART1, (const uint8_t *)log_buf, strlen(log_buf));
+        log_dropped = 0;
+    }
+#endif
+}
+
+/**
+ * This function switches the log to blocking writes for a fault handler.
+ *
+ * The interrupted code may have been halfway through a ring or TCD update and
+ * never resumes, so the channel is stopped, the lines still queued are given
+ * up and every later line goes to LPUART1 directly, bypassing the ring.
+ */
+void sfdp_log_sync(void) {
+#if SFDP_LOG_ASYNC == true
+    DMA0->ERQ &= ~(1UL << SFDP_LOG_DMA_CHANNEL);
+    log_sync = true;
+    /* a byte the channel had already handed over is let out first */
+    while(!(LPUART_GetStatusFlags(LPUART1) & kLPUART_TransmissionCompleteFlag));
+#endif
+}
@@ -26,24 +26,66 @@
  * Created on: 2018-08-31
  */
 
+#include <stddef.h>
+
 #include "sfdp.h"
 
 #include "fsl_lpspi.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 
+/* SFDP_FLASH_DEVICE_NUM entries are used, the table may name more */
 sfdp_flash flash_table[] = SFDP_FLASH_DEVICE_TABLE;
-static uint8_t sfdp_table[sizeof(sfdp_para_table_t)] = { 0 };
-sfdp_para_table_t *sfdp_para_table = (sfdp_para_table_t *)sfdp_table;
+/* basic flash parameter table of every device, flash_table[n].sfdp_table points here */
+static uint8_t sfdp_tables[SFDP_FLASH_DEVICE_NUM][sizeof(sfdp_para_table_t)] = { 0 };
+/* SFDP region of every device from address 0, flash_table[n].image */
+static uint32_t sfdp_images[SFDP_FLASH_DEVICE_NUM][SFDP_IMAGE_SIZE / 4];
+
+#if SFDP_CACHE == true
+#define SFDP_CACHE_MAGIC                            0x43504653UL    /* "SFPC" */
+#define SFDP_CACHE_NO_TABLE                         0xFFFF
+
+/* what sfdp_device_init() read from a device, kept across FlashInit calls and sessions */
+typedef struct {
+    uint32_t magic;                              /**< SFDP_CACHE_MAGIC */
+    uint32_t size;                               /**< sizeof the entry, another build may lay it out differently */
+    uint8_t id[3];                               /**< JEDEC ID the parameters belong to */
+    uint8_t param_num;
+    sfdp_para sfdp;
+    sfdp_para_header_t sfdp_header;
+    sfdp_param_t params[SFDP_PARAM_MAX_NUM];     /**< dword is NULL, see param_offset */
+    uint16_t param_offset[SFDP_PARAM_MAX_NUM];   /**< table content in image (DWORDs), SFDP_CACHE_NO_TABLE: none */
+    uint8_t table[sizeof(sfdp_para_table_t)];
+    uint32_t image_len;
+    uint32_t image[SFDP_IMAGE_SIZE / 4];
+    uint16_t crc;                                /**< Crc16 of the entry up to here */
+} sfdp_cache_entry;
+
+static __no_init sfdp_cache_entry sfdp_cache[SFDP_FLASH_DEVICE_NUM];
+#endif
 
 ////////////////////////////////////////////////////////////////////////////////
 
 static sfdp_err read_jedec_id(sfdp_flash *flash);
 static bool read_sfdp(sfdp_flash *flash);
 static bool read_sfdp_header(sfdp_flash *flash);
+static bool read_param_headers(sfdp_flash *flash);
+static bool read_param_tables(sfdp_flash *flash);
+static const char *param_name(uint16_t id);
 static bool read_basic_header(const sfdp_flash *flash, sfdp_para_header_t *basic_header);
 static bool read_basic_table(sfdp_flash *flash, sfdp_para_header_t *basic_header);
+static void read_4byte_table(sfdp_flash *flash);
+static void read_sector_map_table(sfdp_flash *flash);
+static void read_octal_tables(sfdp_flash *flash);
+static bool read_image(sfdp_flash *flash, uint32_t end);
 static sfdp_err read_sfdp_data(const sfdp_flash *flash, uint32_t addr, uint8_t *read_buf, size_t size);
+#if SFDP_CACHE == true
+static bool cache_load(sfdp_flash *flash);
+static void cache_save(const sfdp_flash *flash);
+
+/* Framework/flash_loader.c */
+extern uint16_t Crc16(uint8_t const *p, uint32_t len);
+#endif
 
 /* ../port/sfup_port.c */
 extern void sfud_log_debug(const char *file, const long line, const char *format, ...);
@@ -57,6 +99,8 @@ sfdp_err sfdp_init(void) {
     sfdp_err result = SFDP_SUCCESS;
     sfdp_flash *flash = &flash_table[0];
     
+    SFDP_ASSERT(sizeof(flash_table) / sizeof(flash_table[0]) >= SFDP_FLASH_DEVICE_NUM);
+    
     //Initialize Configured Porting hardware
     result = sfdp_spi_port_init(flash);
     if (result != SFDP_SUCCESS) {
@@ -64,18 +108,124 @@ sfdp_err sfdp_init(void) {
     }
     
     //Initialize SFDP configuration
+    return sfdp_device_init(flash);
+}
+
+/**
+ * Read the JEDEC ID and SFDP parameters of one device through its flash->spi.
+ * flash_table[0] is read by sfdp_init(), the platform binds the spi of the others.
+ *
+ * @param flash flash device, an entry of flash_table
+ *
+ * @return SFDP_SUCCESS: JEDEC ID read OK, flash->sfdp.available tells whether SFDP was found
+ */
+sfdp_err sfdp_device_init(sfdp_flash *flash) {
+    sfdp_err result = SFDP_SUCCESS;
+
+    SFDP_ASSERT(flash >= flash_table && flash < flash_table + SFDP_FLASH_DEVICE_NUM);
+
+    flash->sfdp.available = false;
+
     result = read_jedec_id(flash);
     if (result != SFDP_SUCCESS) {
         return result;
     }
+
+#if SFDP_CACHE == true
+    if (cache_load(flash)) {
+        return result;
+    }
+#endif
     
     if (!read_sfdp(flash)) {
         return result;
     }
+
+#if SFDP_CACHE == true
+    cache_save(flash);
+#endif
     
     return result;
 }
 
+#if SFDP_CACHE == true
+/**
+ * Take the parameters of the device from the cache when they were read from
+ * a device with the same JEDEC ID and the entry is intact.
+ *
+ * @param flash flash device, its JEDEC ID read
+ *
+ * @return true: flash->sfdp, the basic table and the parameter tables are restored
+ */
+static bool cache_load(sfdp_flash *flash) {
+    const size_t index = flash - flash_table;
+    const sfdp_cache_entry *entry = &sfdp_cache[index];
+    uint8_t i;
+
+    if (entry->magic != SFDP_CACHE_MAGIC || entry->size != sizeof(*entry)
+            || entry->crc != Crc16((const uint8_t *)entry, offsetof(sfdp_cache_entry, crc))) {
+        return false;
+    }
+    if (entry->id[0] != flash->chip.mf_id || entry->id[1] != flash->chip.type_id
+            || entry->id[2] != flash->chip.capacity_id) {
+        SFDP_DEBUG("Cached SFDP parameters belong to another device, reading SFDP.");
+        return false;
+    }
+
+    flash->sfdp = entry->sfdp;
+    flash->sfdp_header = entry->sfdp_header;
+    flash->param_num = entry->param_num;
+    memcpy(flash->params, entry->params, sizeof(flash->params));
+    for (i = 0; i < SFDP_PARAM_MAX_NUM; i++) {
+        flash->params[i].dword = entry->param_offset[i] == SFDP_CACHE_NO_TABLE ? NULL
+                                 : &sfdp_images[index][entry->param_offset[i]];
+    }
+    memcpy(sfdp_tables[index], entry->table, sizeof(sfdp_tables[index]));
+    memcpy(sfdp_images[index], entry->image, sizeof(sfdp_images[index]));
+    flash->sfdp_table = (sfdp_para_table_t *)sfdp_tables[index];
+    flash->image = (const uint8_t *)sfdp_images[index];
+    flash->image_len = entry->image_len;
+
+    SFDP_DEBUG("SFDP parameters of the device (V%d.%d, %ld KB) taken from the cache.", flash->sfdp.major_rev,
+               flash->sfdp.minor_rev, flash->sfdp.capacity / 1024);
+    return true;
+}
+
+/**
+ * Keep the parameters just read from the device for the next init.
+ *
+ * @param flash flash device, SFDP read OK
+ */
+static void cache_save(const sfdp_flash *flash) {
+    const size_t index = flash - flash_table;
+    sfdp_cache_entry *entry = &sfdp_cache[index];
+    uint8_t i;
+
+    if (!flash->sfdp.available) {
+        return;
+    }
+
+    entry->magic = SFDP_CACHE_MAGIC;
+    entry->size = sizeof(*entry);
+    entry->id[0] = flash->chip.mf_id;
+    entry->id[1] = flash->chip.type_id;
+    entry->id[2] = flash->chip.capacity_id;
+    entry->param_num = flash->param_num;
+    entry->sfdp = flash->sfdp;
+    entry->sfdp_header = flash->sfdp_header;
+    memcpy(entry->params, flash->params, sizeof(entry->params));
+    for (i = 0; i < SFDP_PARAM_MAX_NUM; i++) {
+        entry->param_offset[i] = (i >= flash->param_num || flash->params[i].dword == NULL) ? SFDP_CACHE_NO_TABLE
+                                 : (uint16_t)(flash->params[i].dword - sfdp_images[index]);
+        entry->params[i].dword = NULL;
+    }
+    memcpy(entry->table, sfdp_tables[index], sizeof(entry->table));
+    entry->image_len = flash->image_len;
+    memcpy(entry->image, sfdp_images[index], sizeof(entry->image));
+    entry->crc = Crc16((const uint8_t *)entry, offsetof(sfdp_cache_entry, crc));
+}
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////
 /**
  * Read JEDEC basic information
@@ -120,8 +270,16 @@ static bool read_sfdp(sfdp_flash *flash) {
 
     /* JEDEC basic flash parameter header */
     sfdp_para_header_t basic_header;
-    if (read_sfdp_header(flash) && read_basic_header(flash, &basic_header)) {
-        return read_basic_table(flash, &basic_header);
+    if (read_sfdp_header(flash) && read_param_headers(flash) && read_param_tables(flash)
+            && read_basic_header(flash, &basic_header)) {
+        flash->sfdp_header = basic_header;
+        if (!read_basic_table(flash, &basic_header)) {
+            return false;
+        }
+        read_4byte_table(flash);
+        read_sector_map_table(flash);
+        read_octal_tables(flash);
+        return true;
     } else {
         SFDP_INFO("Warning: Read SFDP parameter header information failed. The %s does not support JEDEC SFDP.", flash->name);
         return false;
@@ -129,7 +287,8 @@ static bool read_sfdp(sfdp_flash *flash) {
 }
 
 /**
- * Read SFDP parameter header
+ * Read SFDP parameter header. The first read of the SFDP region also takes
+ * the parameter headers that may follow.
  *
  * @param flash flash device
  *
@@ -139,19 +298,19 @@ static bool read_sfdp_header(sfdp_flash *flash) {
     sfdp_para *sfdp = &flash->sfdp;
     /* The SFDP header is located at address 000000h of the SFDP data structure.
      * It identifies the SFDP Signature, the number of parameter headers, and the SFDP revision numbers. */
-    /* sfdp parameter header address */
-    uint32_t header_addr = 0;
-    /* each parameter header being 2 DWORDs (64-bit) */
-    uint8_t header[2 * 4] = { 0 };
+    const uint8_t *header;
 
     SFDP_ASSERT(flash);
 
     sfdp->available = false;
-    /* read SFDP header */
-    if (read_sfdp_data(flash, header_addr, header, sizeof(header)) != SFDP_SUCCESS) {
+    flash->image = (const uint8_t *)sfdp_images[flash - flash_table];
+    flash->image_len = 0;
+    /* read SFDP header and up to SFDP_PARAM_MAX_NUM parameter headers, each being 2 DWORDs (64-bit) */
+    if (!read_image(flash, (1 + SFDP_PARAM_MAX_NUM) * 2 * 4)) {
         SFDP_INFO("Error: Can't read SFDP header.");
         return false;
     }
+    header = flash->image;
     /* check SFDP header */
     if (!(header[0] == 'S' &&
           header[1] == 'F' &&
@@ -169,9 +328,147 @@ static bool read_sfdp_header(sfdp_flash *flash) {
     SFDP_DEBUG("Check SFDP header is OK. The reversion is V%d.%d, NPN is %d.", sfdp->major_rev, sfdp->minor_rev,
             header[6]);
 
+    /* NPH is zero-based */
+    flash->param_num = header[6] + 1;
+    if (flash->param_num > SFDP_PARAM_MAX_NUM) {
+        SFDP_INFO("Warning: Only the first %d of %d parameter headers are used.", SFDP_PARAM_MAX_NUM, flash->param_num);
+        flash->param_num = SFDP_PARAM_MAX_NUM;
+    }
+
+    return true;
+}
+
+/**
+ * Decode all parameter headers into the registry of the device
+ *
+ * @param flash flash device, read_sfdp_header() done
+ *
+ * @return true: read OK
+ */
+static bool read_param_headers(sfdp_flash *flash) {
+    /* The parameter headers follow the SFDP header from byte offset 08h, each being 2 DWORDs (64-bit). */
+    const uint8_t *header = flash->image + 8;
+    uint8_t i;
+
+    SFDP_ASSERT(flash);
+
+    if (flash->image_len < 8 + flash->param_num * 2 * 4) {
+        SFDP_INFO("Error: Can't read SFDP parameter headers.");
+        return false;
+    }
+
+    for (i = 0; i < flash->param_num; i++) {
+        const uint8_t *h = &header[i * 2 * 4];
+        sfdp_param_t *param = &flash->params[i];
+
+        /* the first header is the basic one, JESD216 (V1.0) leaves its ID MSB unused */
+        param->id        = (i == 0) ? SFDP_PARAM_ID_BASIC : ((uint16_t)h[7] << 8 | h[0]);
+        param->minor_rev = h[1];
+        param->major_rev = h[2];
+        param->len       = h[3];
+        param->ptp       = (long)h[4] | (long)h[5] << 8 | (long)h[6] << 16;
+        param->dword     = NULL;
+        SFDP_DEBUG("Parameter header %d: ID 0x%04X (%s), reversion is V%d.%d, length is %d, parameter table pointer"
+                " is 0x%06lX.", i, param->id, param_name(param->id), param->major_rev, param->minor_rev, param->len,
+                param->ptp);
+    }
+
+    return true;
+}
+
+/**
+ * Read the parameter tables into the registry of the device. The image is
+ * extended to the end of the last table in one read, the tables are used in place.
+ *
+ * @param flash flash device
+ *
+ * @return true: read OK
+ */
+static bool read_param_tables(sfdp_flash *flash) {
+    const uint32_t *image = sfdp_images[flash - flash_table];
+    uint32_t end = 0;
+    uint8_t i;
+
+    SFDP_ASSERT(flash);
+
+    for (i = 0; i < flash->param_num; i++) {
+        sfdp_param_t *param = &flash->params[i];
+        if (param->len == 0 || (param->ptp & 0x03) != 0) {
+            continue;
+        }
+        if (param->ptp + param->len * 4 > SFDP_IMAGE_SIZE) {
+            SFDP_INFO("Warning: SFDP parameter table 0x%04X lies past the %d byte image.", param->id, SFDP_IMAGE_SIZE);
+            continue;
+        }
+        if (param->ptp + param->len * 4 > end) {
+            end = param->ptp + param->len * 4;
+        }
+    }
+    if (end == 0) {
+        SFDP_INFO("Error: No SFDP parameter table to read.");
+        return false;
+    }
+
+    if (!read_image(flash, end)) {
+        SFDP_INFO("Error: Can't read SFDP parameter tables.");
+        return false;
+    }
+    for (i = 0; i < flash->param_num; i++) {
+        sfdp_param_t *param = &flash->params[i];
+        if (param->len != 0 && (param->ptp & 0x03) == 0 && param->ptp + param->len * 4 <= flash->image_len) {
+            param->dword = &image[param->ptp / 4];
+        }
+    }
+
     return true;
 }
 
+/**
+ * Find a parameter table of the device. When the table is listed more than
+ * once, the newest revision wins.
+ *
+ * @param flash flash device
+ * @param id parameter ID, SFDP_PARAM_ID_xxx or a vendor ID
+ *
+ * @return the table, NULL when the device has none
+ */
+const sfdp_param_t *sfdp_find_param(const sfdp_flash *flash, uint16_t id) {
+    const sfdp_param_t *found = NULL;
+    uint8_t i;
+
+    SFDP_ASSERT(flash);
+
+    for (i = 0; i < flash->param_num; i++) {
+        const sfdp_param_t *param = &flash->params[i];
+        if (param->id != id || param->dword == NULL) {
+            continue;
+        }
+        if (found == NULL || param->major_rev > found->major_rev
+                || (param->major_rev == found->major_rev && param->minor_rev > found->minor_rev)) {
+            found = param;
+        }
+    }
+
+    return found;
+}
+
+static const char *param_name(uint16_t id) {
+    switch (id) {
+    case SFDP_PARAM_ID_BASIC:                   return "basic flash parameter";
+    case SFDP_PARAM_ID_SECTOR_MAP:              return "sector map";
+    case SFDP_PARAM_ID_RPMC:                    return "RPMC";
+    case SFDP_PARAM_ID_4BYTE_ADDR:              return "4-byte address instruction";
+    case SFDP_PARAM_ID_XSPI_PROFILE_1:          return "xSPI profile 1.0";
+    case SFDP_PARAM_ID_XSPI_PROFILE_2:          return "xSPI profile 2.0";
+    case SFDP_PARAM_ID_SCCR_MAP:                return "status, control and configuration register map";
+    case SFDP_PARAM_ID_SCCR_MAP_MULTI_CHIP:     return "SCCR map offsets for multi-chip";
+    case SFDP_PARAM_ID_SCCR_MAP_XSPI_2:         return "SCCR map for xSPI profile 2.0";
+    case SFDP_PARAM_ID_OCTAL_DDR_SEQ:           return "command sequences to octal DDR";
+    default:
+        return SFDP_PARAM_ID_IS_VENDOR(id) ? "vendor" : "unknown";
+    }
+}
+
 /**
  * Read JEDEC basic parameter header
  *
@@ -181,23 +478,20 @@ static bool read_sfdp_header(sfdp_flash *flash) {
  */
 static bool read_basic_header(const sfdp_flash *flash, sfdp_para_header_t *basic_header) {
     /* The basic parameter header is mandatory, is defined by this standard, and starts at byte offset 08h. */
-    uint32_t header_addr = 8;
-    /* each parameter header being 2 DWORDs (64-bit) */
-    uint8_t header[2 * 4] = { 0 };
+    const sfdp_param_t *basic = sfdp_find_param(flash, SFDP_PARAM_ID_BASIC);
 
     SFDP_ASSERT(flash);
     SFDP_ASSERT(basic_header);
 
-    /* read JEDEC basic flash parameter header */
-    if (read_sfdp_data(flash, header_addr, header, sizeof(header)) != SFDP_SUCCESS) {
+    if (basic == NULL) {
         SFDP_INFO("Error: Can't read JEDEC basic flash parameter header.");
         return false;
     }
-    basic_header->id        = header[0];
-    basic_header->minor_rev = header[1];
-    basic_header->major_rev = header[2];
-    basic_header->len       = header[3];
-    basic_header->ptp       = (long)header[4] | (long)header[5] << 8 | (long)header[6] << 16;
+    basic_header->id        = (uint8_t)basic->id;
+    basic_header->minor_rev = basic->minor_rev;
+    basic_header->major_rev = basic->major_rev;
+    basic_header->len       = basic->len;
+    basic_header->ptp       = basic->ptp;
     /* check JEDEC basic flash parameter header */
     if (basic_header->major_rev > SUPPORT_MAX_SFDP_MAJOR_REV) {
         SFDP_INFO("Error: This reversion(V%d.%d) JEDEC basic flash parameter header is not supported.",
@@ -224,19 +518,21 @@ static bool read_basic_header(const sfdp_flash *flash, sfdp_para_header_t *basic
  */
 static bool read_basic_table(sfdp_flash *flash, sfdp_para_header_t *basic_header) {
     sfdp_para *sfdp = &flash->sfdp;
-    /* parameter table address */
-    uint32_t table_addr = basic_header->ptp;
+    uint8_t *sfdp_table = sfdp_tables[flash - flash_table];
+    const sfdp_param_t *basic = sfdp_find_param(flash, SFDP_PARAM_ID_BASIC);
+    uint32_t table_size = basic_header->len * 4;
     /* temporary variables */
     uint8_t i, j;
 
     SFDP_ASSERT(flash);
     SFDP_ASSERT(basic_header);
 
-    /* read JEDEC basic flash parameter table */
-    if (read_sfdp_data(flash, table_addr, sfdp_table, sizeof(sfdp_table)) != SFDP_SUCCESS) {
-        SFDP_INFO("Warning: Can't read JEDEC basic flash parameter table.");
-        return false;
+    /* JEDEC basic flash parameter table from the registry, DWORDs past its length read as 0 */
+    if (table_size > sizeof(sfdp_tables[0])) {
+        table_size = sizeof(sfdp_tables[0]);
     }
+    memset(sfdp_table, 0, sizeof(sfdp_tables[0]));
+    memcpy(sfdp_table, basic->dword, table_size);
     
     flash->sfdp_table = (sfdp_para_table_t *)sfdp_table;
     
@@ -247,15 +543,15 @@ static bool read_basic_table(sfdp_flash *flash, sfdp_para_header_t *basic_header
                 ((uint8_t *)basic_header)[i * 4]);
     }
     
-    /* print JEDEC basic flash parameter table info */
+    /* print JEDEC basic flash parameter table info, all of it from the image, the copy may be shorter */
     SFDP_DEBUG("JEDEC basic flash parameter table info:");
     SFDP_DEBUG("MSB-LSB  3    2    1    0");
-    for (i = 0; i < basic_header->len; i++) {
-        SFDP_DEBUG("[%04d] 0x%02X 0x%02X 0x%02X 0x%02X", i + 1, sfdp_table[i * 4 + 3], sfdp_table[i * 4 + 2], sfdp_table[i * 4 + 1],
-                sfdp_table[i * 4]);
+    for (i = 0; i < basic->len; i++) {
+        SFDP_DEBUG("[%04d] 0x%02X 0x%02X 0x%02X 0x%02X", i + 1, (uint8_t)(basic->dword[i] >> 24), (uint8_t)(basic->dword[i] >> 16),
+                (uint8_t)(basic->dword[i] >> 8), (uint8_t)basic->dword[i]);
     }
     
-    SFDP_DEBUG("Chip Erase will take %d seconds.", ((sfdp_para_table->DWORD11.chip_erase_time>>5)+1)*sfdp_para_table->DWORD11.chip_erase_time&0x1F);
+    SFDP_DEBUG("Chip Erase will take %d seconds.", ((flash->sfdp_table->DWORD11.chip_erase_time>>5)+1)*flash->sfdp_table->DWORD11.chip_erase_time&0x1F);
 
     /* get block/sector 4 KB erase supported and command */
     sfdp->erase_4k_cmd = sfdp_table[1];
@@ -358,11 +654,19 @@ static bool read_basic_table(sfdp_flash *flash, sfdp_para_header_t *basic_header
         if (sfdp_table[28 + 2 * i] != 0x00) {
             sfdp->eraser[j].size = 1L << sfdp_table[28 + 2 * i];
             sfdp->eraser[j].cmd = sfdp_table[28 + 2 * i + 1];
+            sfdp->eraser[j].type = i + 1;
+            sfdp->eraser[j].cmd_4b = 0;
             SFDP_DEBUG("Flash device supports %ldKB block erase. Command is 0x%02X.", sfdp->eraser[j].size / 1024,
                     sfdp->eraser[j].cmd);
             j++;
         }
     }
+    for (; j < SFDP_SFDP_ERASE_TYPE_MAX_NUM; j++) {
+        sfdp->eraser[j].size = 0;
+        sfdp->eraser[j].cmd = 0;
+        sfdp->eraser[j].type = 0;
+        sfdp->eraser[j].cmd_4b = 0;
+    }
     /* sort the eraser size from small to large */
     for (i = 0, j = 0; i < SFDP_SFDP_ERASE_TYPE_MAX_NUM; i++) {
         if (sfdp->eraser[i].size) {
@@ -371,10 +675,13 @@ static bool read_basic_table(sfdp_flash *flash, sfdp_para_header_t *basic_header
                     /* swap the small eraser */
                     uint32_t temp_size = sfdp->eraser[i].size;
                     uint8_t temp_cmd = sfdp->eraser[i].cmd;
+                    uint8_t temp_type = sfdp->eraser[i].type;
                     sfdp->eraser[i].size = sfdp->eraser[j].size;
                     sfdp->eraser[i].cmd = sfdp->eraser[j].cmd;
+                    sfdp->eraser[i].type = sfdp->eraser[j].type;
                     sfdp->eraser[j].size = temp_size;
                     sfdp->eraser[j].cmd = temp_cmd;
+                    sfdp->eraser[j].type = temp_type;
                 }
             }
         }
@@ -386,9 +693,9 @@ static bool read_basic_table(sfdp_flash *flash, sfdp_para_header_t *basic_header
         0x35,
         0x15
     };
-    flash->spi.wr(&flash->spi, &cmd[0], sizeof(cmd), &read_buf[0], 1);
-    flash->spi.wr(&flash->spi, &cmd[1], sizeof(cmd), &read_buf[1], 1);
-    flash->spi.wr(&flash->spi, &cmd[2], sizeof(cmd), &read_buf[2], 1);
+    flash->spi.wr(&flash->spi, &cmd[0], 1, &read_buf[0], 1);
+    flash->spi.wr(&flash->spi, &cmd[1], 1, &read_buf[1], 1);
+    flash->spi.wr(&flash->spi, &cmd[2], 1, &read_buf[2], 1);
     
     SFDP_DEBUG("Status Register-1: 0x%02x", read_buf[0]);
     SFDP_DEBUG("Status Register-2: 0x%02x", read_buf[1]);
@@ -398,14 +705,247 @@ static bool read_basic_table(sfdp_flash *flash, sfdp_para_header_t *basic_header
     return true;
 }
 
+/**
+ * Read JEDEC 4-byte address instruction table (JESD216B), when the device has one
+ *
+ * @param flash flash device
+ */
+static void read_4byte_table(sfdp_flash *flash) {
+    sfdp_para *sfdp = &flash->sfdp;
+    const sfdp_param_t *table = sfdp_find_param(flash, SFDP_PARAM_ID_4BYTE_ADDR);
+    uint8_t i;
+
+    SFDP_ASSERT(flash);
+
+    sfdp->instr_4b = 0;
+    if (table == NULL || table->len < 2) {
+        return;
+    }
+
+    sfdp->instr_4b = table->dword[0];
+    SFDP_DEBUG("4-byte address instruction support is 0x%08lX.", sfdp->instr_4b);
+
+    /* DWORD2 holds the instructions of erase types 1..4, one byte each */
+    for (i = 0; i < SFDP_SFDP_ERASE_TYPE_MAX_NUM; i++) {
+        uint8_t type = sfdp->eraser[i].type;
+        if (sfdp->eraser[i].size == 0 || !(sfdp->instr_4b & (SFDP_4B_ERASE_TYPE_1 << (type - 1)))) {
+            continue;
+        }
+        sfdp->eraser[i].cmd_4b = (table->dword[1] >> (8 * (type - 1))) & 0xFF;
+        SFDP_DEBUG("Flash device supports %ldKB block erase with 4-byte address. Command is 0x%02X.",
+                sfdp->eraser[i].size / 1024, sfdp->eraser[i].cmd_4b);
+    }
+}
+
+/**
+ * Read JEDEC sector map table (JESD216B), when the device has one. Its
+ * configuration detection commands are kept for the platform, which runs them
+ * and passes the result to sfdp_sector_map(). A table without them has one map.
+ *
+ * @param flash flash device
+ */
+static void read_sector_map_table(sfdp_flash *flash) {
+    sfdp_para *sfdp = &flash->sfdp;
+    const sfdp_param_t *table = sfdp_find_param(flash, SFDP_PARAM_ID_SECTOR_MAP);
+    uint8_t i;
+
+    SFDP_ASSERT(flash);
+
+    sfdp->detect_num = 0;
+    sfdp->region_num = 0;
+    if (table == NULL) {
+        return;
+    }
+
+    /* the detection commands come first, 2 DWORDs each */
+    for (i = 0; i + 1 < table->len && !(table->dword[i] & SFDP_SMPT_DESC_MAP); i += 2) {
+        uint32_t desc = table->dword[i];
+
+        if (sfdp->detect_num == SFDP_SECTOR_MAP_CMD_MAX_NUM) {
+            SFDP_INFO("Warning: Too many sector map configuration detection commands.");
+            return;
+        }
+        sfdp->detect[sfdp->detect_num].cmd = SFDP_SMPT_CMD_INSTR(desc);
+        /* the loader never switches the address mode, the current one is 3 bytes */
+        sfdp->detect[sfdp->detect_num].addr_bytes = SFDP_SMPT_CMD_ADDR_LEN(desc) == 2 ? 4 :
+                                                    SFDP_SMPT_CMD_ADDR_LEN(desc) == 0 ? 0 : 3;
+        sfdp->detect[sfdp->detect_num].dummy = SFDP_SMPT_CMD_DUMMY(desc) == 0x0F ? 8 : SFDP_SMPT_CMD_DUMMY(desc);
+        sfdp->detect[sfdp->detect_num].mask = SFDP_SMPT_CMD_MASK(desc);
+        sfdp->detect[sfdp->detect_num].addr = table->dword[i + 1];
+        SFDP_DEBUG("Sector map configuration detection command 0x%02X, address 0x%08lX, mask 0x%02X.",
+                sfdp->detect[sfdp->detect_num].cmd, sfdp->detect[sfdp->detect_num].addr,
+                sfdp->detect[sfdp->detect_num].mask);
+        sfdp->detect_num++;
+        if (desc & SFDP_SMPT_DESC_END) {
+            break;
+        }
+    }
+
+    if (sfdp->detect_num == 0) {
+        sfdp_sector_map(flash, 0);
+    }
+}
+
+/**
+ * Select the sector map of a configuration. The configuration ID is formed by
+ * the results of the detection commands, the first one being the MSB. It is
+ * not used when the table has no detection commands.
+ *
+ * @param flash flash device
+ * @param config_id configuration ID
+ *
+ * @return SFDP_SUCCESS: flash->sfdp.region holds the map
+ */
+sfdp_err sfdp_sector_map(sfdp_flash *flash, uint8_t config_id) {
+    sfdp_para *sfdp = &flash->sfdp;
+    const sfdp_param_t *table = sfdp_find_param(flash, SFDP_PARAM_ID_SECTOR_MAP);
+    uint32_t total = 0;
+    uint8_t i, j, k;
+
+    SFDP_ASSERT(flash);
+
+    sfdp->region_num = 0;
+    if (table == NULL) {
+        return SFDP_ERR_NOT_FOUND;
+    }
+
+    for (i = 0; i < table->len; ) {
+        uint32_t desc = table->dword[i];
+
+        if (!(desc & SFDP_SMPT_DESC_MAP)) {
+            i += 2;
+        } else if (sfdp->detect_num != 0 && SFDP_SMPT_MAP_ID(desc) != config_id) {
+            i += 1 + SFDP_SMPT_MAP_REGIONS(desc);
+        } else {
+            break;
+        }
+        if (desc & SFDP_SMPT_DESC_END) {
+            i = table->len;
+        }
+    }
+    if (i >= table->len || i + SFDP_SMPT_MAP_REGIONS(table->dword[i]) >= table->len
+            || SFDP_SMPT_MAP_REGIONS(table->dword[i]) > SFDP_SECTOR_MAP_REGION_MAX_NUM) {
+        SFDP_INFO("Warning: No usable sector map for configuration 0x%02X.", config_id);
+        return SFDP_ERR_NOT_FOUND;
+    }
+
+    for (j = 0; j < SFDP_SMPT_MAP_REGIONS(table->dword[i]); j++) {
+        uint32_t region = table->dword[i + 1 + j];
+
+        sfdp->region[j].size = SFDP_SMPT_REGION_SIZE(region);
+        /* the map names the basic table erase types, the erasers are sorted by size */
+        sfdp->region[j].erasers = 0;
+        for (k = 0; k < SFDP_SFDP_ERASE_TYPE_MAX_NUM; k++) {
+            if (sfdp->eraser[k].size != 0 && (SFDP_SMPT_REGION_TYPES(region) & (1U << (sfdp->eraser[k].type - 1)))) {
+                sfdp->region[j].erasers |= 1U << k;
+            }
+        }
+        SFDP_DEBUG("Sector map region %d: 0x%08lX..0x%08lX, erasers 0x%X.", j, total,
+                total + sfdp->region[j].size - 1, sfdp->region[j].erasers);
+        total += sfdp->region[j].size;
+    }
+    if (total != sfdp->capacity) {
+        SFDP_INFO("Warning: Sector map of configuration 0x%02X covers %ld of %ld bytes.", config_id, total,
+                sfdp->capacity);
+        return SFDP_ERR_NOT_FOUND;
+    }
+    sfdp->region_num = j;
+
+    return SFDP_SUCCESS;
+}
+
+/**
+ * Read JEDEC xSPI profile 1.0 and octal DDR command sequence tables (JESD216C),
+ * when the device has them. The dummy clocks of the fastest listed frequency
+ * are kept, they are safe at any slower clock.
+ *
+ * @param flash flash device
+ */
+static void read_octal_tables(sfdp_flash *flash) {
+    sfdp_para *sfdp = &flash->sfdp;
+    const sfdp_param_t *profile = sfdp_find_param(flash, SFDP_PARAM_ID_XSPI_PROFILE_1);
+    const sfdp_param_t *table = sfdp_find_param(flash, SFDP_PARAM_ID_OCTAL_DDR_SEQ);
+    uint8_t i, j;
+
+    SFDP_ASSERT(flash);
+
+    memset(&sfdp->octal, 0, sizeof(sfdp->octal));
+    if (profile == NULL || profile->len < 5) {
+        return;
+    }
+
+    sfdp->octal.read_cmd = SFDP_XSPI_READ_FAST_CMD(profile->dword[0]);
+    sfdp->octal.rdsr_dummy = (profile->dword[0] & SFDP_XSPI_RDSR_DUMMY_8) ? 8 : 4;
+    sfdp->octal.rdsr_addr_bytes = (profile->dword[0] & SFDP_XSPI_RDSR_ADDR_4) ? 4 : 0;
+    sfdp->octal.read_dummy = SFDP_XSPI_DUMMY_200MHZ(profile->dword[3]);
+    if (sfdp->octal.read_dummy == 0) {
+        sfdp->octal.read_dummy = SFDP_XSPI_DUMMY_166MHZ(profile->dword[4]);
+    }
+    if (sfdp->octal.read_dummy == 0) {
+        sfdp->octal.read_dummy = SFDP_XSPI_DUMMY_133MHZ(profile->dword[4]);
+    }
+    if (sfdp->octal.read_dummy == 0) {
+        sfdp->octal.read_dummy = SFDP_XSPI_DUMMY_100MHZ(profile->dword[4]);
+    }
+    /* DDR transfers data on both edges, the dummy clocks must be even */
+    sfdp->octal.read_dummy = (sfdp->octal.read_dummy + 1) & ~1U;
+    sfdp->octal.cmd_ext = SFDP_OCTAL_CMD_EXT(flash->sfdp_table->DWORD18.value);
+    SFDP_DEBUG("8D-8D-8D read command is 0x%02X, %d dummy clocks, command extension %d.", sfdp->octal.read_cmd,
+            sfdp->octal.read_dummy, sfdp->octal.cmd_ext);
+
+    if (table == NULL) {
+        return;
+    }
+    for (i = 0; i + 1 < table->len && sfdp->octal.seq_num < SFDP_OCTAL_SEQ_MAX_NUM; i += 2) {
+        uint8_t len = SFDP_OCTAL_SEQ_LEN(table->dword[i]);
+
+        if (len == 0) {
+            break;
+        }
+        if (len > SFDP_OCTAL_SEQ_BYTE_MAX) {
+            SFDP_INFO("Warning: Octal DDR command sequence %d is %d bytes long.", sfdp->octal.seq_num + 1, len);
+            sfdp->octal.seq_num = 0;
+            return;
+        }
+        /* the bytes follow the length from the MSB down, 3 in the first DWORD and 4 in the second */
+        for (j = 0; j < len; j++) {
+            sfdp->octal.seq[sfdp->octal.seq_num].byte[j] = j < 3 ? table->dword[i] >> (16 - 8 * j)
+                                                                 : table->dword[i + 1] >> (24 - 8 * (j - 3));
+        }
+        sfdp->octal.seq[sfdp->octal.seq_num].len = len;
+        SFDP_DEBUG("Octal DDR command sequence %d: %d bytes, command 0x%02X.", sfdp->octal.seq_num + 1, len,
+                sfdp->octal.seq[sfdp->octal.seq_num].byte[0]);
+        sfdp->octal.seq_num++;
+    }
+}
+
+/**
+ * Extend the image of the SFDP region of the device to end bytes, in one read.
+ *
+ * @param flash flash device
+ * @param end bytes from SFDP address 0, at most SFDP_IMAGE_SIZE
+ *
+ * @return true: read OK
+ */
+static bool read_image(sfdp_flash *flash, uint32_t end) {
+    uint8_t *image = (uint8_t *)sfdp_images[flash - flash_table];
+
+    if (end > sizeof(sfdp_images[0])) {
+        end = sizeof(sfdp_images[0]);
+    }
+    if (end <= flash->image_len) {
+        return true;
+    }
+    if (read_sfdp_data(flash, flash->image_len, image + flash->image_len, end - flash->image_len) != SFDP_SUCCESS) {
+        return false;
+    }
+    flash->image_len = end;
+
+    return true;
+}
+
 static sfdp_err read_sfdp_data(const sfdp_flash *flash, uint32_t addr, uint8_t *read_buf, size_t size) {
-    uint8_t cmd[] = {
-            SFDP_CMD_READ_SFDP_REGISTER,
-            (addr >> 16) & 0xFF,
-            (addr >> 8) & 0xFF,
-            (addr >> 0) & 0xFF,
-            SFDP_DUMMY_DATA,
-    };
+    sfdp_err result = SFDP_SUCCESS;
 
     SFDP_ASSERT(flash);
     SFDP_ASSERT(addr < 1L << 24);
@@ -414,5 +954,22 @@ static sfdp_err read_sfdp_data(const sfdp_flash *flash, uint32_t addr, uint8_t *
     
     flash->retry.delay();
 
-    return flash->spi.wr(&flash->spi, cmd, sizeof(cmd), read_buf, size);
+    /* reads longer than the port takes are split, each part with its own command */
+    while (size && result == SFDP_SUCCESS) {
+        size_t part = (SFDP_READ_DATA_MAX && size > SFDP_READ_DATA_MAX) ? SFDP_READ_DATA_MAX : size;
+        uint8_t cmd[] = {
+                SFDP_CMD_READ_SFDP_REGISTER,
+                (addr >> 16) & 0xFF,
+                (addr >> 8) & 0xFF,
+                (addr >> 0) & 0xFF,
+                SFDP_DUMMY_DATA,
+        };
+
+        result = flash->spi.wr(&flash->spi, cmd, sizeof(cmd), read_buf, part);
+        addr += part;
+        read_buf += part;
+        size -= part;
+    }
+
+    return result;
 }
@@ -0,0 +1,257 @@
+/*
+ * Host-side simulator for the i.MXRT SFDP flashloader.
+ *
+ * Reduced peripheral access layer. The FLEXSPI register layout and the bit
+ * fields used by the flashloader are taken verbatim from the MIMXRT1052
+ * device header; every peripheral instance is a plain host object that the
+ * simulator models behind the fsl_* driver API.
+ */
+
+#ifndef _SIM_MIMXRT1052_H_
+#define _SIM_MIMXRT1052_H_
+
+#include <stdint.h>
+
+#define __I     volatile const
+#define __O     volatile
+#define __IO    volatile
+
+#define FSL_FEATURE_FLEXSPI_AHB_BUFFER_COUNTn(x)    (4)
+
+////////////////////////////////////////////////////////////////////////////////
+
+/** FLEXSPI - Register Layout Typedef */
+typedef struct {
+  __IO uint32_t MCR0;
+  __IO uint32_t MCR1;
+  __IO uint32_t MCR2;
+  __IO uint32_t AHBCR;
+  __IO uint32_t INTEN;
+  __IO uint32_t INTR;
+  __IO uint32_t LUTKEY;
+  __IO uint32_t LUTCR;
+  __IO uint32_t AHBRXBUFCR0[4];
+       uint8_t RESERVED_0[48];
+  __IO uint32_t FLSHCR0[4];
+  __IO uint32_t FLSHCR1[4];
+  __IO uint32_t FLSHCR2[4];
+       uint8_t RESERVED_1[4];
+  __IO uint32_t FLSHCR4;
+       uint8_t RESERVED_2[8];
+  __IO uint32_t IPCR0;
+  __IO uint32_t IPCR1;
+       uint8_t RESERVED_3[8];
+  __IO uint32_t IPCMD;
+       uint8_t RESERVED_4[4];
+  __IO uint32_t IPRXFCR;
+  __IO uint32_t IPTXFCR;
+  __IO uint32_t DLLCR[2];
+       uint8_t RESERVED_5[24];
+  __I  uint32_t STS0;
+  __I  uint32_t STS1;
+  __I  uint32_t STS2;
+  __I  uint32_t AHBSPNDSTS;
+  __I  uint32_t IPRXFSTS;
+  __I  uint32_t IPTXFSTS;
+       uint8_t RESERVED_6[8];
+  __I  uint32_t RFDR[32];
+  __O  uint32_t TFDR[32];
+  __IO uint32_t LUT[64];
+} FLEXSPI_Type;
+
+#define FLEXSPI_MCR0_SWRESET_MASK                (0x1U)
+#define FLEXSPI_MCR0_MDIS_MASK                   (0x2U)
+#define FLEXSPI_MCR0_RXCLKSRC_MASK               (0x30U)
+#define FLEXSPI_MCR0_RXCLKSRC_SHIFT              (4U)
+#define FLEXSPI_MCR0_RXCLKSRC(x)                 (((uint32_t)(((uint32_t)(x)) << FLEXSPI_MCR0_RXCLKSRC_SHIFT)) & FLEXSPI_MCR0_RXCLKSRC_MASK)
+#define FLEXSPI_MCR0_COMBINATIONEN_MASK          (0x2000U)
+
+#define FLEXSPI_DLLCR_DLLEN_MASK                 (0x1U)
+#define FLEXSPI_DLLCR_DLLEN_SHIFT                (0U)
+#define FLEXSPI_DLLCR_DLLEN(x)                   (((uint32_t)(((uint32_t)(x)) << FLEXSPI_DLLCR_DLLEN_SHIFT)) & FLEXSPI_DLLCR_DLLEN_MASK)
+#define FLEXSPI_DLLCR_SLVDLYTARGET_MASK          (0x78U)
+#define FLEXSPI_DLLCR_SLVDLYTARGET_SHIFT         (3U)
+#define FLEXSPI_DLLCR_SLVDLYTARGET(x)            (((uint32_t)(((uint32_t)(x)) << FLEXSPI_DLLCR_SLVDLYTARGET_SHIFT)) & FLEXSPI_DLLCR_SLVDLYTARGET_MASK)
+#define FLEXSPI_DLLCR_OVRDEN_MASK                (0x100U)
+#define FLEXSPI_DLLCR_OVRDEN_SHIFT               (8U)
+#define FLEXSPI_DLLCR_OVRDEN(x)                  (((uint32_t)(((uint32_t)(x)) << FLEXSPI_DLLCR_OVRDEN_SHIFT)) & FLEXSPI_DLLCR_OVRDEN_MASK)
+
+#define FLEXSPI_AHBCR_APAREN_MASK                (0x1U)
+#define FLEXSPI_AHBCR_CACHABLEEN_MASK            (0x8U)
+#define FLEXSPI_AHBCR_BUFFERABLEEN_MASK          (0x10U)
+#define FLEXSPI_AHBCR_PREFETCHEN_MASK            (0x20U)
+
+#define FLEXSPI_AHBRXBUFCR0_BUFSZ_MASK           (0xFFU)
+#define FLEXSPI_AHBRXBUFCR0_BUFSZ_SHIFT          (0U)
+#define FLEXSPI_AHBRXBUFCR0_BUFSZ(x)             (((uint32_t)(((uint32_t)(x)) << FLEXSPI_AHBRXBUFCR0_BUFSZ_SHIFT)) & FLEXSPI_AHBRXBUFCR0_BUFSZ_MASK)
+#define FLEXSPI_AHBRXBUFCR0_MSTRID_MASK          (0xF0000U)
+#define FLEXSPI_AHBRXBUFCR0_MSTRID_SHIFT         (16U)
+#define FLEXSPI_AHBRXBUFCR0_MSTRID(x)            (((uint32_t)(((uint32_t)(x)) << FLEXSPI_AHBRXBUFCR0_MSTRID_SHIFT)) & FLEXSPI_AHBRXBUFCR0_MSTRID_MASK)
+#define FLEXSPI_AHBRXBUFCR0_PRIORITY_MASK        (0x3000000U)
+#define FLEXSPI_AHBRXBUFCR0_PRIORITY_SHIFT       (24U)
+#define FLEXSPI_AHBRXBUFCR0_PRIORITY(x)          (((uint32_t)(((uint32_t)(x)) << FLEXSPI_AHBRXBUFCR0_PRIORITY_SHIFT)) & FLEXSPI_AHBRXBUFCR0_PRIORITY_MASK)
+#define FLEXSPI_AHBRXBUFCR0_PREFETCHEN_MASK      (0x80000000U)
+
+#define FLEXSPI_FLSHCR0_FLSHSZ_MASK              (0x7FFFFFU)
+
+#define FLEXSPI_FLSHCR2_ARDSEQID_MASK            (0xFU)
+#define FLEXSPI_FLSHCR2_ARDSEQID_SHIFT           (0U)
+#define FLEXSPI_FLSHCR2_ARDSEQID(x)              (((uint32_t)(((uint32_t)(x)) << FLEXSPI_FLSHCR2_ARDSEQID_SHIFT)) & FLEXSPI_FLSHCR2_ARDSEQID_MASK)
+#define FLEXSPI_FLSHCR2_ARDSEQNUM_MASK           (0xE0U)
+#define FLEXSPI_FLSHCR2_ARDSEQNUM_SHIFT          (5U)
+#define FLEXSPI_FLSHCR2_ARDSEQNUM(x)             (((uint32_t)(((uint32_t)(x)) << FLEXSPI_FLSHCR2_ARDSEQNUM_SHIFT)) & FLEXSPI_FLSHCR2_ARDSEQNUM_MASK)
+
+#define FLEXSPI_LUTCR_LOCK_MASK                  (0x1U)
+#define FLEXSPI_LUTCR_UNLOCK_MASK                (0x2U)
+
+#define FLEXSPI_IPCR1_IDATSZ_MASK                (0xFFFFU)
+#define FLEXSPI_IPCR1_IDATSZ_SHIFT               (0U)
+#define FLEXSPI_IPCR1_IDATSZ(x)                  (((uint32_t)(((uint32_t)(x)) << FLEXSPI_IPCR1_IDATSZ_SHIFT)) & FLEXSPI_IPCR1_IDATSZ_MASK)
+#define FLEXSPI_IPCR1_ISEQID_MASK                (0xF0000U)
+#define FLEXSPI_IPCR1_ISEQID_SHIFT               (16U)
+#define FLEXSPI_IPCR1_ISEQID(x)                  (((uint32_t)(((uint32_t)(x)) << FLEXSPI_IPCR1_ISEQID_SHIFT)) & FLEXSPI_IPCR1_ISEQID_MASK)
+#define FLEXSPI_IPCR1_ISEQNUM_MASK               (0x7000000U)
+#define FLEXSPI_IPCR1_ISEQNUM_SHIFT              (24U)
+#define FLEXSPI_IPCR1_ISEQNUM(x)                 (((uint32_t)(((uint32_t)(x)) << FLEXSPI_IPCR1_ISEQNUM_SHIFT)) & FLEXSPI_IPCR1_ISEQNUM_MASK)
+#define FLEXSPI_IPCR1_IPAREN_MASK                (0x80000000U)
+
+#define FLEXSPI_LUT_OPERAND0_MASK                (0xFFU)
+#define FLEXSPI_LUT_OPERAND0_SHIFT               (0U)
+#define FLEXSPI_LUT_OPERAND0(x)                  (((uint32_t)(((uint32_t)(x)) << FLEXSPI_LUT_OPERAND0_SHIFT)) & FLEXSPI_LUT_OPERAND0_MASK)
+#define FLEXSPI_LUT_NUM_PADS0_MASK               (0x300U)
+#define FLEXSPI_LUT_NUM_PADS0_SHIFT              (8U)
+#define FLEXSPI_LUT_NUM_PADS0(x)                 (((uint32_t)(((uint32_t)(x)) << FLEXSPI_LUT_NUM_PADS0_SHIFT)) & FLEXSPI_LUT_NUM_PADS0_MASK)
+#define FLEXSPI_LUT_OPCODE0_MASK                 (0xFC00U)
+#define FLEXSPI_LUT_OPCODE0_SHIFT                (10U)
+#define FLEXSPI_LUT_OPCODE0(x)                   (((uint32_t)(((uint32_t)(x)) << FLEXSPI_LUT_OPCODE0_SHIFT)) & FLEXSPI_LUT_OPCODE0_MASK)
+#define FLEXSPI_LUT_OPERAND1_MASK                (0xFF0000U)
+#define FLEXSPI_LUT_OPERAND1_SHIFT               (16U)
+#define FLEXSPI_LUT_OPERAND1(x)                  (((uint32_t)(((uint32_t)(x)) << FLEXSPI_LUT_OPERAND1_SHIFT)) & FLEXSPI_LUT_OPERAND1_MASK)
+#define FLEXSPI_LUT_NUM_PADS1_MASK               (0x3000000U)
+#define FLEXSPI_LUT_NUM_PADS1_SHIFT              (24U)
+#define FLEXSPI_LUT_NUM_PADS1(x)                 (((uint32_t)(((uint32_t)(x)) << FLEXSPI_LUT_NUM_PADS1_SHIFT)) & FLEXSPI_LUT_NUM_PADS1_MASK)
+#define FLEXSPI_LUT_OPCODE1_MASK                 (0xFC000000U)
+#define FLEXSPI_LUT_OPCODE1_SHIFT                (26U)
+#define FLEXSPI_LUT_OPCODE1(x)                   (((uint32_t)(((uint32_t)(x)) << FLEXSPI_LUT_OPCODE1_SHIFT)) & FLEXSPI_LUT_OPCODE1_MASK)
+
+////////////////////////////////////////////////////////////////////////////////
+
+/** LPSPI - the master configuration, TCR and an RX FIFO of 8-bit frames are modelled */
+typedef struct {
+  __IO uint32_t TCR;                                /**< CONT and PCS are read at the next FIFO access */
+  uint32_t baud_hz;                                 /**< effective SCK frequency */
+  uint32_t delay_ns;                                /**< PCS setup + hold + between-transfer delay */
+  uint8_t  dummy;                                   /**< data shifted out when txData is NULL */
+  uint8_t  enabled;
+  uint8_t  pcs_asserted;                            /**< a continuous frame holds PCS */
+  uint8_t  rx_error;                                /**< SR[REF]: RX FIFO overrun */
+  uint8_t  rx_fifo[16];
+  uint8_t  rx_head;
+  uint8_t  rx_count;
+} LPSPI_Type;
+
+#define LPSPI_TCR_TXMSK_MASK                     (0x40000U)
+#define LPSPI_TCR_RXMSK_MASK                     (0x80000U)
+#define LPSPI_TCR_CONTC_MASK                     (0x100000U)
+#define LPSPI_TCR_CONT_MASK                      (0x200000U)
+#define LPSPI_TCR_PCS_MASK                       (0x3000000U)
+#define LPSPI_TCR_PCS_SHIFT                      (24U)
+#define LPSPI_TCR_PCS(x)                         (((uint32_t)(((uint32_t)(x)) << LPSPI_TCR_PCS_SHIFT)) & LPSPI_TCR_PCS_MASK)
+
+#define LPSPI_SR_TDF_MASK                        (0x1U)
+#define LPSPI_SR_RDF_MASK                        (0x2U)
+#define LPSPI_SR_FCF_MASK                        (0x200U)
+#define LPSPI_SR_TCF_MASK                        (0x400U)
+#define LPSPI_SR_REF_MASK                        (0x1000U)
+#define LPSPI_SR_MBF_MASK                        (0x1000000U)
+
+/** LPUART - only the transmitter is modelled, DATA takes the bytes of the eDMA channel */
+typedef struct {
+  __IO uint32_t BAUD;
+  __IO uint32_t DATA;
+  uint32_t baud_bps;
+  uint8_t  enabled;
+} LPUART_Type;
+
+#define LPUART_BAUD_TDMAE_MASK                   (0x800000U)
+
+/** DMA - Register Layout Typedef, the registers and TCD words the log channel uses */
+typedef struct {
+  __IO uint32_t ERQ;
+  struct {
+    __IO uint32_t SADDR;
+    __IO uint16_t SOFF;
+    __IO uint16_t ATTR;
+    __IO uint32_t NBYTES_MLNO;
+    __IO uint32_t SLAST;
+    __IO uint32_t DADDR;
+    __IO uint16_t DOFF;
+    __IO uint16_t CITER_ELINKNO;
+    __IO uint32_t DLAST_SGA;
+    __IO uint16_t CSR;
+    __IO uint16_t BITER_ELINKNO;
+  } TCD[32];
+} DMA_Type;
+
+#define DMA_ATTR_DSIZE(x)                        (((uint16_t)(((uint16_t)(x)) << 0U)) & 0x7U)
+#define DMA_ATTR_SSIZE(x)                        (((uint16_t)(((uint16_t)(x)) << 8U)) & 0x700U)
+#define DMA_CITER_ELINKNO_CITER(x)               (((uint16_t)(((uint16_t)(x)) << 0U)) & 0x7FFFU)
+#define DMA_BITER_ELINKNO_BITER(x)               (((uint16_t)(((uint16_t)(x)) << 0U)) & 0x7FFFU)
+#define DMA_CSR_DREQ_MASK                        (0x8U)
+#define DMA_CSR_DONE_MASK                        (0x80U)
+
+/** DMAMUX - Register Layout Typedef */
+typedef struct {
+  __IO uint32_t CHCFG[32];
+} DMAMUX_Type;
+
+#define DMAMUX_CHCFG_SOURCE(x)                   (((uint32_t)(((uint32_t)(x)) << 0U)) & 0x7FU)
+#define DMAMUX_CHCFG_ENBL_MASK                   (0x80000000U)
+
+typedef enum _dma_request_source
+{
+    kDmaRequestMuxLPUART1Tx         = 2|0x100U,    /**< LPUART1 Transmit */
+} dma_request_source_t;
+
+typedef struct {
+  uint32_t reserved;
+} CCM_ANALOG_Type;
+
+typedef struct {
+  uint32_t DR;
+  uint32_t GDIR;
+} GPIO_Type;
+
+/** IOMUXC_GPR - only the FlexRAM bank configuration is modelled */
+typedef struct {
+  __IO uint32_t GPR16;
+  __IO uint32_t GPR17;
+} IOMUXC_GPR_Type;
+
+#define IOMUXC_GPR_GPR16_FLEXRAM_BANK_CFG_SEL_MASK (0x4U)
+#define IOMUXC_GPR_GPR16_FLEXRAM_BANK_CFG_SEL_SHIFT (2U)
+#define IOMUXC_GPR_GPR17_FLEXRAM_BANK_CFG_MASK   (0xFFFFFFFFU)
+
+////////////////////////////////////////////////////////////////////////////////
+
+extern FLEXSPI_Type     SIM_FLEXSPI;
+extern LPSPI_Type       SIM_LPSPI2;
+extern LPUART_Type      SIM_LPUART1;
+extern DMA_Type         SIM_DMA0;
+extern DMAMUX_Type      SIM_DMAMUX;
+extern CCM_ANALOG_Type  SIM_CCM_ANALOG;
+extern GPIO_Type        SIM_GPIO1;
+extern GPIO_Type        SIM_GPIO3;
+extern IOMUXC_GPR_Type  SIM_IOMUXC_GPR;
+
+#define FLEXSPI         (&SIM_FLEXSPI)
+#define LPSPI2          (&SIM_LPSPI2)
+#define LPUART1         (&SIM_LPUART1)
+#define DMA0            (&SIM_DMA0)
+#define DMAMUX          (&SIM_DMAMUX)
+#define CCM_ANALOG      (&SIM_CCM_ANALOG)
+#define GPIO1           (&SIM_GPIO1)
+#define GPIO3           (&SIM_GPIO3)
+#define IOMUXC_GPR      (&SIM_IOMUXC_GPR)
+
+#endif
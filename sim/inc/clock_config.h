@@ -0,0 +1,12 @@
+/*
+ * Host-side simulator for the i.MXRT SFDP flashloader.
+ */
+
+#ifndef _SIM_CLOCK_CONFIG_H_
+#define _SIM_CLOCK_CONFIG_H_
+
+#include "fsl_clock.h"
+
+void BOARD_BootClockRUN(void);
+
+#endif
@@ -0,0 +1,13 @@
+/*
+ * Host-side simulator for the i.MXRT SFDP flashloader.
+ *
+ * CmBacktrace is a fault reporter for the Cortex-M core and has nothing to
+ * do on the host.
+ */
+
+#ifndef _SIM_CM_BACKTRACE_H_
+#define _SIM_CM_BACKTRACE_H_
+
+#define cm_backtrace_init(firmware_name, hardware_ver, software_ver) ((void)0)
+
+#endif
@@ -0,0 +1,80 @@
+/*
+ * Host-side simulator for the i.MXRT SFDP flashloader.
+ *
+ * Clock controller interface (subset of KSDK 2.3 fsl_clock.h). Only the
+ * USB1 PLL / PFD0 path that feeds FLEXSPI and LPSPI is modelled.
+ */
+
+#ifndef _SIM_FSL_CLOCK_H_
+#define _SIM_FSL_CLOCK_H_
+
+#include "fsl_common.h"
+
+typedef enum _clock_name
+{
+    kCLOCK_CpuClk = 0x0U,
+    kCLOCK_AhbClk = 0x1U,
+    kCLOCK_IpgClk = 0x3U,
+    kCLOCK_Usb1PllClk = 0x7U,
+    kCLOCK_Usb1PllPfd0Clk = 0x8U,
+} clock_name_t;
+
+typedef enum _clock_ip_name
+{
+    kCLOCK_IpInvalid = 0,
+    kCLOCK_Lpuart1,
+    kCLOCK_Lpspi2,
+    kCLOCK_FlexSpi,
+    kCLOCK_Rom,
+    kCLOCK_Gpio1,
+    kCLOCK_Gpio3,
+    kCLOCK_Dma,
+    kCLOCK_IpCount
+} clock_ip_name_t;
+
+typedef enum _clock_mux
+{
+    kCLOCK_LpspiMux = 0,
+    kCLOCK_FlexspiMux,
+    kCLOCK_UartMux,
+    kCLOCK_MuxCount
+} clock_mux_t;
+
+typedef enum _clock_div
+{
+    kCLOCK_LpspiDiv = 0,
+    kCLOCK_FlexspiDiv,
+    kCLOCK_UartDiv,
+    kCLOCK_DivCount
+} clock_div_t;
+
+typedef enum _clock_pll
+{
+    kCLOCK_PllUsb1 = 0,
+} clock_pll_t;
+
+typedef enum _clock_pfd
+{
+    kCLOCK_Pfd0 = 0U,
+    kCLOCK_Pfd1 = 1U,
+    kCLOCK_Pfd2 = 2U,
+    kCLOCK_Pfd3 = 3U,
+} clock_pfd_t;
+
+typedef struct _clock_usb_pll_config
+{
+    uint8_t loopDivider;
+} clock_usb_pll_config_t;
+
+void CLOCK_EnableClock(clock_ip_name_t name);
+void CLOCK_DisableClock(clock_ip_name_t name);
+void CLOCK_SetMux(clock_mux_t mux, uint32_t value);
+void CLOCK_SetDiv(clock_div_t divider, uint32_t value);
+uint32_t CLOCK_GetDiv(clock_div_t divider);
+void CLOCK_SetPllBypass(CCM_ANALOG_Type *base, clock_pll_t pll, bool bypass);
+void CLOCK_InitUsb1Pll(const clock_usb_pll_config_t *config);
+void CLOCK_InitUsb1Pfd(clock_pfd_t pfd, uint8_t pfdFrac);
+uint32_t CLOCK_GetPllFreq(clock_pll_t pll);
+uint32_t CLOCK_GetFreq(clock_name_t name);
+
+#endif
@@ -0,0 +1,54 @@
+/*
+ * Host-side simulator for the i.MXRT SFDP flashloader.
+ *
+ * Subset of the KSDK common header: status codes and the CMSIS core
+ * intrinsics the flashloader calls.
+ */
+
+#ifndef _SIM_FSL_COMMON_H_
+#define _SIM_FSL_COMMON_H_
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "fsl_device_registers.h"
+
+#define MAKE_STATUS(group, code) ((((group)*100) + (code)))
+#define MAKE_VERSION(major, minor, bugfix) (((major) << 16) | ((minor) << 8) | (bugfix))
+
+enum _status_groups
+{
+    kStatusGroup_Generic = 0,
+    kStatusGroup_LPSPI = 4,
+    kStatusGroup_LPUART = 13,
+    kStatusGroup_FLEXSPI = 70,
+};
+
+enum _generic_status
+{
+    kStatus_Success = MAKE_STATUS(kStatusGroup_Generic, 0),
+    kStatus_Fail = MAKE_STATUS(kStatusGroup_Generic, 1),
+    kStatus_ReadOnly = MAKE_STATUS(kStatusGroup_Generic, 2),
+    kStatus_OutOfRange = MAKE_STATUS(kStatusGroup_Generic, 3),
+    kStatus_InvalidArgument = MAKE_STATUS(kStatusGroup_Generic, 4),
+    kStatus_Timeout = MAKE_STATUS(kStatusGroup_Generic, 5),
+    kStatus_NoTransferInProgress = MAKE_STATUS(kStatusGroup_Generic, 6),
+};
+
+typedef int32_t status_t;
+
+/* CMSIS core intrinsics, no interrupt controller on the host */
+static inline void __disable_irq(void) {}
+static inline void __enable_irq(void) {}
+static inline void __disable_fault_irq(void) {}
+static inline void __enable_fault_irq(void) {}
+/* __DSB() and friends, from core_cm7.h in the KSDK */
+#include "intrinsics.h"
+
+/* needs MAKE_STATUS / status_t, as in the KSDK header */
+#include "fsl_clock.h"
+
+#endif
@@ -0,0 +1,10 @@
+/*
+ * Host-side simulator for the i.MXRT SFDP flashloader.
+ */
+
+#ifndef _SIM_FSL_DEVICE_REGISTERS_H_
+#define _SIM_FSL_DEVICE_REGISTERS_H_
+
+#include "MIMXRT1052.h"
+
+#endif
@@ -0,0 +1,261 @@
+/*
+ * Host-side simulator for the i.MXRT SFDP flashloader.
+ *
+ * FLEXSPI driver interface. Types and the LUT encoding are identical to the
+ * KSDK 2.3 fsl_flexspi.h; the functions are implemented by the simulated
+ * controller in sim/src/sim_flexspi.c.
+ */
+
+#ifndef _SIM_FSL_FLEXSPI_H_
+#define _SIM_FSL_FLEXSPI_H_
+
+#include <stddef.h>
+#include "fsl_device_registers.h"
+#include "fsl_common.h"
+
+#define FSL_FEATURE_FLEXSPI_AHB_BUFFER_COUNT FSL_FEATURE_FLEXSPI_AHB_BUFFER_COUNTn(0)
+
+/*! @breif Formula to form FLEXSPI instructions in LUT table. */
+#define FLEXSPI_LUT_SEQ(cmd0, pad0, op0, cmd1, pad1, op1)                                                              \
+    (FLEXSPI_LUT_OPERAND0(op0) | FLEXSPI_LUT_NUM_PADS0(pad0) | FLEXSPI_LUT_OPCODE0(cmd0) | FLEXSPI_LUT_OPERAND1(op1) | \
+     FLEXSPI_LUT_NUM_PADS1(pad1) | FLEXSPI_LUT_OPCODE1(cmd1))
+
+/*! @brief Status structure of FLEXSPI.*/
+enum _flexspi_status
+{
+    kStatus_FLEXSPI_Busy = MAKE_STATUS(kStatusGroup_FLEXSPI, 0),                     /*!< FLEXSPI is busy */
+    kStatus_FLEXSPI_SequenceExecutionTimeout = MAKE_STATUS(kStatusGroup_FLEXSPI, 1), /*!< Sequence execution timeout
+                                                                            error occurred during FLEXSPI transfer. */
+    kStatus_FLEXSPI_IpCommandSequenceError = MAKE_STATUS(kStatusGroup_FLEXSPI, 2),   /*!< IP command Sequence execution
+                                                                     timeout error occurred during FLEXSPI transfer. */
+    kStatus_FLEXSPI_IpCommandGrantTimeout = MAKE_STATUS(kStatusGroup_FLEXSPI, 3),    /*!< IP command grant timeout error
+                                                                                    occurred during FLEXSPI transfer. */
+};
+
+/*! @brief CMD definition of FLEXSPI, use to form LUT instruction. */
+enum _flexspi_command
+{
+    kFLEXSPI_Command_STOP = 0x00U,           /*!< Stop execution, deassert CS. */
+    kFLEXSPI_Command_SDR = 0x01U,            /*!< Transmit Command code to Flash, using SDR mode. */
+    kFLEXSPI_Command_RADDR_SDR = 0x02U,      /*!< Transmit Row Address to Flash, using SDR mode. */
+    kFLEXSPI_Command_CADDR_SDR = 0x03U,      /*!< Transmit Column Address to Flash, using SDR mode. */
+    kFLEXSPI_Command_MODE1_SDR = 0x04U,      /*!< Transmit 1-bit Mode bits to Flash, using SDR mode. */
+    kFLEXSPI_Command_MODE2_SDR = 0x05U,      /*!< Transmit 2-bit Mode bits to Flash, using SDR mode. */
+    kFLEXSPI_Command_MODE4_SDR = 0x06U,      /*!< Transmit 4-bit Mode bits to Flash, using SDR mode. */
+    kFLEXSPI_Command_MODE8_SDR = 0x07U,      /*!< Transmit 8-bit Mode bits to Flash, using SDR mode. */
+    kFLEXSPI_Command_WRITE_SDR = 0x08U,      /*!< Transmit Programming Data to Flash, using SDR mode. */
+    kFLEXSPI_Command_READ_SDR = 0x09U,       /*!< Receive Read Data from Flash, using SDR mode. */
+    kFLEXSPI_Command_LEARN_SDR = 0x0AU,      /*!< Receive Read Data or Preamble bit from Flash, SDR mode. */
+    kFLEXSPI_Command_DATSZ_SDR = 0x0BU,      /*!< Transmit Read/Program Data size (byte) to Flash, SDR mode. */
+    kFLEXSPI_Command_DUMMY_SDR = 0x0CU,      /*!< Leave data lines undriven by FlexSPI controller.*/
+    kFLEXSPI_Command_DUMMY_RWDS_SDR = 0x0DU, /*!< Leave data lines undriven by FlexSPI controller,
+                                                  dummy cycles decided by RWDS. */
+    kFLEXSPI_Command_DDR = 0x21U,            /*!< Transmit Command code to Flash, using DDR mode. */
+    kFLEXSPI_Command_RADDR_DDR = 0x22U,      /*!< Transmit Row Address to Flash, using DDR mode. */
+    kFLEXSPI_Command_CADDR_DDR = 0x23U,      /*!< Transmit Column Address to Flash, using DDR mode. */
+    kFLEXSPI_Command_MODE1_DDR = 0x24U,      /*!< Transmit 1-bit Mode bits to Flash, using DDR mode. */
+    kFLEXSPI_Command_MODE2_DDR = 0x25U,      /*!< Transmit 2-bit Mode bits to Flash, using DDR mode. */
+    kFLEXSPI_Command_MODE4_DDR = 0x26U,      /*!< Transmit 4-bit Mode bits to Flash, using DDR mode. */
+    kFLEXSPI_Command_MODE8_DDR = 0x27U,      /*!< Transmit 8-bit Mode bits to Flash, using DDR mode. */
+    kFLEXSPI_Command_WRITE_DDR = 0x28U,      /*!< Transmit Programming Data to Flash, using DDR mode. */
+    kFLEXSPI_Command_READ_DDR = 0x29U,       /*!< Receive Read Data from Flash, using DDR mode. */
+    kFLEXSPI_Command_LEARN_DDR = 0x2AU,      /*!< Receive Read Data or Preamble bit from Flash, DDR mode. */
+    kFLEXSPI_Command_DATSZ_DDR = 0x2BU,      /*!< Transmit Read/Program Data size (byte) to Flash, DDR mode. */
+    kFLEXSPI_Command_DUMMY_DDR = 0x2CU,      /*!< Leave data lines undriven by FlexSPI controller.*/
+    kFLEXSPI_Command_DUMMY_RWDS_DDR = 0x2DU, /*!< Leave data lines undriven by FlexSPI controller,
+                                               dummy cycles decided by RWDS. */
+    kFLEXSPI_Command_JUMP_ON_CS = 0x1FU,     /*!< Stop execution, deassert CS and save operand[7:0] as the
+                                               instruction start pointer for next sequence */
+};
+
+/*! @brief pad definition of FLEXSPI, use to form LUT instruction. */
+/*! @brief FLEXSPI sample clock source selection for Flash Reading.*/
+/*! @brief pad definition of FLEXSPI, use to form LUT instruction. */
+enum _flexspi_pad
+{
+    kFLEXSPI_1PAD = 0x00U,
+    kFLEXSPI_2PAD = 0x01U,
+    kFLEXSPI_4PAD = 0x02U,
+    kFLEXSPI_8PAD = 0x03U,
+};
+
+typedef enum _flexspi_read_sample_clock
+{
+    kFLEXSPI_ReadSampleClkLoopbackInternally = 0x0U,      /*!< Dummy Read strobe generated by FlexSPI Controller
+                                                               and loopback internally. */
+    kFLEXSPI_ReadSampleClkLoopbackFromDqsPad = 0x1U,      /*!< Dummy Read strobe generated by FlexSPI Controller
+                                                               and loopback from DQS pad. */
+    kFLEXSPI_ReadSampleClkLoopbackFromSckPad = 0x2U,      /*!< SCK output clock and loopback from SCK pad. */
+    kFLEXSPI_ReadSampleClkExternalInputFromDqsPad = 0x3U, /*!< Flash provided Read strobe and input from DQS pad. */
+} flexspi_read_sample_clock_t;
+
+/*! @brief FLEXSPI interval unit for flash device select.*/
+typedef enum _flexspi_cs_interval_cycle_unit
+{
+    kFLEXSPI_CsIntervalUnit1SckCycle = 0x0U,   /*!< Chip selection interval: CSINTERVAL * 1 serial clock cycle. */
+    kFLEXSPI_CsIntervalUnit256SckCycle = 0x1U, /*!< Chip selection interval: CSINTERVAL * 256 serial clock cycle. */
+} flexspi_cs_interval_cycle_unit_t;
+
+/*! @brief FLEXSPI AHB wait interval unit for writting.*/
+typedef enum _flexspi_ahb_write_wait_unit
+{
+    kFLEXSPI_AhbWriteWaitUnit2AhbCycle = 0x0U,     /*!< AWRWAIT unit is 2 ahb clock cycle. */
+    kFLEXSPI_AhbWriteWaitUnit8AhbCycle = 0x1U,     /*!< AWRWAIT unit is 8 ahb clock cycle. */
+    kFLEXSPI_AhbWriteWaitUnit32AhbCycle = 0x2U,    /*!< AWRWAIT unit is 32 ahb clock cycle. */
+    kFLEXSPI_AhbWriteWaitUnit128AhbCycle = 0x3U,   /*!< AWRWAIT unit is 128 ahb clock cycle. */
+    kFLEXSPI_AhbWriteWaitUnit512AhbCycle = 0x4U,   /*!< AWRWAIT unit is 512 ahb clock cycle. */
+    kFLEXSPI_AhbWriteWaitUnit2048AhbCycle = 0x5U,  /*!< AWRWAIT unit is 2048 ahb clock cycle. */
+    kFLEXSPI_AhbWriteWaitUnit8192AhbCycle = 0x6U,  /*!< AWRWAIT unit is 8192 ahb clock cycle. */
+    kFLEXSPI_AhbWriteWaitUnit32768AhbCycle = 0x7U, /*!< AWRWAIT unit is 32768 ahb clock cycle. */
+} flexspi_ahb_write_wait_unit_t;
+
+/*! @brief Error Code when IP command Error detected.*/
+/*! @brief FLEXSPI operation port select.*/
+typedef enum _flexspi_port
+{
+    kFLEXSPI_PortA1 = 0x0U, /*!< Access flash on A1 port. */
+    kFLEXSPI_PortA2 = 0x1U, /*!< Access flash on A2 port. */
+    kFLEXSPI_PortB1 = 0x2U, /*!< Access flash on B1 port. */
+    kFLEXSPI_PortB2 = 0x3U, /*!< Access flash on B2 port. */
+} flexspi_port_t;
+
+
+typedef enum _flexspi_command_type
+{
+    kFLEXSPI_Command, /*!< FlexSPI operation: Only command, both TX and Rx buffer are ignored. */
+    kFLEXSPI_Config,  /*!< FlexSPI operation: Configure device mode, the TX fifo size is fixed in LUT. */
+    kFLEXSPI_Read,    /* /!< FlexSPI operation: Read, only Rx Buffer is effective. */
+    kFLEXSPI_Write,   /* /!< FlexSPI operation: Read, only Tx Buffer is effective. */
+} flexspi_command_type_t;
+
+typedef struct _flexspi_ahbBuffer_config
+{
+    uint8_t priority;
+    uint8_t masterIndex;
+    uint16_t bufferSize;
+} flexspi_ahbBuffer_config_t;
+
+/*! @brief FLEXSPI configuration structure. */
+typedef struct _flexspi_config
+{
+    flexspi_read_sample_clock_t rxSampleClock; /*!< Sample Clock source selection for Flash Reading. */
+    bool enableSckFreeRunning;                 /*!< Enable/disable SCK output free-running. */
+    bool enableCombination;                    /*!< Enable/disable combining PORT A and B Data Pins
+                                               (SIOA[3:0] and SIOB[3:0]) to support Flash Octal mode. */
+    bool enableDoze;                           /*!< Enable/disable doze mode support. */
+    bool enableHalfSpeedAccess;                /*!< Enable/disable divide by 2 of the clock for half
+                                                speed commands. */
+    bool enableSckBDiffOpt;                    /*!< Enable/disable SCKB pad use as SCKA differential clock
+                                                output, when enable, Port B flash access is not available. */
+    bool enableSameConfigForAll;               /*!< Enable/disable same configuration for all connected devices
+                                                when enabled, same configuration in FLASHA1CRx is applied to all. */
+    uint16_t seqTimeoutCycle;                  /*!< Timeout wait cycle for command sequence execution,
+                                               timeout after ahbGrantTimeoutCyle*1024 serial root clock cycles. */
+    uint8_t ipGrantTimeoutCycle;               /*!< Timeout wait cycle for IP command grant, timeout after
+                                                ipGrantTimeoutCycle*1024 AHB clock cycles. */
+    uint8_t txWatermark;                       /*!< FLEXSPI IP transmit watermark value. */
+    uint8_t rxWatermark;                       /*!< FLEXSPI receive watermark value. */
+    struct
+    {
+        bool enableAHBWriteIpTxFifo;  /*!< Enable AHB bus write access to IP TX FIFO. */
+        bool enableAHBWriteIpRxFifo;  /*!< Enable AHB bus write access to IP RX FIFO. */
+        uint8_t ahbGrantTimeoutCycle; /*!< Timeout wait cycle for AHB command grant,
+                                       timeout after ahbGrantTimeoutCyle*1024 AHB clock cycles. */
+        uint16_t ahbBusTimeoutCycle;  /*!< Timeout wait cycle for AHB read/write access,
+                                      timeout after ahbBusTimeoutCycle*1024 AHB clock cycles. */
+        uint8_t resumeWaitCycle;      /*!< Wait cycle for idle state before suspended command sequence
+                                       resume, timeout after ahbBusTimeoutCycle AHB clock cycles. */
+        flexspi_ahbBuffer_config_t buffer[FSL_FEATURE_FLEXSPI_AHB_BUFFER_COUNT]; /*!< AHB buffer size. */
+        bool enableClearAHBBufferOpt; /*!< Enable/disable automatically clean AHB RX Buffer and TX Buffer
+                                       when FLEXSPI returns STOP mode ACK. */
+        bool enableAHBPrefetch;       /*!< Enable/disable AHB read prefetch feature, when enabled, FLEXSPI
+                                       will fetch more data than current AHB burst. */
+        bool enableAHBBufferable;     /*!< Enable/disable AHB bufferable write access support, when enabled,
+                                       FLEXSPI return before waiting for command excution finished. */
+        bool enableAHBCachable;       /*!< Enable AHB bus cachable read access support. */
+    } ahbConfig;
+} flexspi_config_t;
+
+/*! @brief External device configuration items. */
+typedef struct _flexspi_device_config
+{
+    uint32_t flexspiRootClk;                         /*!< FLEXSPI serial root clock. */
+    bool isSck2Enabled;                              /*!< FLEXSPI use SCK2. */
+    uint32_t flashSize;                              /*!< Flash size in KByte. */
+    flexspi_cs_interval_cycle_unit_t CSIntervalUnit; /*!< CS interval unit, 1 or 256 cycle. */
+    uint16_t CSInterval;                             /*!< CS line assert interval, mutiply CS interval unit to
+                                                      get the CS line assert interval cycles. */
+    uint8_t CSHoldTime;                              /*!< CS line hold time. */
+    uint8_t CSSetupTime;                             /*!< CS line setup time. */
+    uint8_t dataValidTime;                           /*!< Data valid time for external device. */
+    uint8_t columnspace;                             /*!< Column space size. */
+    bool enableWordAddress;                          /*!< If enable word address.*/
+    uint8_t AWRSeqIndex;                             /*!< Sequence ID for AHB write command. */
+    uint8_t AWRSeqNumber;                            /*!< Sequence number for AHB write command. */
+    uint8_t ARDSeqIndex;                             /*!< Sequence ID for AHB read command. */
+    uint8_t ARDSeqNumber;                            /*!< Sequence number for AHB read command. */
+    flexspi_ahb_write_wait_unit_t AHBWriteWaitUnit;  /*!< AHB write wait unit. */
+    uint16_t AHBWriteWaitInterval;                   /*!< AHB write wait interval, mutiply AHB write interval
+                                                      unit to get the AHB write wait cycles. */
+    bool enableWriteMask;                            /*!< Enable/Disable FLEXSPI drive DQS pin as write mask
+                                                      when writing to external device. */
+} flexspi_device_config_t;
+
+/*! @brief Transfer structure for FLEXSPI. */
+typedef struct _flexspi_transfer
+{
+    uint32_t deviceAddress;         /*!< Operation device address. */
+    flexspi_port_t port;            /*!< Operation port. */
+    flexspi_command_type_t cmdType; /*!< Execution command type. */
+    uint8_t seqIndex;               /*!< Sequence ID for command. */
+    uint8_t SeqNumber;              /*!< Sequence number for command. */
+    uint32_t *data;                 /*!< Data buffer. */
+    size_t dataSize;                /*!< Data size in bytes. */
+} flexspi_transfer_t;
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+void FLEXSPI_Init(FLEXSPI_Type *base, const flexspi_config_t *config);
+void FLEXSPI_GetDefaultConfig(flexspi_config_t *config);
+void FLEXSPI_Deinit(FLEXSPI_Type *base);
+void FLEXSPI_SetFlashConfig(FLEXSPI_Type *base, flexspi_device_config_t *config, flexspi_port_t port);
+void FLEXSPI_SoftwareReset(FLEXSPI_Type *base);
+void FLEXSPI_UpdateLUT(FLEXSPI_Type *base, uint32_t index, const uint32_t *cmd, uint32_t count);
+status_t FLEXSPI_TransferBlocking(FLEXSPI_Type *base, flexspi_transfer_t *xfer);
+
+static inline void FLEXSPI_Enable(FLEXSPI_Type *base, bool enable)
+{
+    if (enable)
+    {
+        base->MCR0 &= ~FLEXSPI_MCR0_MDIS_MASK;
+    }
+    else
+    {
+        base->MCR0 |= FLEXSPI_MCR0_MDIS_MASK;
+    }
+}
+
+static inline void FLEXSPI_EnableAHBParallelMode(FLEXSPI_Type *base, bool enable)
+{
+    if (enable)
+    {
+        base->AHBCR |= FLEXSPI_AHBCR_APAREN_MASK;
+    }
+    else
+    {
+        base->AHBCR &= ~FLEXSPI_AHBCR_APAREN_MASK;
+    }
+}
+
+static inline bool FLEXSPI_GetBusIdleStatus(FLEXSPI_Type *base)
+{
+    return true;
+}
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif
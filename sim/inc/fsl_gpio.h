@@ -0,0 +1,32 @@
+/*
+ * Host-side simulator for the i.MXRT SFDP flashloader.
+ */
+
+#ifndef _SIM_FSL_GPIO_H_
+#define _SIM_FSL_GPIO_H_
+
+#include "fsl_common.h"
+
+typedef enum _gpio_pin_direction
+{
+    kGPIO_DigitalInput = 0U,
+    kGPIO_DigitalOutput = 1U,
+} gpio_pin_direction_t;
+
+typedef enum _gpio_interrupt_mode
+{
+    kGPIO_NoIntmode = 0U,
+} gpio_interrupt_mode_t;
+
+typedef struct _gpio_pin_config
+{
+    gpio_pin_direction_t direction;
+    uint8_t outputLogic;
+    gpio_interrupt_mode_t interruptMode;
+} gpio_pin_config_t;
+
+static inline void GPIO_PinInit(GPIO_Type *base, uint32_t pin, const gpio_pin_config_t *Config)
+{
+}
+
+#endif
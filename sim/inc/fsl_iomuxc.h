@@ -0,0 +1,16 @@
+/*
+ * Host-side simulator for the i.MXRT SFDP flashloader.
+ *
+ * Pin multiplexing has no effect on the host. The simulator is built
+ * without a board macro, so none of the pin tuples are referenced.
+ */
+
+#ifndef _SIM_FSL_IOMUXC_H_
+#define _SIM_FSL_IOMUXC_H_
+
+#include "fsl_common.h"
+
+#define IOMUXC_SetPinMux(...)       ((void)0)
+#define IOMUXC_SetPinConfig(...)    ((void)0)
+
+#endif
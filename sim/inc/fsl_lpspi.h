@@ -0,0 +1,129 @@
+/*
+ * Host-side simulator for the i.MXRT SFDP flashloader.
+ *
+ * LPSPI master driver interface (subset of KSDK 2.3 fsl_lpspi.h). Transfers
+ * are routed to the simulated NOR flash by sim/src/sim_lpspi.c. The FIFO
+ * accessors, inline register accesses in the KSDK, are functions here.
+ */
+
+#ifndef _SIM_FSL_LPSPI_H_
+#define _SIM_FSL_LPSPI_H_
+
+#include "fsl_common.h"
+
+enum _lpspi_status
+{
+    kStatus_LPSPI_Busy = MAKE_STATUS(kStatusGroup_LPSPI, 0),
+    kStatus_LPSPI_Error = MAKE_STATUS(kStatusGroup_LPSPI, 1),
+    kStatus_LPSPI_Idle = MAKE_STATUS(kStatusGroup_LPSPI, 2),
+};
+
+enum _lpspi_flags
+{
+    kLPSPI_TxDataRequestFlag = LPSPI_SR_TDF_MASK,
+    kLPSPI_RxDataReadyFlag = LPSPI_SR_RDF_MASK,
+    kLPSPI_FrameCompleteFlag = LPSPI_SR_FCF_MASK,
+    kLPSPI_TransferCompleteFlag = LPSPI_SR_TCF_MASK,
+    kLPSPI_ReceiveErrorFlag = LPSPI_SR_REF_MASK,
+    kLPSPI_ModuleBusyFlag = LPSPI_SR_MBF_MASK,
+    kLPSPI_AllStatusFlag = (LPSPI_SR_TDF_MASK | LPSPI_SR_RDF_MASK | LPSPI_SR_FCF_MASK | LPSPI_SR_TCF_MASK |
+                            LPSPI_SR_REF_MASK | LPSPI_SR_MBF_MASK)
+};
+
+typedef enum _lpspi_which_pcs_config
+{
+    kLPSPI_Pcs0 = 0U,
+    kLPSPI_Pcs1 = 1U,
+    kLPSPI_Pcs2 = 2U,
+    kLPSPI_Pcs3 = 3U
+} lpspi_which_pcs_t;
+
+typedef enum _lpspi_pcs_polarity_config
+{
+    kLPSPI_PcsActiveHigh = 1U,
+    kLPSPI_PcsActiveLow = 0U
+} lpspi_pcs_polarity_config_t;
+
+typedef enum _lpspi_clock_polarity
+{
+    kLPSPI_ClockPolarityActiveHigh = 0U,
+    kLPSPI_ClockPolarityActiveLow = 1U
+} lpspi_clock_polarity_t;
+
+typedef enum _lpspi_clock_phase
+{
+    kLPSPI_ClockPhaseFirstEdge = 0U,
+    kLPSPI_ClockPhaseSecondEdge = 1U
+} lpspi_clock_phase_t;
+
+typedef enum _lpspi_shift_direction
+{
+    kLPSPI_MsbFirst = 0U,
+    kLPSPI_LsbFirst = 1U
+} lpspi_shift_direction_t;
+
+typedef enum _lpspi_pin_config
+{
+    kLPSPI_SdiInSdoOut = 0U,
+    kLPSPI_SdiInSdiOut = 1U,
+    kLPSPI_SdoInSdoOut = 2U,
+    kLPSPI_SdoInSdiOut = 3U
+} lpspi_pin_config_t;
+
+typedef enum _lpspi_data_out_config
+{
+    kLpspiDataOutRetained = 0U,
+    kLpspiDataOutTristate = 1U
+} lpspi_data_out_config_t;
+
+#define LPSPI_MASTER_PCS_SHIFT (4U)
+
+enum _lpspi_transfer_config_flag_for_master
+{
+    kLPSPI_MasterPcs0 = 0U << LPSPI_MASTER_PCS_SHIFT,
+    kLPSPI_MasterPcs1 = 1U << LPSPI_MASTER_PCS_SHIFT,
+    kLPSPI_MasterPcs2 = 2U << LPSPI_MASTER_PCS_SHIFT,
+    kLPSPI_MasterPcs3 = 3U << LPSPI_MASTER_PCS_SHIFT,
+    kLPSPI_MasterPcsContinuous = 1U << 20,
+    kLPSPI_MasterByteSwap = 1U << 22
+};
+
+typedef struct _lpspi_master_config
+{
+    uint32_t baudRate;
+    uint32_t bitsPerFrame;
+    uint32_t pcsToSckDelayInNanoSec;
+    uint32_t lastSckToPcsDelayInNanoSec;
+    uint32_t betweenTransferDelayInNanoSec;
+    lpspi_clock_polarity_t cpol;
+    lpspi_clock_phase_t cpha;
+    lpspi_shift_direction_t direction;
+    lpspi_which_pcs_t whichPcs;
+    lpspi_pcs_polarity_config_t pcsActiveHighOrLow;
+    lpspi_pin_config_t pinCfg;
+    lpspi_data_out_config_t dataOutConfig;
+} lpspi_master_config_t;
+
+typedef struct _lpspi_transfer
+{
+    uint8_t *txData;
+    uint8_t *rxData;
+    volatile size_t dataSize;
+    uint32_t configFlags;
+} lpspi_transfer_t;
+
+void LPSPI_MasterInit(LPSPI_Type *base, const lpspi_master_config_t *masterConfig, uint32_t srcClock_Hz);
+void LPSPI_MasterGetDefaultConfig(lpspi_master_config_t *masterConfig);
+void LPSPI_Deinit(LPSPI_Type *base);
+void LPSPI_SetDummyData(LPSPI_Type *base, uint8_t dummyData);
+status_t LPSPI_MasterTransferBlocking(LPSPI_Type *base, lpspi_transfer_t *transfer);
+uint32_t LPSPI_GetStatusFlags(LPSPI_Type *base);
+void LPSPI_ClearStatusFlags(LPSPI_Type *base, uint32_t statusFlags);
+void LPSPI_FlushFifo(LPSPI_Type *base, bool flushTxFifo, bool flushRxFifo);
+uint32_t LPSPI_GetRxFifoSize(LPSPI_Type *base);
+uint32_t LPSPI_GetTxFifoCount(LPSPI_Type *base);
+uint32_t LPSPI_GetRxFifoCount(LPSPI_Type *base);
+void LPSPI_WriteData(LPSPI_Type *base, uint32_t data);
+uint32_t LPSPI_ReadData(LPSPI_Type *base);
+
+#endif
@@ -0,0 +1,69 @@
+/*
+ * Host-side simulator for the i.MXRT SFDP flashloader.
+ *
+ * LPUART driver interface (subset of KSDK 2.3 fsl_lpuart.h). The blocking
+ * transmitter and the transmit DMA request are modelled at the configured
+ * baud rate so that debug logging shows up in the simulated time.
+ */
+
+#ifndef _SIM_FSL_LPUART_H_
+#define _SIM_FSL_LPUART_H_
+
+#include "fsl_common.h"
+
+typedef enum _lpuart_parity_mode
+{
+    kLPUART_ParityDisabled = 0x0U,
+    kLPUART_ParityEven = 0x2U,
+    kLPUART_ParityOdd = 0x3U,
+} lpuart_parity_mode_t;
+
+typedef enum _lpuart_data_bits
+{
+    kLPUART_EightDataBits = 0x0U,
+    kLPUART_SevenDataBits = 0x1U,
+} lpuart_data_bits_t;
+
+typedef enum _lpuart_stop_bit_count
+{
+    kLPUART_OneStopBit = 0U,
+    kLPUART_TwoStopBit = 1U,
+} lpuart_stop_bit_count_t;
+
+enum _lpuart_flags
+{
+    kLPUART_TransmissionCompleteFlag = (1U << 22),
+};
+
+typedef struct _lpuart_config
+{
+    uint32_t baudRate_Bps;
+    lpuart_parity_mode_t parityMode;
+    lpuart_data_bits_t dataBitsCount;
+    bool isMsb;
+    lpuart_stop_bit_count_t stopBitCount;
+    uint8_t txFifoWatermark;
+    uint8_t rxFifoWatermark;
+    bool enableTx;
+    bool enableRx;
+} lpuart_config_t;
+
+status_t LPUART_Init(LPUART_Type *base, const lpuart_config_t *config, uint32_t srcClock_Hz);
+void LPUART_Deinit(LPUART_Type *base);
+void LPUART_GetDefaultConfig(lpuart_config_t *config);
+void LPUART_WriteBlocking(LPUART_Type *base, const uint8_t *data, size_t length);
+uint32_t LPUART_GetStatusFlags(LPUART_Type *base);
+
+static inline void LPUART_EnableTxDMA(LPUART_Type *base, bool enable)
+{
+    if (enable)
+    {
+        base->BAUD |= LPUART_BAUD_TDMAE_MASK;
+    }
+    else
+    {
+        base->BAUD &= ~LPUART_BAUD_TDMAE_MASK;
+    }
+}
+
+#endif
@@ -0,0 +1,14 @@
+/*
+ * Host-side simulator for the i.MXRT SFDP flashloader.
+ *
+ * Stand-in for the IAR <intrinsics.h>.
+ */
+
+#ifndef _SIM_INTRINSICS_H_
+#define _SIM_INTRINSICS_H_
+
+#define __no_operation()        ((void)0)
+#define __DSB()                 ((void)0)
+#define __ISB()                 ((void)0)
+
+#endif
@@ -0,0 +1,15 @@
+/*
+ * Host-side simulator for the i.MXRT SFDP flashloader.
+ *
+ * Forced-include header: maps the IAR language extensions used by the
+ * flashloader sources onto plain GCC so they can be built on Linux.
+ */
+
+#ifndef _SIM_COMPILER_H_
+#define _SIM_COMPILER_H_
+
+#define __root
+#define __no_init
+#define __ramfunc
+
+#endif
@@ -0,0 +1,165 @@
+/*
+ * Host-side simulator for the i.MXRT SFDP flashloader.
+ *
+ * Shared definitions of the simulated time base, the behavioral NOR flash
+ * and the statistics collected by the FLEXSPI / LPSPI / LPUART models.
+ */
+
+#ifndef _SIM_H_
+#define _SIM_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+////////////////////////////////////////////////////////////////////////////////
+
+/* FlexSPI AHB window as seen by the MCU */
+#define SIM_AHB_BASE                0x60000000UL
+#define SIM_AHB_SIZE                0x10000000UL
+
+/* OCRAM as linked by FlashIMXRT1050_RAM512K.icf, only the FlexRAM banks configured as OCRAM are mapped */
+#define SIM_OCRAM_BASE              0x20200000UL
+#define SIM_OCRAM_MAX_SIZE          0x80000UL
+
+/* number of FlexSPI chip selects: A1, A2, B1, B2 */
+#define SIM_PORT_NUM                4
+
+#define SIM_NS_PER_S                1000000000ULL
+#define SIM_US(x)                   ((uint64_t)(x) * 1000ULL)
+#define SIM_MS(x)                   ((uint64_t)(x) * 1000ULL * 1000ULL)
+
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * statistics collected by the peripheral models
+ */
+typedef struct {
+    uint64_t ip_cmds;                           /**< FlexSPI IP commands */
+    uint64_t ip_ns;                             /**< time spent in FlexSPI IP commands */
+    uint64_t poll_cmds;                         /**< status register reads (busy polling) */
+    uint64_t poll_ns;                           /**< time spent reading the status register */
+    uint64_t ahb_bursts;                        /**< AHB read bursts issued to the flash */
+    uint64_t ahb_bytes;                         /**< bytes fetched through the AHB window */
+    uint64_t ahb_ns;                            /**< time spent in AHB reads */
+    uint64_t lpspi_xfers;                       /**< LPSPI transfers */
+    uint64_t lpspi_ns;                          /**< time spent in LPSPI transfers */
+    uint64_t uart_bytes;                        /**< bytes written to the debug LPUART */
+    uint64_t uart_ns;                           /**< time spent in blocking LPUART writes or waiting for the log channel */
+    uint64_t page_programs;                     /**< page program commands accepted by the flash */
+    uint64_t program_bytes;                     /**< bytes programmed */
+    uint64_t erase_ops[4];                      /**< erase commands, indexed by profile erase type */
+    uint64_t chip_erases;                       /**< chip erase commands */
+    uint64_t octal_cmds;                        /**< 8D-8D-8D transactions */
+    uint64_t dtr_reads;                         /**< 1S-4D-4D read transactions */
+    uint64_t continuous_reads;                  /**< reads without opcode, the part in continuous read mode */
+    uint64_t protocol_errors;                   /**< sequences the flash could not decode */
+    uint64_t busy_violations;                   /**< commands sent while the flash was busy */
+    uint64_t write_rejects;                     /**< program/erase/status writes without WEL */
+    uint64_t nv_sr_writes;                      /**< status register writes enabled by 06h, non-volatile */
+} sim_stats_t;
+
+/**
+ * NOR flash timing and identification profile
+ */
+typedef struct {
+    const char *name;
+    uint8_t  jedec_id[3];                       /**< manufacturer, memory type, capacity */
+    uint32_t capacity;                          /**< bytes */
+    uint32_t page_size;                         /**< bytes */
+    uint32_t max_sck_hz;                        /**< highest SDR clock the part accepts */
+    uint8_t  sr_init[3];                        /**< status registers 1..3 at power up */
+    uint8_t  qer;                               /**< JESD216 quad enable requirement (DWORD15[22:20]) */
+    bool     volatile_sr;                       /**< 50h enables a status register write to the volatile copy only */
+    uint8_t  qpp_cmd;                           /**< quad page program opcode: 32h (1-1-4), 38h (1-4-4) */
+    bool     addr_4_byte;                       /**< part needs 4-byte addresses above 16 MB */
+    bool     instr_4b;                          /**< 4-byte address instructions and their SFDP table */
+    bool     octal;                             /**< octal part: 72h sets DTR OPI in CR2 (address 0, 02h) for 8D-8D-8D,
+                                                     xSPI profile 1.0 and octal DDR sequence tables in SFDP */
+    uint8_t  dtr_dummy;                         /**< mode + dummy clocks of the 1-4-4 DTR read EDh (EEh with
+                                                     instr_4b), 0: no DTR */
+    bool     continuous;                        /**< 0-4-4 continuous read: 1-4-4 mode bits A5h enter, Fh on IO0-3
+                                                     over the address and mode clocks exits */
+    uint32_t param_sectors;                     /**< hybrid part: bytes of parameter sectors, the only place erase[0]
+                                                     works, at the bottom or with SR2 bit 2 (TBPARM) at the top */
+    uint64_t t_pp_ns;                           /**< typical page program time */
+    uint64_t t_bp1_ns;                          /**< typical first byte program time */
+    uint64_t t_bp_ns;                           /**< typical additional byte program time */
+    uint64_t t_ce_ns;                           /**< typical chip erase time */
+    struct {
+        uint32_t size;                          /**< bytes, 0: not available */
+        uint8_t  cmd;
+        uint8_t  cmd_4b;                        /**< with 4-byte address when instr_4b, 0: none */
+        uint64_t t_ns;                          /**< typical erase time */
+    } erase[4];
+} sim_nor_profile_t;
+
+/**
+ * one bus transaction as driven by a controller (FlexSPI sequence or LPSPI frame)
+ */
+typedef struct {
+    bool     no_cmd;                            /**< the sequence starts at the address (continuous read) */
+    uint8_t  cmd;
+    uint8_t  cmd_pads;
+    bool     cmd_ddr;                           /**< opcode transferred on both clock edges */
+    bool     has_cmd_ext;                       /**< 8D-8D-8D: the second opcode byte */
+    uint8_t  cmd_ext;
+    bool     ddr;                               /**< transferred on both clock edges */
+    bool     has_addr;
+    uint32_t addr;
+    uint8_t  addr_bits;
+    uint8_t  addr_pads;
+    bool     has_mode;
+    uint8_t  mode;
+    uint32_t dummy_cycles;                      /**< mode + dummy clocks between address and data */
+    uint8_t  data_pads;
+    bool     data_write;                        /**< true: controller drives the data phase */
+    uint8_t *data;
+    size_t   data_len;
+} sim_nor_xfer_t;
+
+typedef struct sim_nor sim_nor_t;
+
+////////////////////////////////////////////////////////////////////////////////
+
+/* simulated time */
+extern uint64_t sim_now_ns;
+extern sim_stats_t sim_stats;
+extern bool sim_verbose;
+
+void sim_edma_advance(uint64_t ns);
+
+static inline void sim_advance_ns(uint64_t ns) {
+    sim_now_ns += ns;
+    sim_edma_advance(ns);
+}
+
+/* sim_nor.c */
+const sim_nor_profile_t *sim_nor_find_profile(const char *name);
+void sim_nor_list_profiles(void);
+sim_nor_t *sim_nor_create(const sim_nor_profile_t *profile);
+const sim_nor_profile_t *sim_nor_profile(const sim_nor_t *nor);
+uint8_t *sim_nor_array(sim_nor_t *nor);
+const uint8_t *sim_nor_sfdp(const sim_nor_t *nor, size_t *size);
+uint8_t sim_nor_last_cmd(const sim_nor_t *nor);
+bool sim_nor_is_busy(const sim_nor_t *nor);
+bool sim_nor_is_octal(const sim_nor_t *nor);
+bool sim_nor_quad_enabled(const sim_nor_t *nor);
+bool sim_nor_quad_enabled_at_power_up(const sim_nor_t *nor);
+bool sim_nor_execute(sim_nor_t *nor, sim_nor_xfer_t *xfer, bool *is_poll, bool *modifies);
+bool sim_nor_serial(sim_nor_t *nor, const uint8_t *tx, uint8_t *rx, size_t len);
+uint8_t sim_nor_serial_byte(sim_nor_t *nor, uint8_t tx);
+bool sim_nor_serial_end(sim_nor_t *nor);
+
+/* sim_board.c */
+bool sim_board_target_reserved(void);
+bool sim_board_map_ocram(void);
+
+/* sim_flexspi.c */
+extern sim_nor_t *sim_flexspi_port[SIM_PORT_NUM];
+bool sim_flexspi_map_ahb(void);
+
+/* sim_lpspi.c */
+extern sim_nor_t *sim_lpspi_device;
+
+#endif
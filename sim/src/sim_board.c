@@ -0,0 +1,298 @@
+/*
+ * Host-side simulator for the i.MXRT SFDP flashloader.
+ *
+ * Clock tree (CCM / PLL3) and debug LPUART models. Only the parts the
+ * flashloader touches are modelled: PLL3 PFD0 feeding LPSPI and FlexSPI,
+ * the dividers behind them, a blocking UART transmitter and the eDMA
+ * channel that feeds it one character per character time.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/personality.h>
+
+#include "clock_config.h"
+#include "fsl_gpio.h"
+#include "fsl_lpuart.h"
+
+#include "sim.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+#define USB1_PLL_HZ                 480000000UL
+#define CPU_CLK_HZ                  600000000UL
+#define AHB_CLK_HZ                  600000000UL
+#define IPG_CLK_HZ                  150000000UL
+
+/* busy loop of sfdp_port.c retry_delay_100us(), the only user of the core clock */
+#define RETRY_DELAY_NS              SIM_US(100)
+
+/* FlexRAM: 16 banks of 32 KB, unfused split of 128 KB ITCM, 128 KB DTCM and 256 KB OCRAM */
+#define FLEXRAM_BANK_NUM            16
+#define FLEXRAM_BANK_SIZE           0x8000UL
+#define FLEXRAM_BANK_CFG            0xFFAA5555UL
+
+LPUART_Type     SIM_LPUART1;
+DMA_Type        SIM_DMA0;
+DMAMUX_Type     SIM_DMAMUX;
+CCM_ANALOG_Type SIM_CCM_ANALOG;
+GPIO_Type       SIM_GPIO1;
+GPIO_Type       SIM_GPIO3;
+/* as left by the debugger macro file: bank configuration taken from GPR17 */
+IOMUXC_GPR_Type SIM_IOMUXC_GPR = {
+    .GPR16 = IOMUXC_GPR_GPR16_FLEXRAM_BANK_CFG_SEL_MASK,
+    .GPR17 = FLEXRAM_BANK_CFG,
+};
+
+uint64_t sim_now_ns;
+sim_stats_t sim_stats;
+bool sim_verbose;
+
+static bool usb1_pll_bypass;
+static uint8_t usb1_pfd_frac[4] = { 27, 16, 24, 19 };
+static uint32_t clock_div[kCLOCK_DivCount];
+static uint32_t clock_mux[kCLOCK_MuxCount];
+/* line time of the character LPUART1 is sending for the eDMA channel, bytes of its minor loop sent */
+static uint64_t lpuart_dma_ns;
+static uint32_t lpuart_dma_minor;
+
+////////////////////////////////////////////////////////////////////////////////
+
+void BOARD_BootClockRUN(void) {
+}
+
+void CLOCK_EnableClock(clock_ip_name_t name) {
+    (void)name;
+}
+
+void CLOCK_DisableClock(clock_ip_name_t name) {
+    (void)name;
+}
+
+void CLOCK_SetMux(clock_mux_t mux, uint32_t value) {
+    clock_mux[mux] = value;
+}
+
+void CLOCK_SetDiv(clock_div_t divider, uint32_t value) {
+    clock_div[divider] = value;
+}
+
+uint32_t CLOCK_GetDiv(clock_div_t divider) {
+    return clock_div[divider];
+}
+
+void CLOCK_SetPllBypass(CCM_ANALOG_Type *base, clock_pll_t pll, bool bypass) {
+    (void)base;
+    (void)pll;
+    usb1_pll_bypass = bypass;
+}
+
+void CLOCK_InitUsb1Pll(const clock_usb_pll_config_t *config) {
+    (void)config;
+    usb1_pll_bypass = false;
+}
+
+void CLOCK_InitUsb1Pfd(clock_pfd_t pfd, uint8_t pfdFrac) {
+    usb1_pfd_frac[pfd] = pfdFrac;
+}
+
+uint32_t CLOCK_GetPllFreq(clock_pll_t pll) {
+    (void)pll;
+    return usb1_pll_bypass ? 24000000UL : USB1_PLL_HZ;
+}
+
+uint32_t CLOCK_GetFreq(clock_name_t name) {
+    switch (name) {
+    case kCLOCK_CpuClk:
+        sim_advance_ns(RETRY_DELAY_NS);
+        return CPU_CLK_HZ;
+    case kCLOCK_AhbClk:
+        return AHB_CLK_HZ;
+    case kCLOCK_IpgClk:
+        return IPG_CLK_HZ;
+    case kCLOCK_Usb1PllClk:
+        return CLOCK_GetPllFreq(kCLOCK_PllUsb1);
+    case kCLOCK_Usb1PllPfd0Clk:
+        return (uint32_t)((uint64_t)CLOCK_GetPllFreq(kCLOCK_PllUsb1) * 18U / usb1_pfd_frac[kCLOCK_Pfd0]);
+    default:
+        return 0;
+    }
+}
+
+/* the AHB window and OCRAM are held by reserve_target_ranges() */
+static bool target_ranges_reserved;
+
+static bool reserve_range(uintptr_t base, size_t size) {
+    void *p = mmap((void *)base, size, PROT_NONE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED_NOREPLACE, -1, 0);
+
+    if (p != MAP_FAILED && p != (void *)base) {
+        munmap(p, size);
+    }
+    return p == (void *)base;
+}
+
+/**
+ * Reserve the AHB window and OCRAM at their target addresses before main()
+ * and before the NOR models allocate their arrays. With address space layout
+ * randomization a library can still sit in one of them, the simulator then
+ * runs itself once more with randomization off, where both are free.
+ */
+__attribute__((constructor)) static void reserve_target_ranges(int argc, char **argv, char **envp) {
+    int persona = personality(0xFFFFFFFF);
+
+    (void)argc;
+    target_ranges_reserved = reserve_range(SIM_AHB_BASE, SIM_AHB_SIZE) &&
+                             reserve_range(SIM_OCRAM_BASE, SIM_OCRAM_MAX_SIZE);
+    if (!target_ranges_reserved && persona != -1 && !(persona & ADDR_NO_RANDOMIZE) &&
+        personality((unsigned long)persona | ADDR_NO_RANDOMIZE) != -1) {
+        execve("/proc/self/exe", argv, envp);
+    }
+}
+
+/**
+ * Whether the AHB window and OCRAM could be reserved at process start, the
+ * models map over the reservation only.
+ */
+bool sim_board_target_reserved(void) {
+    return target_ranges_reserved;
+}
+
+/**
+ * Map the OCRAM banks of the FlexRAM configuration at their target address.
+ * Buffer accesses past them fault like on the target.
+ */
+bool sim_board_map_ocram(void) {
+    size_t size = 0;
+
+    for (int i = 0; i < FLEXRAM_BANK_NUM; i++) {
+        if (((SIM_IOMUXC_GPR.GPR17 >> (2 * i)) & 0x3) == 1) {
+            size += FLEXRAM_BANK_SIZE;
+        }
+    }
+    if (!target_ranges_reserved) {
+        return false;
+    }
+    if (size == 0) {
+        return true;
+    }
+    void *p = mmap((void *)SIM_OCRAM_BASE, size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+    return p == (void *)SIM_OCRAM_BASE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void LPUART_GetDefaultConfig(lpuart_config_t *config) {
+    memset(config, 0, sizeof(*config));
+    config->baudRate_Bps = 115200U;
+}
+
+status_t LPUART_Init(LPUART_Type *base, const lpuart_config_t *config, uint32_t srcClock_Hz) {
+    (void)srcClock_Hz;
+    base->BAUD = 0;
+    base->baud_bps = config->baudRate_Bps;
+    base->enabled = config->enableTx;
+    return kStatus_Success;
+}
+
+void LPUART_Deinit(LPUART_Type *base) {
+    base->BAUD = 0;
+    base->enabled = 0;
+}
+
+/* 8N1: ten bit times per character */
+static uint64_t lpuart_char_ns(const LPUART_Type *base, size_t length) {
+    return ((uint64_t)length * 10 * SIM_NS_PER_S + base->baud_bps - 1) / base->baud_bps;
+}
+
+static void lpuart_send(const uint8_t *data, size_t length) {
+    if (sim_verbose) {
+        for (size_t i = 0; i < length; i++) {
+            if (data[i] != '\r') {
+                fputc(data[i], stderr);
+            }
+        }
+    }
+    sim_stats.uart_bytes += length;
+}
+
+void LPUART_WriteBlocking(LPUART_Type *base, const uint8_t *data, size_t length) {
+    if (!base->enabled || base->baud_bps == 0) {
+        return;
+    }
+    lpuart_send(data, length);
+    uint64_t ns = lpuart_char_ns(base, length);
+    sim_advance_ns(ns);
+    sim_stats.uart_ns += ns;
+}
+
+/* the eDMA channel LPUART1 requests, -1 while none is enabled */
+static int lpuart_dma_channel(void) {
+    if (SIM_DMA0.ERQ == 0 || !(SIM_LPUART1.BAUD & LPUART_BAUD_TDMAE_MASK) || !SIM_LPUART1.enabled ||
+        SIM_LPUART1.baud_bps == 0) {
+        return -1;
+    }
+    for (int ch = 0; ch < 32; ch++) {
+        uint32_t chcfg = SIM_DMAMUX.CHCFG[ch];
+        if ((SIM_DMA0.ERQ & (1UL << ch)) && (chcfg & DMAMUX_CHCFG_ENBL_MASK) &&
+            chcfg == (DMAMUX_CHCFG_SOURCE(kDmaRequestMuxLPUART1Tx) | DMAMUX_CHCFG_ENBL_MASK)) {
+            return ch;
+        }
+    }
+    return -1;
+}
+
+/* TC stays clear while the channel has characters to send, a poll takes until the next one is out */
+uint32_t LPUART_GetStatusFlags(LPUART_Type *base) {
+    if (base != &SIM_LPUART1 || lpuart_dma_channel() < 0) {
+        return kLPUART_TransmissionCompleteFlag;
+    }
+    uint64_t ns = lpuart_char_ns(base, 1) - lpuart_dma_ns;
+    sim_advance_ns(ns);
+    sim_stats.uart_ns += ns;
+    return 0;
+}
+
+/**
+ * Let the LPUART1 transmit channel run for ns: a minor loop of NBYTES
+ * characters for every NBYTES character times, the source advancing by SOFF
+ * and the request disabled at the end of the major loop if DREQ is set.
+ */
+void sim_edma_advance(uint64_t ns) {
+    int ch = lpuart_dma_channel();
+
+    if (ch < 0) {
+        lpuart_dma_ns = 0;
+        lpuart_dma_minor = 0;
+        return;
+    }
+    __typeof__(SIM_DMA0.TCD[0]) *tcd = &SIM_DMA0.TCD[ch];
+    uint64_t char_ns = lpuart_char_ns(&SIM_LPUART1, 1);
+
+    lpuart_dma_ns += ns;
+    while (lpuart_dma_ns >= char_ns) {
+        uint8_t c = *(const uint8_t *)(uintptr_t)tcd->SADDR;
+
+        lpuart_dma_ns -= char_ns;
+        SIM_LPUART1.DATA = c;
+        lpuart_send(&c, 1);
+        tcd->SADDR += (int16_t)tcd->SOFF;
+        if (++lpuart_dma_minor < tcd->NBYTES_MLNO) {
+            continue;
+        }
+        lpuart_dma_minor = 0;
+        if (--tcd->CITER_ELINKNO == 0) {
+            tcd->SADDR += tcd->SLAST;
+            tcd->CITER_ELINKNO = tcd->BITER_ELINKNO;
+            tcd->CSR |= DMA_CSR_DONE_MASK;
+            if (tcd->CSR & DMA_CSR_DREQ_MASK) {
+                SIM_DMA0.ERQ &= ~(1UL << ch);
+                lpuart_dma_ns = 0;
+                break;
+            }
+        }
+    }
+}
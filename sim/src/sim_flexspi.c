@@ -0,0 +1,519 @@
+/*
+ * Host-side simulator for the i.MXRT SFDP flashloader.
+ *
+ * FlexSPI controller model: the KSDK driver entry points used by device.c,
+ * a LUT sequence interpreter and the AHB read window at 0x60000000. The AHB
+ * window is a PROT_NONE reservation; the first access to a 4 KB page faults,
+ * the page is fetched from the flash through the AHB read sequence and the
+ * bus time of every burst is charged to the simulated clock.
+ *
+ * AHB parallel mode (AHBCR[APAREN]) reads the parts on A1 and B1 at once,
+ * A1 supplies the even bytes and B1 the odd bytes of the window at half the
+ * window address. IP commands always address one part: like the KSDK driver,
+ * FLEXSPI_TransferBlocking writes IPCR1 without IPAREN, so the IP parallel mode
+ * is not modelled and the loader programs the two parts one after the other.
+ * Each part keeps its own busy time, a program on B1 runs while A1 is busy.
+ */
+
+#define _GNU_SOURCE
+
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "fsl_clock.h"
+#include "fsl_flexspi.h"
+
+#include "sim.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+#define LUT_SEQ_NUM                 16
+#define LUT_SEQ_INSTR               8
+
+#define AHB_PAGE_SIZE               4096UL
+/* unbuffered AHB read: one 64-bit AXI beat per flash transaction */
+#define AHB_BEAT_SIZE               8UL
+/* AHB master ID of the Cortex-M7 core */
+#define AHB_CORE_MASTER             0
+/* AHBRXBUFnCR0 reset value: 256 bytes, prefetch enabled */
+#define AHB_BUFFER_RESET            0x80000020UL
+
+/* controller side costs not visible on the bus */
+#define IP_CMD_OVERHEAD_NS          600ULL
+#define AHB_BURST_OVERHEAD_NS       100ULL
+
+/* highest DDR read SCK per read sample clock (MCR0 RXCLKSRC), SDR reads are not limited by the model */
+#define DDR_SCK_MAX_LOOPBACK_HZ     30000000UL
+#define DDR_SCK_MAX_PAD_LOOPBACK_HZ 66000000UL
+#define DDR_SCK_MAX_FLASH_DQS_HZ    166000000UL
+
+FLEXSPI_Type SIM_FLEXSPI;
+sim_nor_t *sim_flexspi_port[SIM_PORT_NUM];
+
+static bool ahb_mapped;
+/* LUT contents the AHB window was last filled with, to notice direct LUT writes */
+static uint32_t lut_shadow[LUT_SEQ_NUM * 4];
+/* instruction an AHB read sequence resumes at after a JMP_ON_CS, 0: from the start */
+static uint8_t ahb_resume[SIM_PORT_NUM][LUT_SEQ_NUM];
+
+////////////////////////////////////////////////////////////////////////////////
+
+static uint32_t root_clock_hz(void) {
+    return CLOCK_GetFreq(kCLOCK_Usb1PllPfd0Clk) / (CLOCK_GetDiv(kCLOCK_FlexspiDiv) + 1U);
+}
+
+static uint64_t cycles_to_ns(uint64_t cycles, uint32_t sck_hz) {
+    return (cycles * SIM_NS_PER_S + sck_hz - 1) / sck_hz;
+}
+
+/**
+ * Translate a FlexSPI address into a chip select and the address inside that device.
+ * FLSHCR0 sizes (KB) stack up as A1, A2, B1, B2.
+ */
+static int decode_port(const FLEXSPI_Type *base, uint32_t addr, uint32_t *offset) {
+    uint64_t start = 0;
+
+    for (int port = 0; port < SIM_PORT_NUM; port++) {
+        uint64_t size = (uint64_t)(base->FLSHCR0[port] & FLEXSPI_FLSHCR0_FLSHSZ_MASK) * 1024U;
+        if (addr >= start && addr < start + size) {
+            *offset = (uint32_t)(addr - start);
+            return port;
+        }
+        start += size;
+    }
+    return -1;
+}
+
+static void ahb_invalidate(void) {
+    if (ahb_mapped) {
+        mprotect((void *)SIM_AHB_BASE, SIM_AHB_SIZE, PROT_NONE);
+        ahb_mapped = false;
+    }
+}
+
+/*
+ * The loader also writes LUT words directly, the change is only seen at the
+ * next controller entry point or AHB page fault. Pages already filled keep
+ * their data like the AHB RX buffers do.
+ */
+static void lut_sync(const FLEXSPI_Type *base) {
+    if (memcmp(lut_shadow, (const void *)base->LUT, sizeof(lut_shadow)) != 0) {
+        memcpy(lut_shadow, (const void *)base->LUT, sizeof(lut_shadow));
+        ahb_invalidate();
+    }
+}
+
+/* only a software reset restarts the AHB read sequences from their first instruction, a LUT update does not */
+static void ahb_restart(void) {
+    memset(ahb_resume, 0, sizeof(ahb_resume));
+    ahb_invalidate();
+}
+
+/**
+ * Why the read data of a sequence cannot be sampled, NULL when it can. The
+ * flash DQS is only driven by a part in 8D-8D-8D.
+ */
+static const char *sample_error(const FLEXSPI_Type *base, int port, bool ddr, uint32_t sck_hz) {
+    switch ((base->MCR0 & FLEXSPI_MCR0_RXCLKSRC_MASK) >> FLEXSPI_MCR0_RXCLKSRC_SHIFT) {
+    case kFLEXSPI_ReadSampleClkLoopbackInternally:
+        return ddr && sck_hz > DDR_SCK_MAX_LOOPBACK_HZ ? "DDR read too fast for the internal loopback" : NULL;
+    case kFLEXSPI_ReadSampleClkExternalInputFromDqsPad:
+        if (port < 0 || sim_flexspi_port[port] == NULL || !sim_nor_is_octal(sim_flexspi_port[port])) {
+            return "read sampled on a DQS the flash does not drive";
+        }
+        return ddr && sck_hz > DDR_SCK_MAX_FLASH_DQS_HZ ? "DDR read too fast for the flash DQS" : NULL;
+    default:
+        return ddr && sck_hz > DDR_SCK_MAX_PAD_LOOPBACK_HZ ? "DDR read too fast for the pad loopback" : NULL;
+    }
+}
+
+/**
+ * Run one LUT sequence against the device on a chip select. The simulated
+ * clock is advanced by the bus time before the device acts on the command,
+ * as a flash starts programming or erasing only when CS is released.
+ * AHB reads resume at the instruction saved by the last JMP_ON_CS.
+ *
+ * @return bus time in ns, 0 when the sequence is malformed
+ */
+static uint64_t run_sequence(FLEXSPI_Type *base, int port, uint32_t addr, uint8_t seq, uint8_t *data,
+                             size_t size, bool ahb, bool *is_poll, bool *modifies) {
+    sim_nor_xfer_t xfer = { 0 };
+    uint64_t half_cycles = 0;
+    bool has_cmd = false;
+    bool ddr = false;
+    /* a sequence of SDR command bytes only is a raw 1S-1S-1S frame */
+    uint8_t raw[LUT_SEQ_INSTR];
+    size_t raw_len = 0;
+    bool only_cmds = true;
+    int first = (ahb && port >= 0) ? ahb_resume[port][seq] : 0;
+
+    *is_poll = false;
+    *modifies = false;
+
+    for (int i = first; i < LUT_SEQ_INSTR; i++) {
+        uint32_t word = base->LUT[seq * 4 + i / 2];
+        uint16_t instr = (uint16_t)((i & 1) ? (word >> 16) : word);
+        uint8_t opcode = (uint8_t)(instr >> 10);
+        uint8_t pads = (uint8_t)(1U << ((instr >> 8) & 0x3));
+        uint8_t operand = (uint8_t)instr;
+        /* DDR instructions transfer on both edges */
+        uint32_t per_clock = (opcode & 0x20) ? 2 : 1;
+
+        if (opcode == kFLEXSPI_Command_JUMP_ON_CS && ahb && port >= 0) {
+            ahb_resume[port][seq] = operand;
+        }
+        if (opcode == kFLEXSPI_Command_STOP || opcode == kFLEXSPI_Command_JUMP_ON_CS) {
+            break;
+        }
+        ddr |= (opcode & 0x20) != 0;
+        only_cmds &= (opcode & ~0x20) == kFLEXSPI_Command_SDR && pads == 1;
+        /* DATA4..7 of port A are the port B data pads */
+        if (pads == 8 && !(base->MCR0 & FLEXSPI_MCR0_COMBINATIONEN_MASK)) {
+            fprintf(stderr, "sim: FlexSPI LUT sequence %u uses 8 pads without combination mode\n", seq);
+            sim_stats.protocol_errors++;
+            return 0;
+        }
+
+        switch (opcode & ~0x20) {
+        case kFLEXSPI_Command_SDR:
+            if (!has_cmd) {
+                xfer.cmd = operand;
+                xfer.cmd_pads = pads;
+                xfer.cmd_ddr = (opcode & 0x20) != 0;
+                has_cmd = true;
+            } else if ((opcode & 0x20) && raw_len == 1) {
+                xfer.has_cmd_ext = true;
+                xfer.cmd_ext = operand;
+            }
+            raw[raw_len++] = operand;
+            half_cycles += 2 * 8 / (pads * per_clock);
+            break;
+        case kFLEXSPI_Command_RADDR_SDR:
+            xfer.has_addr = true;
+            xfer.addr = addr;
+            xfer.addr_bits = operand;
+            xfer.addr_pads = pads;
+            half_cycles += 2 * operand / (pads * per_clock);
+            break;
+        case kFLEXSPI_Command_CADDR_SDR:
+            half_cycles += 2 * operand / (pads * per_clock);
+            break;
+        case kFLEXSPI_Command_MODE1_SDR:
+        case kFLEXSPI_Command_MODE2_SDR:
+        case kFLEXSPI_Command_MODE4_SDR:
+        case kFLEXSPI_Command_MODE8_SDR: {
+            uint32_t bits = 1U << ((opcode & ~0x20) - kFLEXSPI_Command_MODE1_SDR);
+            uint32_t clocks = (bits + pads * per_clock - 1) / (pads * per_clock);
+            xfer.has_mode = true;
+            xfer.mode = operand;
+            xfer.dummy_cycles += clocks;
+            half_cycles += 2 * clocks;
+            break;
+        }
+        case kFLEXSPI_Command_DUMMY_SDR:
+            /* DDR dummy operands count half cycles */
+            xfer.dummy_cycles += operand / per_clock;
+            half_cycles += 2 * operand / per_clock;
+            break;
+        case kFLEXSPI_Command_WRITE_SDR:
+        case kFLEXSPI_Command_READ_SDR:
+            xfer.data_pads = pads;
+            xfer.data_write = (opcode & ~0x20) == kFLEXSPI_Command_WRITE_SDR;
+            xfer.data = data;
+            xfer.data_len = size;
+            half_cycles += 2 * ((uint64_t)size * 8 + pads * per_clock - 1) / (pads * per_clock);
+            break;
+        default:
+            fprintf(stderr, "sim: FlexSPI LUT sequence %u uses unsupported instruction %02Xh\n", seq, opcode);
+            return 0;
+        }
+    }
+    if (!has_cmd && first == 0) {
+        fprintf(stderr, "sim: FlexSPI LUT sequence %u has no command\n", seq);
+        return 0;
+    }
+    xfer.no_cmd = !has_cmd;
+
+    /* DDR sequences run SCK at half the root clock, CS setup + hold + interval */
+    uint32_t sck_hz = root_clock_hz() / (ddr ? 2 : 1);
+    uint32_t flshcr1 = base->FLSHCR1[port < 0 ? 0 : port];
+    uint64_t cs_cycles = (flshcr1 & 0x1F) + ((flshcr1 >> 5) & 0x1F) + 2;
+    uint64_t ns = cycles_to_ns((half_cycles + 1) / 2 + cs_cycles, sck_hz);
+
+    xfer.ddr = ddr;
+    sim_advance_ns(ns);
+    if (port >= 0 && sim_flexspi_port[port] != NULL && has_cmd && only_cmds && !ddr && raw_len > 1) {
+        sim_nor_serial(sim_flexspi_port[port], raw, NULL, raw_len);
+        *modifies = true;
+    } else if (port >= 0 && sim_flexspi_port[port] != NULL) {
+        sim_nor_execute(sim_flexspi_port[port], &xfer, is_poll, modifies);
+    } else if (xfer.data && !xfer.data_write) {
+        /* no device on this chip select, pulled-up data lines */
+        memset(data, 0xFF, size);
+    }
+
+    const char *why = (xfer.data && !xfer.data_write) ? sample_error(base, port, ddr, sck_hz) : NULL;
+    if (why != NULL) {
+        if (sim_stats.protocol_errors++ < 8) {
+            fprintf(stderr, "sim: FlexSPI LUT sequence %u at %lu Hz SCK: %s\n", seq, (unsigned long)sck_hz, why);
+        }
+        for (size_t i = 0; i < size; i++) {
+            data[i] = (uint8_t)(0x5A ^ (i * 3));
+        }
+    }
+    return ns;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Run an AHB read sequence on A1 and B1 together and interleave their data.
+ * Both buses run at the same time, the slower one sets the bus time.
+ */
+static uint64_t run_parallel_read(FLEXSPI_Type *base, uint32_t offset, uint8_t seq, uint8_t *data, size_t size) {
+    static const int ports[2] = { kFLEXSPI_PortA1, kFLEXSPI_PortB1 };
+    uint8_t half[2][AHB_PAGE_SIZE / 2];
+    uint64_t start = sim_now_ns;
+    uint64_t ns = 0;
+
+    for (int i = 0; i < 2; i++) {
+        bool is_poll, modifies;
+        sim_now_ns = start;
+        uint64_t t = run_sequence(base, ports[i], offset, seq, half[i], size / 2, true, &is_poll, &modifies);
+        if (t > ns) {
+            ns = t;
+        }
+    }
+    sim_now_ns = start + ns;
+    for (size_t i = 0; i < size; i++) {
+        data[i] = half[i & 1][i >> 1];
+    }
+    return ns;
+}
+
+/**
+ * Bytes fetched from the flash per AHB read of the core (master 0). The core
+ * uses the first of buffers 0..2 assigned to it, or the all-master buffer 3;
+ * without a prefetching buffer every AXI beat becomes its own flash read.
+ */
+static size_t ahb_burst_size(const FLEXSPI_Type *base) {
+    uint32_t buf = base->AHBRXBUFCR0[FSL_FEATURE_FLEXSPI_AHB_BUFFER_COUNT - 1];
+
+    for (int i = 0; i < FSL_FEATURE_FLEXSPI_AHB_BUFFER_COUNT - 1; i++) {
+        if ((base->AHBRXBUFCR0[i] & FLEXSPI_AHBRXBUFCR0_MSTRID_MASK) == FLEXSPI_AHBRXBUFCR0_MSTRID(AHB_CORE_MASTER)) {
+            buf = base->AHBRXBUFCR0[i];
+            break;
+        }
+    }
+
+    size_t size = (buf & FLEXSPI_AHBRXBUFCR0_BUFSZ_MASK) * 8U;
+    if (!(base->AHBCR & FLEXSPI_AHBCR_PREFETCHEN_MASK) || !(buf & FLEXSPI_AHBRXBUFCR0_PREFETCHEN_MASK) ||
+        size < AHB_BEAT_SIZE) {
+        return AHB_BEAT_SIZE;
+    }
+    return size < AHB_PAGE_SIZE ? size : AHB_PAGE_SIZE;
+}
+
+/**
+ * Fill one AHB page the way the controller would: a read sequence per AHB burst.
+ */
+static bool ahb_fill(uintptr_t page) {
+    uint32_t offset;
+    uint32_t flex_addr = (uint32_t)(page - SIM_AHB_BASE);
+    bool parallel = (SIM_FLEXSPI.AHBCR & FLEXSPI_AHBCR_APAREN_MASK) != 0;
+    int port;
+
+    if (parallel) {
+        uint64_t size = (uint64_t)(SIM_FLEXSPI.FLSHCR0[kFLEXSPI_PortA1] & FLEXSPI_FLSHCR0_FLSHSZ_MASK) * 1024U;
+        port = flex_addr < 2 * size ? kFLEXSPI_PortA1 : -1;
+        offset = flex_addr / 2;
+    } else {
+        port = decode_port(&SIM_FLEXSPI, flex_addr, &offset);
+    }
+
+    if (port < 0 || (SIM_FLEXSPI.MCR0 & FLEXSPI_MCR0_MDIS_MASK)) {
+        return false;
+    }
+    lut_sync(&SIM_FLEXSPI);
+
+    uint8_t seq = (uint8_t)(SIM_FLEXSPI.FLSHCR2[port] & FLEXSPI_FLSHCR2_ARDSEQID_MASK);
+    size_t burst = ahb_burst_size(&SIM_FLEXSPI);
+
+    mprotect((void *)page, AHB_PAGE_SIZE, PROT_READ | PROT_WRITE);
+    for (size_t pos = 0; pos < AHB_PAGE_SIZE; pos += burst) {
+        bool is_poll, modifies;
+        uint64_t ns = parallel ? run_parallel_read(&SIM_FLEXSPI, offset + pos / 2, seq, (uint8_t *)page + pos, burst)
+                               : run_sequence(&SIM_FLEXSPI, port, offset + pos, seq, (uint8_t *)page + pos, burst,
+                                              true, &is_poll, &modifies);
+        ns += AHB_BURST_OVERHEAD_NS;
+        sim_advance_ns(AHB_BURST_OVERHEAD_NS);
+        sim_stats.ahb_bursts++;
+        sim_stats.ahb_bytes += burst;
+        sim_stats.ahb_ns += ns;
+    }
+    mprotect((void *)page, AHB_PAGE_SIZE, PROT_READ);
+    ahb_mapped = true;
+    return true;
+}
+
+static void ahb_fault(int sig, siginfo_t *info, void *context) {
+    uintptr_t addr = (uintptr_t)info->si_addr;
+
+    (void)context;
+    if (addr >= SIM_AHB_BASE && addr < SIM_AHB_BASE + SIM_AHB_SIZE &&
+        ahb_fill(addr & ~(AHB_PAGE_SIZE - 1))) {
+        return;
+    }
+    /* a real bus fault: let the default action dump core */
+    signal(sig, SIG_DFL);
+}
+
+/**
+ * Map the AHB window over its reservation at the MCU address and hook page
+ * faults on it.
+ */
+bool sim_flexspi_map_ahb(void) {
+    if (!sim_board_target_reserved()) {
+        return false;
+    }
+    void *p = mmap((void *)SIM_AHB_BASE, SIM_AHB_SIZE, PROT_NONE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+    if (p != (void *)SIM_AHB_BASE) {
+        return false;
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = ahb_fault;
+    sa.sa_flags = SA_SIGINFO | SA_NODEFER;
+    sigemptyset(&sa.sa_mask);
+    return sigaction(SIGSEGV, &sa, NULL) == 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void FLEXSPI_GetDefaultConfig(flexspi_config_t *config) {
+    memset(config, 0, sizeof(*config));
+    config->rxSampleClock = kFLEXSPI_ReadSampleClkLoopbackInternally;
+    config->enableDoze = true;
+    config->seqTimeoutCycle = 0xFFFFU;
+    config->ipGrantTimeoutCycle = 0xFFU;
+    config->txWatermark = 8;
+    config->rxWatermark = 8;
+    config->ahbConfig.ahbGrantTimeoutCycle = 0xFFU;
+    config->ahbConfig.ahbBusTimeoutCycle = 0xFFFFU;
+    config->ahbConfig.resumeWaitCycle = 0x20U;
+}
+
+/* leaves the module disabled (MDIS) until FLEXSPI_SetFlashConfig, as the KSDK 2.3 driver does */
+void FLEXSPI_Init(FLEXSPI_Type *base, const flexspi_config_t *config) {
+    ahb_restart();
+
+    base->MCR0 = FLEXSPI_MCR0_RXCLKSRC(config->rxSampleClock) |
+                 (config->enableCombination ? FLEXSPI_MCR0_COMBINATIONEN_MASK : 0) | FLEXSPI_MCR0_MDIS_MASK;
+    base->AHBCR = (config->ahbConfig.enableAHBPrefetch ? FLEXSPI_AHBCR_PREFETCHEN_MASK : 0) |
+                  (config->ahbConfig.enableAHBBufferable ? FLEXSPI_AHBCR_BUFFERABLEEN_MASK : 0) |
+                  (config->ahbConfig.enableAHBCachable ? FLEXSPI_AHBCR_CACHABLEEN_MASK : 0);
+    /* the driver leaves the last buffer at its reset value */
+    for (int i = 0; i < FSL_FEATURE_FLEXSPI_AHB_BUFFER_COUNT - 1; i++) {
+        base->AHBRXBUFCR0[i] = FLEXSPI_AHBRXBUFCR0_PRIORITY(config->ahbConfig.buffer[i].priority) |
+                               FLEXSPI_AHBRXBUFCR0_MSTRID(config->ahbConfig.buffer[i].masterIndex) |
+                               FLEXSPI_AHBRXBUFCR0_BUFSZ(config->ahbConfig.buffer[i].bufferSize / 8U);
+    }
+    base->AHBRXBUFCR0[FSL_FEATURE_FLEXSPI_AHB_BUFFER_COUNT - 1] = AHB_BUFFER_RESET;
+    for (int i = 0; i < SIM_PORT_NUM; i++) {
+        base->FLSHCR0[i] = 0;
+    }
+}
+
+void FLEXSPI_Deinit(FLEXSPI_Type *base) {
+    FLEXSPI_SoftwareReset(base);
+}
+
+/* the KSDK 2.3 driver clears FLSHCR0[port >> 1] first, that is A1 when configuring A2 and A2 for B1/B2 */
+void FLEXSPI_SetFlashConfig(FLEXSPI_Type *base, flexspi_device_config_t *config, flexspi_port_t port) {
+    base->FLSHCR0[port >> 1] = 0;
+    base->FLSHCR0[port] = config->flashSize & FLEXSPI_FLSHCR0_FLSHSZ_MASK;
+    base->FLSHCR1[port] = (uint32_t)config->CSSetupTime | ((uint32_t)config->CSHoldTime << 5);
+    base->FLSHCR2[port] = FLEXSPI_FLSHCR2_ARDSEQID(config->ARDSeqIndex) |
+                          FLEXSPI_FLSHCR2_ARDSEQNUM(config->ARDSeqNumber - 1U);
+    base->MCR0 &= ~FLEXSPI_MCR0_MDIS_MASK;
+    ahb_invalidate();
+}
+
+void FLEXSPI_SoftwareReset(FLEXSPI_Type *base) {
+    lut_sync(base);
+    ahb_restart();
+    sim_advance_ns(IP_CMD_OVERHEAD_NS);
+}
+
+/*
+ * Loop bounds of the RT1021 driver: count words from index. The RT1052 driver
+ * copies count - index words, any index but 0 loads a different LUT on the
+ * two parts and is a protocol error, as is a write past the LUT end.
+ */
+void FLEXSPI_UpdateLUT(FLEXSPI_Type *base, uint32_t index, const uint32_t *cmd, uint32_t count) {
+    if (index != 0 || count > LUT_SEQ_NUM * 4) {
+        fprintf(stderr, "sim: FLEXSPI_UpdateLUT(%u, %u) %s\n", index, count,
+                index != 0 ? "depends on the driver version" : "writes past the LUT");
+        sim_stats.protocol_errors++;
+        return;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        base->LUT[index + i] = cmd[i];
+    }
+    lut_sync(base);
+}
+
+status_t FLEXSPI_TransferBlocking(FLEXSPI_Type *base, flexspi_transfer_t *xfer) {
+    uint32_t offset;
+    int port = decode_port(base, xfer->deviceAddress, &offset);
+    uint8_t *data = (uint8_t *)xfer->data;
+    size_t size = xfer->dataSize;
+    uint64_t ns = IP_CMD_OVERHEAD_NS;
+    bool is_poll = false, modifies = false;
+
+    lut_sync(base);
+    if (base->MCR0 & FLEXSPI_MCR0_MDIS_MASK) {
+        return kStatus_FLEXSPI_IpCommandGrantTimeout;
+    }
+    if (port < 0 || xfer->seqIndex >= LUT_SEQ_NUM || xfer->SeqNumber == 0) {
+        return kStatus_FLEXSPI_IpCommandSequenceError;
+    }
+    if (xfer->cmdType == kFLEXSPI_Command || xfer->cmdType == kFLEXSPI_Config) {
+        data = NULL;
+        size = 0;
+    }
+    if (size > FLEXSPI_IPCR1_IDATSZ_MASK) {
+        return kStatus_InvalidArgument;
+    }
+    base->IPCR0 = xfer->deviceAddress;
+    base->IPCR1 = FLEXSPI_IPCR1_IDATSZ(size) | FLEXSPI_IPCR1_ISEQID(xfer->seqIndex) |
+                  FLEXSPI_IPCR1_ISEQNUM(xfer->SeqNumber - 1U);
+
+    for (uint8_t i = 0; i < xfer->SeqNumber; i++) {
+        bool poll, mod;
+        uint64_t t = run_sequence(base, port, offset, (uint8_t)(xfer->seqIndex + i), data, size, false, &poll,
+                                  &mod);
+        if (t == 0) {
+            return kStatus_FLEXSPI_IpCommandSequenceError;
+        }
+        ns += t;
+        is_poll |= poll;
+        modifies |= mod;
+    }
+
+    sim_advance_ns(IP_CMD_OVERHEAD_NS);
+    sim_stats.ip_cmds++;
+    sim_stats.ip_ns += ns;
+    if (is_poll) {
+        sim_stats.poll_cmds++;
+        sim_stats.poll_ns += ns;
+    }
+    if (modifies) {
+        ahb_invalidate();
+    }
+    return kStatus_Success;
+}
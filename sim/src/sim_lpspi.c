@@ -0,0 +1,214 @@
+/*
+ * Host-side simulator for the i.MXRT SFDP flashloader.
+ *
+ * LPSPI master model. On the boards LPSPI2 shares the pins of FlexSPI port A1
+ * so the SFDP discovery talks to the same flash device. Blocking transfers and
+ * 8-bit frames pushed through the FIFOs are modelled; a continuous command
+ * (TCR[CONT]) keeps PCS asserted until CONT is cleared, which the model sees at
+ * the next FIFO or status access.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "fsl_lpspi.h"
+
+#include "sim.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+/* driver overhead per blocking transfer or PCS frame: FIFO setup, TCR write, status polling */
+#define LPSPI_XFER_OVERHEAD_NS      2000ULL
+
+#define LPSPI_FIFO_SIZE             16
+
+LPSPI_Type SIM_LPSPI2;
+sim_nor_t *sim_lpspi_device;
+
+////////////////////////////////////////////////////////////////////////////////
+
+void LPSPI_MasterGetDefaultConfig(lpspi_master_config_t *masterConfig) {
+    memset(masterConfig, 0, sizeof(*masterConfig));
+    masterConfig->baudRate = 500000;
+    masterConfig->bitsPerFrame = 8;
+    masterConfig->pcsToSckDelayInNanoSec = 1000000000 / masterConfig->baudRate / 2;
+    masterConfig->lastSckToPcsDelayInNanoSec = 1000000000 / masterConfig->baudRate / 2;
+    masterConfig->betweenTransferDelayInNanoSec = 1000000000 / masterConfig->baudRate / 2;
+}
+
+/* SCK = src / (2^prescale * (SCKDIV + 2)), closest rate not above the request */
+void LPSPI_MasterInit(LPSPI_Type *base, const lpspi_master_config_t *masterConfig, uint32_t srcClock_Hz) {
+    uint32_t best = 0;
+
+    for (uint32_t prescale = 0; prescale < 8; prescale++) {
+        for (uint32_t div = 0; div < 256; div++) {
+            uint32_t rate = srcClock_Hz / ((1U << prescale) * (div + 2));
+            if (rate <= masterConfig->baudRate && rate > best) {
+                best = rate;
+            }
+        }
+    }
+    base->baud_hz = best ? best : 1;
+    base->delay_ns = masterConfig->pcsToSckDelayInNanoSec + masterConfig->lastSckToPcsDelayInNanoSec +
+                     masterConfig->betweenTransferDelayInNanoSec;
+    base->dummy = 0x00;
+    base->enabled = 1;
+}
+
+/* PCS of a continuous frame negates once TCR[CONT] is cleared */
+static void pcs_update(LPSPI_Type *base, bool negate) {
+    if (base->pcs_asserted && (negate || !(base->TCR & LPSPI_TCR_CONT_MASK))) {
+        base->pcs_asserted = 0;
+        if (sim_lpspi_device != NULL) {
+            sim_nor_serial_end(sim_lpspi_device);
+        }
+    }
+}
+
+static void lpspi_advance_ns(uint64_t ns) {
+    sim_advance_ns(ns);
+    sim_stats.lpspi_ns += ns;
+}
+
+void LPSPI_Deinit(LPSPI_Type *base) {
+    pcs_update(base, true);
+    base->enabled = 0;
+}
+
+void LPSPI_SetDummyData(LPSPI_Type *base, uint8_t dummyData) {
+    base->dummy = dummyData;
+}
+
+status_t LPSPI_MasterTransferBlocking(LPSPI_Type *base, lpspi_transfer_t *transfer) {
+    size_t size = transfer->dataSize;
+
+    if (!base->enabled) {
+        return kStatus_LPSPI_Error;
+    }
+    pcs_update(base, false);
+    if (size == 0) {
+        return kStatus_InvalidArgument;
+    }
+
+    uint8_t *tx = malloc(size);
+    uint8_t *rx = malloc(size);
+    if (tx == NULL || rx == NULL) {
+        free(tx);
+        free(rx);
+        return kStatus_Fail;
+    }
+    if (transfer->txData) {
+        memcpy(tx, transfer->txData, size);
+    } else {
+        memset(tx, base->dummy, size);
+    }
+    memset(rx, 0xFF, size);
+
+    if (sim_lpspi_device != NULL) {
+        if (transfer->configFlags & kLPSPI_MasterPcsContinuous) {
+            sim_nor_serial(sim_lpspi_device, tx, rx, size);
+        } else {
+            /* PCS toggles after every frame */
+            for (size_t i = 0; i < size; i++) {
+                sim_nor_serial(sim_lpspi_device, &tx[i], &rx[i], 1);
+            }
+        }
+    }
+    if (transfer->rxData) {
+        memcpy(transfer->rxData, rx, size);
+    }
+    free(tx);
+    free(rx);
+
+    uint64_t ns = LPSPI_XFER_OVERHEAD_NS + base->delay_ns +
+                  ((uint64_t)size * 8 * SIM_NS_PER_S + base->baud_hz - 1) / base->baud_hz;
+    lpspi_advance_ns(ns);
+    sim_stats.lpspi_xfers++;
+    return kStatus_Success;
+}
+
+uint32_t LPSPI_GetStatusFlags(LPSPI_Type *base) {
+    uint32_t flags = kLPSPI_TxDataRequestFlag;
+
+    pcs_update(base, false);
+    if (base->rx_count) {
+        flags |= kLPSPI_RxDataReadyFlag;
+    }
+    if (base->rx_error) {
+        flags |= kLPSPI_ReceiveErrorFlag;
+    }
+    if (base->pcs_asserted) {
+        flags |= kLPSPI_ModuleBusyFlag;
+    } else {
+        flags |= kLPSPI_FrameCompleteFlag | kLPSPI_TransferCompleteFlag;
+    }
+    return flags;
+}
+
+void LPSPI_ClearStatusFlags(LPSPI_Type *base, uint32_t statusFlags) {
+    if (statusFlags & kLPSPI_ReceiveErrorFlag) {
+        base->rx_error = 0;
+    }
+}
+
+void LPSPI_FlushFifo(LPSPI_Type *base, bool flushTxFifo, bool flushRxFifo) {
+    pcs_update(base, false);
+    if (flushRxFifo) {
+        base->rx_count = 0;
+    }
+}
+
+uint32_t LPSPI_GetRxFifoSize(LPSPI_Type *base) {
+    return LPSPI_FIFO_SIZE;
+}
+
+/* frames leave the TX FIFO as they are written */
+uint32_t LPSPI_GetTxFifoCount(LPSPI_Type *base) {
+    return 0;
+}
+
+uint32_t LPSPI_GetRxFifoCount(LPSPI_Type *base) {
+    return base->rx_count;
+}
+
+void LPSPI_WriteData(LPSPI_Type *base, uint32_t data) {
+    uint8_t rx = 0xFF;
+
+    if (!base->enabled) {
+        return;
+    }
+    pcs_update(base, false);
+    if (!base->pcs_asserted) {
+        lpspi_advance_ns(LPSPI_XFER_OVERHEAD_NS + base->delay_ns);
+        sim_stats.lpspi_xfers++;
+        base->pcs_asserted = 1;
+    }
+    if (sim_lpspi_device != NULL) {
+        rx = sim_nor_serial_byte(sim_lpspi_device, (uint8_t)data);
+    }
+    lpspi_advance_ns((8 * SIM_NS_PER_S + base->baud_hz - 1) / base->baud_hz);
+    /* without CONT PCS toggles after every frame */
+    pcs_update(base, false);
+
+    if (base->TCR & LPSPI_TCR_RXMSK_MASK) {
+        return;
+    }
+    if (base->rx_count == LPSPI_FIFO_SIZE) {
+        base->rx_error = 1;
+        return;
+    }
+    base->rx_fifo[(base->rx_head + base->rx_count) % LPSPI_FIFO_SIZE] = rx;
+    base->rx_count++;
+}
+
+uint32_t LPSPI_ReadData(LPSPI_Type *base) {
+    uint8_t data;
+
+    if (base->rx_count == 0) {
+        return 0;
+    }
+    data = base->rx_fifo[base->rx_head];
+    base->rx_head = (base->rx_head + 1) % LPSPI_FIFO_SIZE;
+    base->rx_count--;
+    return data;
+}
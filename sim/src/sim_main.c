@@ -0,0 +1,734 @@
+/*
+ * Host-side simulator for the i.MXRT SFDP flashloader.
+ *
+ * Download bench: plays the part of C-SPY against the unmodified flashloader
+ * entry points (Fl2FlashInitEntry & co.) the same way the debugger does over
+ * SWD, with a behavioral NOR flash behind the FlexSPI / LPSPI models. All
+ * times are simulated bus and device times, not host run time.
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "flash_loader.h"
+#include "flash_loader_extra.h"
+#include "sfdp.h"
+
+#include "sim.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+/* RAM buffer between FlashBufferStart and FlashBufferEnd, as placed by the .icf over the whole OCRAM */
+#define SIM_BUFFER_SIZE             SIM_OCRAM_MAX_SIZE
+
+#define SIM_STR(x)                  #x
+#define SIM_XSTR(x)                 SIM_STR(x)
+
+__asm__(".globl FlashBufferStart\n"
+        ".set FlashBufferStart, " SIM_XSTR(SIM_OCRAM_BASE) "\n"
+        ".globl FlashBufferEnd\n"
+        ".set FlashBufferEnd, " SIM_XSTR(SIM_OCRAM_BASE) " + " SIM_XSTR(SIM_OCRAM_MAX_SIZE) " - 1\n");
+
+#define MAX_LAYOUT_REGIONS          8
+
+/* framework glue, flash_loader.c */
+extern int __argc;
+extern char __argvbuf[];
+extern const char *__argv[];
+void Fl2FlashInitEntry(void);
+void Fl2FlashWriteEntry(void);
+void Fl2FlashEraseWriteEntry(void);
+void Fl2FlashChecksumEntry(void);
+void Fl2FlashSignoffEntry(void);
+
+typedef struct {
+    uint32_t count;
+    uint32_t size;
+} layout_region_t;
+
+typedef struct {
+    uint32_t flash_base;
+    uint32_t page_size;
+    uint32_t buffer_size;
+    layout_region_t layout[MAX_LAYOUT_REGIONS];
+    int layout_num;
+    bool erase_list;
+    uint32_t swd_khz;
+    uint64_t call_ns;
+} cspy_t;
+
+typedef struct {
+    uint64_t init;
+    uint64_t erase;
+    uint64_t write;
+    uint64_t checksum;
+    uint64_t signoff;
+    uint64_t debugger;
+    uint64_t readback;
+} phase_times_t;
+
+static cspy_t cspy = {
+    .flash_base = SIM_AHB_BASE,
+    .page_size = 256,
+    .layout = { { 4096, 0x1000 } },
+    .layout_num = 1,
+    .erase_list = true,
+    .swd_khz = 1000,
+    .call_ns = SIM_US(1500),
+};
+
+static phase_times_t phase;
+static bool loader_has_checksum = true;
+
+/* --parallel: the parts on A1 and B1 form one array, A1 holds the even bytes */
+static bool parallel;
+
+/* --profile a,b,..: one device per chip select, their windows follow each other */
+static int devices = 1;
+
+////////////////////////////////////////////////////////////////////////////////
+
+/* C-SPY verifies by reading the image back over SWD when the loader has no FlashChecksum */
+__attribute__((weak)) uint32_t FlashChecksum(void const *begin, uint32_t count) {
+    (void)begin;
+    (void)count;
+    loader_has_checksum = false;
+    return 0;
+}
+
+/* SWD memory access: about 46 bit times per 32-bit word including protocol overhead */
+static uint64_t swd_ns(uint64_t bytes) {
+    uint64_t bits = (bytes + 3) / 4 * 46;
+    return bits * SIM_NS_PER_S / ((uint64_t)cspy.swd_khz * 1000U);
+}
+
+static void debugger_advance(uint64_t ns) {
+    sim_advance_ns(ns);
+    phase.debugger += ns;
+}
+
+/**
+ * Let the target run one framework entry, charging the halt/resume round trip.
+ */
+static uint32_t call_entry(void (*entry)(void), uint64_t *bucket) {
+    debugger_advance(cspy.call_ns);
+    uint64_t start = sim_now_ns;
+    entry();
+    *bucket += sim_now_ns - start;
+    return theFlashParams.count;
+}
+
+static char *buffer_base(void) {
+    char *p = &FlashBufferStart;
+    /* the symbol spans the whole buffer, hide its one-byte type from the optimizer */
+    __asm__("" : "+r"(p));
+    return p;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static bool block_of(uint32_t addr, uint32_t *start, uint32_t *size) {
+    uint32_t base = cspy.flash_base;
+
+    for (int i = 0; i < cspy.layout_num; i++) {
+        uint64_t span = (uint64_t)cspy.layout[i].count * cspy.layout[i].size;
+        if (addr >= base && addr < base + span) {
+            *size = cspy.layout[i].size;
+            *start = base + (addr - base) / *size * *size;
+            return true;
+        }
+        base += (uint32_t)span;
+    }
+    return false;
+}
+
+/* "count size [count size ...]", the <block> syntax of the .flash file */
+static bool parse_layout(const char *text) {
+    layout_region_t layout[MAX_LAYOUT_REGIONS];
+    int num = 0;
+    char *end;
+
+    while (*text) {
+        while (*text == ' ' || *text == '\t' || *text == '\n' || *text == ',') {
+            text++;
+        }
+        if (*text == '\0') {
+            break;
+        }
+        if (num == MAX_LAYOUT_REGIONS) {
+            return false;
+        }
+        layout[num].count = (uint32_t)strtoul(text, &end, 0);
+        if (end == text) {
+            return false;
+        }
+        text = end;
+        layout[num].size = (uint32_t)strtoul(text, &end, 0);
+        if (end == text || layout[num].count == 0 || layout[num].size == 0) {
+            return false;
+        }
+        text = end;
+        num++;
+    }
+    if (num == 0) {
+        return false;
+    }
+    memcpy(cspy.layout, layout, sizeof(layout));
+    cspy.layout_num = num;
+    return true;
+}
+
+static void set_args(const char *args) {
+    char *p = __argvbuf;
+    char *end = __argvbuf + MAX_ARG_SIZE;
+
+    __argc = 0;
+    while (args && *args && __argc < MAX_ARGS) {
+        while (*args == ' ') {
+            args++;
+        }
+        if (*args == '\0') {
+            break;
+        }
+        __argv[__argc++] = p;
+        while (*args && *args != ' ' && p < end - 1) {
+            *p++ = *args++;
+        }
+        *p++ = '\0';
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static bool flash_init(uint32_t image_size, const char *args) {
+    set_args(args);
+    theFlashParams.base_ptr = cspy.flash_base;
+    theFlashParams.block_size = image_size;
+    theFlashParams.offset_into_block = 0;
+    theFlashParams.count = 0;
+    theFlashParams.buffer = buffer_base();
+    cspy.buffer_size = SIM_BUFFER_SIZE;
+
+    uint32_t result = call_entry(Fl2FlashInitEntry, &phase.init);
+    uint32_t code = result & 0xFFFF;
+    if (code != RESULT_OK && code != RESULT_OVERRIDE_DEVICE) {
+        fprintf(stderr, "FlashInit failed: %lu\n", (unsigned long)result);
+        return false;
+    }
+    if (result & OVERRIDE_LAYOUT) {
+        if (!parse_layout(LAYOUT_OVERRIDE_BUFFER)) {
+            fprintf(stderr, "FlashInit returned a bad layout: \"%s\"\n", LAYOUT_OVERRIDE_BUFFER);
+            return false;
+        }
+    }
+    if (result & OVERRIDE_BUFSIZE) {
+        if (theFlashParams.block_size == 0 || theFlashParams.block_size > SIM_BUFFER_SIZE) {
+            fprintf(stderr, "FlashInit returned a bad buffer size: %lu\n",
+                    (unsigned long)theFlashParams.block_size);
+            return false;
+        }
+        cspy.buffer_size = theFlashParams.block_size;
+    }
+    if (result & OVERRIDE_PAGESIZE) {
+        cspy.page_size = theFlashParams.offset_into_block;
+    }
+    cspy.buffer_size -= cspy.buffer_size % cspy.page_size;
+    return true;
+}
+
+/**
+ * Erase every layout block touched by [start, end) with FlashEraseData lists.
+ */
+static bool flash_erase_list(uint32_t start, uint32_t end) {
+    FlashEraseData *list = (FlashEraseData *)buffer_base();
+    uint32_t max = cspy.buffer_size / sizeof(FlashEraseData);
+    uint32_t addr = start;
+
+    while (addr < end) {
+        uint32_t n = 0;
+        while (addr < end && n < max) {
+            uint32_t bstart, bsize;
+            if (!block_of(addr, &bstart, &bsize)) {
+                fprintf(stderr, "address 0x%08lX outside the flash layout\n", (unsigned long)addr);
+                return false;
+            }
+            list[n].start = bstart;
+            list[n].length = bsize;
+            n++;
+            addr = bstart + bsize;
+        }
+        debugger_advance(swd_ns(n * sizeof(FlashEraseData)));
+        theFlashParams.block_size = 0;
+        theFlashParams.count = n;
+        theFlashParams.buffer = list;
+        if (call_entry(Fl2FlashEraseWriteEntry, &phase.erase) != RESULT_OK) {
+            fprintf(stderr, "FlashErase failed\n");
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool flash_write_chunk(uint32_t addr, const uint8_t *data, uint32_t len, bool erase_first) {
+    uint32_t bstart, bsize;
+
+    if (!block_of(addr, &bstart, &bsize)) {
+        fprintf(stderr, "address 0x%08lX outside the flash layout\n", (unsigned long)addr);
+        return false;
+    }
+    memcpy(buffer_base(), data, len);
+    debugger_advance(swd_ns(len));
+
+    theFlashParams.base_ptr = bstart;
+    theFlashParams.offset_into_block = addr - bstart;
+    theFlashParams.count = len;
+    theFlashParams.buffer = buffer_base();
+    if (erase_first) {
+        theFlashParams.block_size = bsize;
+        return call_entry(Fl2FlashEraseWriteEntry, &phase.write) == RESULT_OK;
+    }
+    return call_entry(Fl2FlashWriteEntry, &phase.write) == RESULT_OK;
+}
+
+/**
+ * Compare the bytes of a part with [offset, offset + len) of the flash array.
+ * A part of a parallel array holds every second byte, starting at lane.
+ */
+static bool part_matches(sim_nor_t *nor, uint32_t lane, uint32_t offset, const uint8_t *data, uint32_t len) {
+    const uint8_t *array = sim_nor_array(nor);
+    uint32_t lanes = parallel ? 2 : 1;
+
+    for (uint32_t i = 0; i < len; i++) {
+        uint32_t pos = offset + i;
+        if (pos % lanes == lane && array[pos / lanes] != data[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool array_matches(uint32_t offset, const uint8_t *data, uint32_t len) {
+    if (parallel) {
+        return part_matches(sim_flexspi_port[0], 0, offset, data, len) &&
+               part_matches(sim_flexspi_port[2], 1, offset, data, len);
+    }
+    /* every device holds the part of [offset, offset + len) in its own window */
+    uint32_t base = 0;
+    for (int i = 0; i < devices && len; i++) {
+        uint32_t size = sim_nor_profile(sim_flexspi_port[i])->capacity;
+        if (offset < base + size) {
+            uint32_t part = base + size - offset < len ? base + size - offset : len;
+            if (!part_matches(sim_flexspi_port[i], 0, offset - base, data, part)) {
+                return false;
+            }
+            offset += part;
+            data += part;
+            len -= part;
+        }
+        base += size;
+    }
+    return len == 0;
+}
+
+static bool flash_verify(uint32_t addr, const uint8_t *data, uint32_t len) {
+    if (loader_has_checksum) {
+        theFlashParams.base_ptr = addr;
+        theFlashParams.count = len;
+        uint32_t sum = call_entry(Fl2FlashChecksumEntry, &phase.checksum);
+        if (loader_has_checksum) {
+            return (uint16_t)sum == Crc16(data, len);
+        }
+    }
+    uint64_t ns = swd_ns(len);
+    debugger_advance(ns);
+    phase.readback += ns;
+    return array_matches(addr - cspy.flash_base, data, len);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static uint8_t *make_image(uint32_t size, unsigned fill_percent, unsigned seed) {
+    uint8_t *image = malloc(size);
+    uint32_t pos = 0;
+
+    if (image == NULL) {
+        return NULL;
+    }
+    srand(seed);
+    while (pos < size) {
+        uint32_t run = 256U * (1U + (uint32_t)rand() % 16U);
+        bool blank = (unsigned)(rand() % 100) < fill_percent;
+        for (uint32_t i = 0; i < run && pos < size; i++, pos++) {
+            image[pos] = blank ? 0xFF : (uint8_t)rand();
+        }
+    }
+    return image;
+}
+
+static uint8_t *load_image(const char *path, uint32_t *size) {
+    FILE *f = fopen(path, "rb");
+    uint8_t *image = NULL;
+    long len;
+
+    if (f == NULL) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return NULL;
+    }
+    if (fseek(f, 0, SEEK_END) == 0 && (len = ftell(f)) > 0 && fseek(f, 0, SEEK_SET) == 0) {
+        image = malloc((size_t)len);
+        if (image && fread(image, 1, (size_t)len, f) != (size_t)len) {
+            free(image);
+            image = NULL;
+        }
+        *size = (uint32_t)len;
+    }
+    fclose(f);
+    return image;
+}
+
+/*
+ * The SFDP image every device kept, read or taken from the cache, is the one
+ * of its part. --profile a,b,.. needs a loader built with as many devices.
+ */
+static bool sfdp_images_match(const char *dump_path) {
+    extern sfdp_flash flash_table[];
+    bool match = true;
+
+    for (int i = 0; i < devices; i++) {
+        const sfdp_flash *flash = &flash_table[i];
+        size_t size;
+        const uint8_t *sfdp;
+
+        if (sim_flexspi_port[i] == NULL || !flash->sfdp.available) {
+            continue;
+        }
+        sfdp = sim_nor_sfdp(sim_flexspi_port[i], &size);
+        if (flash->image_len > size || memcmp(flash->image, sfdp, flash->image_len) != 0) {
+            fprintf(stderr, "SFDP image of device %d differs from the flash\n", i);
+            match = false;
+        }
+    }
+    if (dump_path != NULL) {
+        FILE *f = fopen(dump_path, "wb");
+        if (f == NULL || fwrite(flash_table[0].image, 1, flash_table[0].image_len, f) != flash_table[0].image_len) {
+            fprintf(stderr, "%s: %s\n", dump_path, strerror(errno));
+            match = false;
+        }
+        if (f != NULL) {
+            fclose(f);
+        }
+    }
+    return match;
+}
+
+static void print_time(const char *label, uint64_t ns) {
+    printf("  %-24s %12.3f ms\n", label, (double)ns / 1e6);
+}
+
+static void usage(const char *prog) {
+    printf("usage: %s [options]\n"
+           "  --profile NAME     flash device model (default w25q32jv), NAME,NAME,.. for one device\n"
+           "                     per chip select A1, A2, B1, B2 in consecutive address windows\n"
+           "  --list-profiles    show the available flash models\n"
+           "  --image FILE       raw binary to download (default: synthetic image)\n"
+           "  --size N           synthetic image size (default 0x100000)\n"
+           "  --fill PERCENT     share of blank (0xFF) pages in the synthetic image (default 25)\n"
+           "  --seed N           synthetic image seed (default 1)\n"
+           "  --offset N         image offset from the flash base (default 0)\n"
+           "  --args \"ARGS\"      flashloader arguments, as in the .board file (default --setQE)\n"
+           "  --erase-mode M     list: aggregated FlashEraseData lists (default), block: erase+write per block\n"
+           "  --ports N          identical flash parts on FlexSPI A1, A2, B1, B2 (default 1)\n"
+           "  --parallel         two flash parts on A1 and B1 as one parallel array\n"
+           "  --swd-khz N        debugger SWD clock (default 1000)\n"
+           "  --call-us N        debugger cost of one flashloader call (default 1500)\n"
+           "  --sessions N       N - 1 earlier debug sessions (FlashInit, FlashSignoff) before the download,\n"
+           "                     the figures are those of the download (default 1)\n"
+           "  --dump-sfdp FILE   write the SFDP image FlashInit kept of the device on A1\n"
+           "  --verbose          echo the flashloader LPUART log\n",
+           prog);
+}
+
+int main(int argc, char *argv[]) {
+    static const struct option options[] = {
+        { "profile", required_argument, NULL, 'p' },
+        { "list-profiles", no_argument, NULL, 'L' },
+        { "image", required_argument, NULL, 'i' },
+        { "size", required_argument, NULL, 's' },
+        { "fill", required_argument, NULL, 'f' },
+        { "seed", required_argument, NULL, 'S' },
+        { "offset", required_argument, NULL, 'o' },
+        { "args", required_argument, NULL, 'a' },
+        { "erase-mode", required_argument, NULL, 'e' },
+        { "ports", required_argument, NULL, 'P' },
+        { "parallel", no_argument, NULL, 'D' },
+        { "swd-khz", required_argument, NULL, 'k' },
+        { "call-us", required_argument, NULL, 'c' },
+        { "sessions", required_argument, NULL, 'n' },
+        { "dump-sfdp", required_argument, NULL, 'd' },
+        { "verbose", no_argument, NULL, 'v' },
+        { "help", no_argument, NULL, 'h' },
+        { NULL, 0, NULL, 0 },
+    };
+    const char *profile_name = "w25q32jv";
+    const char *image_path = NULL;
+    const char *sfdp_path = NULL;
+    const char *loader_args = "--setQE";
+    uint32_t size = 0x100000;
+    uint32_t offset = 0;
+    unsigned fill = 25;
+    unsigned seed = 1;
+    int ports = 1;
+    int sessions = 1;
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "vh", options, NULL)) != -1) {
+        switch (opt) {
+        case 'p': profile_name = optarg; break;
+        case 'L': sim_nor_list_profiles(); return 0;
+        case 'i': image_path = optarg; break;
+        case 's': size = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 'f': fill = (unsigned)strtoul(optarg, NULL, 0); break;
+        case 'S': seed = (unsigned)strtoul(optarg, NULL, 0); break;
+        case 'o': offset = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 'a': loader_args = optarg; break;
+        case 'e':
+            if (strcmp(optarg, "list") == 0) {
+                cspy.erase_list = true;
+            } else if (strcmp(optarg, "block") == 0) {
+                cspy.erase_list = false;
+            } else {
+                usage(argv[0]);
+                return 2;
+            }
+            break;
+        case 'P': ports = (int)strtol(optarg, NULL, 0); break;
+        case 'D': parallel = true; break;
+        case 'k': cspy.swd_khz = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 'c': cspy.call_ns = SIM_US(strtoull(optarg, NULL, 0)); break;
+        case 'n': sessions = (int)strtol(optarg, NULL, 0); break;
+        case 'd': sfdp_path = optarg; break;
+        case 'v': sim_verbose = true; break;
+        case 'h': usage(argv[0]); return 0;
+        default: usage(argv[0]); return 2;
+        }
+    }
+    if (cspy.swd_khz == 0) {
+        cspy.swd_khz = 1;
+    }
+    if (ports < 1 || ports > SIM_PORT_NUM || (parallel && ports > 1) || sessions < 1) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    const sim_nor_profile_t *profiles[SIM_PORT_NUM];
+    char profile_list[128];
+    char *next = NULL;
+    snprintf(profile_list, sizeof(profile_list), "%s", profile_name);
+    devices = 0;
+    for (char *name = strtok_r(profile_list, ",", &next); name; name = strtok_r(NULL, ",", &next)) {
+        if (devices == SIM_PORT_NUM) {
+            usage(argv[0]);
+            return 2;
+        }
+        profiles[devices] = sim_nor_find_profile(name);
+        if (profiles[devices] == NULL) {
+            fprintf(stderr, "unknown profile %s, available:\n", name);
+            sim_nor_list_profiles();
+            return 2;
+        }
+        devices++;
+    }
+    if (devices == 0 || (devices > 1 && (ports > 1 || parallel))) {
+        usage(argv[0]);
+        return 2;
+    }
+    const sim_nor_profile_t *profile = profiles[0];
+    /* the SFDP read of sfdp_init() (FlexSPI or LPSPI2) reaches the part on A1, a parallel array adds B1 (2) */
+    for (int i = 0; i < SIM_PORT_NUM; i++) {
+        if (i < ports || (parallel && i == 2) || i < devices) {
+            sim_flexspi_port[i] = sim_nor_create(i < devices ? profiles[i] : profile);
+            if (sim_flexspi_port[i] == NULL) {
+                fprintf(stderr, "cannot create the simulated flash\n");
+                return 2;
+            }
+        }
+    }
+    sim_nor_t *nor = sim_flexspi_port[0];
+    uint64_t capacity = (uint64_t)profile->capacity * (parallel ? 2 : 1);
+    for (int i = 1; i < devices; i++) {
+        capacity += profiles[i]->capacity;
+    }
+    if (!sim_flexspi_map_ahb() || !sim_board_map_ocram()) {
+        fprintf(stderr, "cannot set up the AHB window at 0x%08lX / OCRAM at 0x%08lX\n", SIM_AHB_BASE,
+                SIM_OCRAM_BASE);
+        return 2;
+    }
+    sim_lpspi_device = nor;
+
+    uint8_t *image = image_path ? load_image(image_path, &size) : make_image(size, fill, seed);
+    if (image == NULL || size == 0 || offset + (uint64_t)size > capacity) {
+        fprintf(stderr, "image does not fit the %lu KB flash\n", (unsigned long)(capacity >> 10));
+        return 2;
+    }
+
+    /* C-SPY pads the image to whole pages with 0xFF */
+    uint32_t start = cspy.flash_base + offset / cspy.page_size * cspy.page_size;
+    uint32_t end = cspy.flash_base + (offset + size + cspy.page_size - 1) / cspy.page_size * cspy.page_size;
+    uint32_t padded_len = end - start;
+    uint8_t *padded = malloc(padded_len);
+    if (padded == NULL) {
+        return 2;
+    }
+    memset(padded, 0xFF, padded_len);
+    memcpy(padded + (cspy.flash_base + offset - start), image, size);
+
+    bool qe_at_power_up[SIM_PORT_NUM] = { false };
+    for (int i = 0; i < SIM_PORT_NUM; i++) {
+        qe_at_power_up[i] = sim_flexspi_port[i] != NULL && sim_nor_quad_enabled(sim_flexspi_port[i]);
+    }
+
+    /* the loader RAM keeps its no-init data from one session to the next */
+    bool ok = true;
+    for (int i = 1; ok && i < sessions; i++) {
+        ok = flash_init(padded_len, loader_args);
+        if (ok) {
+            call_entry(Fl2FlashSignoffEntry, &phase.signoff);
+        }
+    }
+    uint64_t protocol_errors = sim_stats.protocol_errors;
+    uint64_t download_start = sim_now_ns;
+    memset(&phase, 0, sizeof(phase));
+    memset(&sim_stats, 0, sizeof(sim_stats));
+    sim_stats.protocol_errors = protocol_errors;
+
+    ok = ok && flash_init(padded_len, loader_args);
+    bool sfdp_match = !ok || sfdp_images_match(sfdp_path);
+    if (ok && cspy.erase_list) {
+        uint32_t bstart, bsize;
+        ok = block_of(end - 1, &bstart, &bsize) && flash_erase_list(start, end);
+    }
+    for (uint32_t pos = 0; ok && pos < padded_len;) {
+        uint32_t addr = start + pos;
+        uint32_t len = padded_len - pos;
+        if (!cspy.erase_list) {
+            /* one layout block per call */
+            uint32_t bstart, bsize;
+            ok = block_of(addr, &bstart, &bsize);
+            if (ok && len > bstart + bsize - addr) {
+                len = bstart + bsize - addr;
+            }
+        }
+        if (len > cspy.buffer_size) {
+            len = cspy.buffer_size;
+        }
+        ok = ok && flash_write_chunk(addr, padded + pos, len, !cspy.erase_list);
+        if (!ok) {
+            fprintf(stderr, "FlashWrite failed at 0x%08lX\n", (unsigned long)addr);
+        }
+        pos += len;
+    }
+    bool verified = ok;
+    for (uint32_t pos = 0; ok && pos < padded_len;) {
+        uint32_t len = padded_len - pos < cspy.buffer_size ? padded_len - pos : cspy.buffer_size;
+        if (!flash_verify(start + pos, padded + pos, len)) {
+            fprintf(stderr, "verify failed in 0x%08lX..0x%08lX\n", (unsigned long)(start + pos),
+                    (unsigned long)(start + pos + len - 1));
+            verified = false;
+            break;
+        }
+        pos += len;
+    }
+    if (ok) {
+        call_entry(Fl2FlashSignoffEntry, &phase.signoff);
+    }
+    /* independent of the loader's own checksum, every part must hold the image */
+    bool intact = array_matches(start - cspy.flash_base, padded, padded_len) && sfdp_match;
+    for (int i = 1; i < ports; i++) {
+        if (!part_matches(sim_flexspi_port[i], 0, start - cspy.flash_base, padded, padded_len)) {
+            fprintf(stderr, "flash on port %d does not hold the image\n", i);
+            intact = false;
+        }
+    }
+    /* --setQE leaves QE set, --clrQE cleared, no argument as found at power up, from the next reset on */
+    bool qe_keep = !strstr(loader_args, "--setQE") && !strstr(loader_args, "--clrQE");
+    for (int i = 0; i < SIM_PORT_NUM; i++) {
+        sim_nor_t *part = sim_flexspi_port[i];
+        bool qe_expected;
+
+        if (part == NULL || sim_nor_profile(part)->qer == 0 || !ok) {
+            continue;
+        }
+        if (strstr(loader_args, "--setQE")) {
+            qe_expected = true;
+        } else if (strstr(loader_args, "--clrQE")) {
+            qe_expected = false;
+        } else {
+            qe_expected = qe_at_power_up[i];
+        }
+        if (sim_nor_quad_enabled_at_power_up(part) != qe_expected) {
+            fprintf(stderr, "flash on port %d: QE is %s after signoff\n", i, qe_expected ? "clear" : "set");
+            intact = false;
+        }
+        /* without --setQE / --clrQE a part with volatile status register writes keeps its non-volatile ones */
+        if (qe_keep && sim_nor_profile(part)->volatile_sr && sim_stats.nv_sr_writes != 0) {
+            fprintf(stderr, "flash on port %d: %llu non-volatile status register writes\n", i,
+                    (unsigned long long)sim_stats.nv_sr_writes);
+            intact = false;
+        }
+    }
+    /* the next session reads SFDP in 1S-1S-1S */
+    if (sim_nor_is_octal(sim_flexspi_port[0])) {
+        fprintf(stderr, "flash on port 0 is left in octal DDR mode\n");
+        intact = false;
+    }
+
+    uint64_t total_ns = sim_now_ns - download_start;
+    uint64_t bytes_per_s = total_ns ? (uint64_t)padded_len * SIM_NS_PER_S / total_ns : 0;
+    printf("flashloader download: %d x %s%s, %lu bytes at 0x%08lX, %s erase\n", parallel ? 2 : ports * devices,
+           devices > 1 ? profile_name : profile->name, parallel ? " parallel" : "", (unsigned long)padded_len,
+           (unsigned long)start, cspy.erase_list ? "list" : "block");
+    print_time("FlashInit", phase.init);
+    print_time("erase", phase.erase);
+    print_time("write", phase.write);
+    print_time("checksum", phase.checksum);
+    print_time("signoff", phase.signoff);
+    print_time("debugger (SWD + calls)", phase.debugger);
+    print_time("  of which readback", phase.readback);
+    print_time("total", total_ns);
+    printf("  %-24s %12.1f KB/s\n", "throughput", (double)bytes_per_s / 1024.0);
+    printf("bus activity:\n");
+    print_time("busy polling", sim_stats.poll_ns);
+    printf("  %-24s %12llu\n", "  status reads", (unsigned long long)sim_stats.poll_cmds);
+    print_time("FlexSPI IP commands", sim_stats.ip_ns);
+    printf("  %-24s %12llu\n", "  commands", (unsigned long long)sim_stats.ip_cmds);
+    printf("  %-24s %12llu\n", "  8D-8D-8D", (unsigned long long)sim_stats.octal_cmds);
+    print_time("FlexSPI AHB reads", sim_stats.ahb_ns);
+    printf("  %-24s %12llu\n", "  bursts", (unsigned long long)sim_stats.ahb_bursts);
+    printf("  %-24s %12llu\n", "  1S-4D-4D", (unsigned long long)sim_stats.dtr_reads);
+    printf("  %-24s %12llu\n", "  continuous", (unsigned long long)sim_stats.continuous_reads);
+    print_time("LPSPI", sim_stats.lpspi_ns);
+    print_time("LPUART log", sim_stats.uart_ns);
+    printf("  %-24s %12llu\n", "  bytes", (unsigned long long)sim_stats.uart_bytes);
+    printf("flash operations:\n");
+    printf("  %-24s %12llu\n", "page programs", (unsigned long long)sim_stats.page_programs);
+    for (int i = 0; i < 4; i++) {
+        if (profile->erase[i].size) {
+            char label[32];
+            snprintf(label, sizeof(label), "%lu KB erases", (unsigned long)(profile->erase[i].size >> 10));
+            printf("  %-24s %12llu\n", label, (unsigned long long)sim_stats.erase_ops[i]);
+        }
+    }
+    printf("  %-24s %12llu\n", "chip erases", (unsigned long long)sim_stats.chip_erases);
+    printf("  %-24s %12llu\n", "protocol errors", (unsigned long long)sim_stats.protocol_errors);
+    printf("  %-24s %12llu\n", "busy violations", (unsigned long long)sim_stats.busy_violations);
+    printf("  %-24s %12llu\n", "rejected writes", (unsigned long long)sim_stats.write_rejects);
+    printf("  %-24s %12llu\n", "non-volatile SR writes", (unsigned long long)sim_stats.nv_sr_writes);
+    printf("result: %s\n", ok && verified && intact ? "PASS" : "FAIL");
+
+    free(padded);
+    free(image);
+    return ok && verified && intact && sim_stats.protocol_errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,1115 @@
+/*
+ * Host-side simulator for the i.MXRT SFDP flashloader.
+ *
+ * Behavioral serial NOR flash: array, status registers, SFDP image and the
+ * program/erase timing of the selected profile. Busy time is modeled against
+ * the simulated clock, so a controller polling the status register spends
+ * exactly as long as it would on the board.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+#define SFDP_IMAGE_SIZE             0x200
+#define SFDP_BASIC_PTR              0x80
+#define SFDP_BASIC_DWORDS           16          /* JESD216B */
+#define SFDP_BASIC_DWORDS_OCTAL     20          /* JESD216C, DWORD18 holds the octal command extension */
+#define SFDP_4BYTE_PTR              (SFDP_BASIC_PTR + SFDP_BASIC_DWORDS_OCTAL * 4)
+#define SFDP_4BYTE_DWORDS           2
+#define SFDP_SECTOR_MAP_PTR         (SFDP_4BYTE_PTR + SFDP_4BYTE_DWORDS * 4)
+#define SFDP_SECTOR_MAP_DWORDS      8
+#define SFDP_XSPI_PTR               (SFDP_SECTOR_MAP_PTR + SFDP_SECTOR_MAP_DWORDS * 4)
+#define SFDP_XSPI_DWORDS            5
+#define SFDP_OCTAL_SEQ_PTR          (SFDP_XSPI_PTR + SFDP_XSPI_DWORDS * 4)
+#define SFDP_OCTAL_SEQ_DWORDS       4
+
+/* octal parts: CR2 address 0, DTR OPI enable */
+#define CR2_DOPI                    0x02
+#define OCTAL_READ_DUMMY            20
+#define OCTAL_RDSR_DUMMY            4
+
+/* hybrid parts: SR2 bit that moves the parameter sectors to the top */
+#define SR2_TBPARM                  0x04
+
+/* data a read frame clocked in byte by byte is answered ahead of the master */
+#define SERIAL_READ_AHEAD           4096
+
+/* status register write time with WEL set by 06h (non-volatile) */
+#define T_W_NS                      SIM_MS(10)
+
+typedef enum {
+    OP_READ,
+    OP_PROGRAM,
+    OP_ERASE,
+    OP_CHIP_ERASE,
+    OP_RDSR,
+    OP_WRSR,
+    OP_WREN,
+    OP_WRDI,
+    OP_VWREN,
+    OP_RDID,
+    OP_RDSFDP,
+    OP_EN4B,
+    OP_EX4B,
+    OP_RSTEN,
+    OP_RST,
+    OP_WRCR2,
+} op_kind_t;
+
+typedef struct {
+    uint8_t cmd;
+    uint8_t kind;
+    uint8_t addr_pads;                          /* 0: no address phase */
+    uint8_t data_pads;                          /* 0: no data phase */
+    uint8_t dummy;                              /* mode + dummy clocks */
+    uint8_t reg;                                /* status register index */
+    bool    quad;                               /* needs QE */
+    uint8_t addr_bits;                          /* 24/32: fixed address width, 0: address mode */
+    bool    dtr;                                /* address, mode, dummy and data on both edges, dummy of the profile */
+} op_t;
+
+static const op_t op_table[] = {
+    { 0x03, OP_READ,       1, 1, 0, 0, false, 0 },
+    { 0x0B, OP_READ,       1, 1, 8, 0, false, 0 },
+    { 0x3B, OP_READ,       1, 2, 8, 0, false, 0 },
+    { 0xBB, OP_READ,       2, 2, 4, 0, false, 0 },
+    { 0x6B, OP_READ,       1, 4, 8, 0, true,  0 },
+    { 0xEB, OP_READ,       4, 4, 6, 0, true,  0 },
+    { 0xED, OP_READ,       4, 4, 0, 0, true,  0, true },
+    { 0x02, OP_PROGRAM,    1, 1, 0, 0, false, 0 },
+    { 0x32, OP_PROGRAM,    1, 4, 0, 0, true,  0 },
+    { 0x38, OP_PROGRAM,    4, 4, 0, 0, true,  0 },
+    { 0xC7, OP_CHIP_ERASE, 0, 0, 0, 0, false, 0 },
+    { 0x60, OP_CHIP_ERASE, 0, 0, 0, 0, false, 0 },
+    { 0x05, OP_RDSR,       0, 1, 0, 0, false, 0 },
+    { 0x35, OP_RDSR,       0, 1, 0, 1, false, 0 },
+    { 0x15, OP_RDSR,       0, 1, 0, 2, false, 0 },
+    { 0x01, OP_WRSR,       0, 1, 0, 0, false, 0 },
+    { 0x31, OP_WRSR,       0, 1, 0, 1, false, 0 },
+    { 0x11, OP_WRSR,       0, 1, 0, 2, false, 0 },
+    { 0x06, OP_WREN,       0, 0, 0, 0, false, 0 },
+    { 0x04, OP_WRDI,       0, 0, 0, 0, false, 0 },
+    { 0x50, OP_VWREN,      0, 0, 0, 0, false, 0 },
+    { 0x9F, OP_RDID,       0, 1, 0, 0, false, 0 },
+    { 0x5A, OP_RDSFDP,     1, 1, 8, 0, false, 24 },
+    { 0xB7, OP_EN4B,       0, 0, 0, 0, false, 0 },
+    { 0xE9, OP_EX4B,       0, 0, 0, 0, false, 0 },
+    { 0x66, OP_RSTEN,      0, 0, 0, 0, false, 0 },
+    { 0x99, OP_RST,        0, 0, 0, 0, false, 0 },
+    /* 4-byte address instructions, only on parts with instr_4b */
+    { 0x13, OP_READ,       1, 1, 0, 0, false, 32 },
+    { 0x0C, OP_READ,       1, 1, 8, 0, false, 32 },
+    { 0x6C, OP_READ,       1, 4, 8, 0, true,  32 },
+    { 0xEC, OP_READ,       4, 4, 6, 0, true,  32 },
+    { 0xEE, OP_READ,       4, 4, 0, 0, true,  32, true },
+    { 0x12, OP_PROGRAM,    1, 1, 0, 0, false, 32 },
+    { 0x34, OP_PROGRAM,    1, 4, 0, 0, true,  32 },
+    { 0x3E, OP_PROGRAM,    4, 4, 0, 0, true,  32 },
+    /* configuration register 2 write, only on octal parts */
+    { 0x72, OP_WRCR2,      1, 1, 0, 0, false, 32 },
+};
+
+/* 8D-8D-8D instructions of an octal part, the opcode is followed by its inverse */
+static const op_t octal_op_table[] = {
+    { 0xEE, OP_READ,       8, 8, OCTAL_READ_DUMMY, 0, false, 32 },
+    { 0x12, OP_PROGRAM,    8, 8, 0, 0, false, 32 },
+    { 0xC7, OP_CHIP_ERASE, 0, 0, 0, 0, false, 0 },
+    { 0x60, OP_CHIP_ERASE, 0, 0, 0, 0, false, 0 },
+    { 0x05, OP_RDSR,       8, 8, OCTAL_RDSR_DUMMY, 0, false, 32 },
+    { 0x06, OP_WREN,       0, 0, 0, 0, false, 0 },
+    { 0x04, OP_WRDI,       0, 0, 0, 0, false, 0 },
+    { 0x9F, OP_RDID,       8, 8, OCTAL_RDSR_DUMMY, 0, false, 32 },
+    { 0x5A, OP_RDSFDP,     8, 8, OCTAL_READ_DUMMY, 0, false, 32 },
+    { 0x66, OP_RSTEN,      0, 0, 0, 0, false, 0 },
+    { 0x99, OP_RST,        0, 0, 0, 0, false, 0 },
+    { 0x72, OP_WRCR2,      8, 8, 0, 0, false, 32 },
+};
+
+struct sim_nor {
+    const sim_nor_profile_t *profile;
+    uint8_t *array;
+    uint8_t sfdp[SFDP_IMAGE_SIZE];
+    uint8_t sr[3];
+    uint8_t sr_nv[3];                           /* non-volatile copy, loaded into sr at power up */
+    bool wel;
+    bool vwel;
+    bool addr_4_byte;
+    bool reset_enabled;
+    bool octal_ddr;                             /* CR2 DOPI set, 8D-8D-8D only */
+    bool continuous;                            /* 0-4-4: reads start at the address, opcode of continuous_cmd */
+    uint8_t continuous_cmd;
+    uint8_t last_cmd;                           /* opcode of the last decoded transaction */
+    uint64_t busy_until;
+    struct {                                    /* frame of sim_nor_serial_byte() while CS# is low */
+        uint8_t *tx;
+        uint8_t *rx;                            /* answered bytes of a read, rx_len of them */
+        size_t len;
+        size_t rx_len;
+        size_t size;
+        bool executed;
+    } frame;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+static const sim_nor_profile_t profiles[] = {
+    {
+        .name = "w25q32jv",
+        .jedec_id = { 0xEF, 0x40, 0x16 },
+        .capacity = 4UL << 20,
+        .page_size = 256,
+        .max_sck_hz = 133000000,
+        .sr_init = { 0x00, 0x02, 0x60 },
+        .qer = 4,
+        .volatile_sr = true,
+        .qpp_cmd = 0x32,
+        .continuous = true,
+        .t_pp_ns = SIM_US(400),
+        .t_bp1_ns = SIM_US(30),
+        .t_bp_ns = 2500,
+        .t_ce_ns = SIM_MS(10000),
+        .erase = {
+            { 4096,  0x20, 0x00, SIM_MS(45) },
+            { 32768, 0x52, 0x00, SIM_MS(120) },
+            { 65536, 0xD8, 0x00, SIM_MS(150) },
+        },
+    },
+    {
+        .name = "w25q128jv",
+        .jedec_id = { 0xEF, 0x40, 0x18 },
+        .capacity = 16UL << 20,
+        .page_size = 256,
+        .max_sck_hz = 133000000,
+        .sr_init = { 0x00, 0x02, 0x60 },
+        .qer = 4,
+        .volatile_sr = true,
+        .qpp_cmd = 0x32,
+        .t_pp_ns = SIM_US(400),
+        .t_bp1_ns = SIM_US(30),
+        .t_bp_ns = 2500,
+        .t_ce_ns = SIM_MS(40000),
+        .erase = {
+            { 4096,  0x20, 0x00, SIM_MS(45) },
+            { 32768, 0x52, 0x00, SIM_MS(120) },
+            { 65536, 0xD8, 0x00, SIM_MS(150) },
+        },
+    },
+    {
+        .name = "w25q256jv",
+        .jedec_id = { 0xEF, 0x40, 0x19 },
+        .capacity = 32UL << 20,
+        .page_size = 256,
+        .max_sck_hz = 133000000,
+        .sr_init = { 0x00, 0x02, 0x60 },
+        .qer = 4,
+        .volatile_sr = true,
+        .qpp_cmd = 0x32,
+        .addr_4_byte = true,
+        .instr_4b = true,
+        .continuous = true,
+        .t_pp_ns = SIM_US(400),
+        .t_bp1_ns = SIM_US(30),
+        .t_bp_ns = 2500,
+        .t_ce_ns = SIM_MS(80000),
+        .erase = {
+            { 4096,  0x20, 0x21, SIM_MS(45) },
+            { 32768, 0x52, 0x00, SIM_MS(120) },
+            { 65536, 0xD8, 0xDC, SIM_MS(150) },
+        },
+    },
+    {
+        /* 4 KB parameter sectors at the top of a 64 KB sector array */
+        .name = "s25fl127s",
+        .jedec_id = { 0x01, 0x20, 0x18 },
+        .capacity = 16UL << 20,
+        .page_size = 256,
+        .max_sck_hz = 108000000,
+        .sr_init = { 0x00, 0x02 | SR2_TBPARM, 0x00 },
+        .qer = 1,
+        .qpp_cmd = 0x32,
+        .param_sectors = 64UL << 10,
+        .t_pp_ns = SIM_US(250),
+        .t_bp1_ns = SIM_US(30),
+        .t_bp_ns = 2500,
+        .t_ce_ns = SIM_MS(33000),
+        .erase = {
+            { 4096,  0x20, 0x00, SIM_MS(130) },
+            { 65536, 0xD8, 0x00, SIM_MS(500) },
+        },
+    },
+    {
+        /* QE (SR1 bit 6) clear at power up, 1-4-4 quad page program, 1-4-4 DTR read, continuous read */
+        .name = "mx25l12845g",
+        .jedec_id = { 0xC2, 0x20, 0x18 },
+        .capacity = 16UL << 20,
+        .page_size = 256,
+        .max_sck_hz = 133000000,
+        .sr_init = { 0x00, 0x00, 0x00 },
+        .qer = 2,
+        .qpp_cmd = 0x38,
+        .dtr_dummy = 6,
+        .continuous = true,
+        .t_pp_ns = SIM_US(330),
+        .t_bp1_ns = SIM_US(25),
+        .t_bp_ns = 2000,
+        .t_ce_ns = SIM_MS(50000),
+        .erase = {
+            { 4096,  0x20, 0x00, SIM_MS(40) },
+            { 32768, 0x52, 0x00, SIM_MS(150) },
+            { 65536, 0xD8, 0x00, SIM_MS(250) },
+        },
+    },
+    {
+        /* octal part, 1S-1S-1S at power up, 8D-8D-8D after 72h */
+        .name = "mx25um51245g",
+        .jedec_id = { 0xC2, 0x80, 0x3A },
+        .capacity = 64UL << 20,
+        .page_size = 256,
+        .max_sck_hz = 200000000,
+        .sr_init = { 0x00, 0x00, 0x00 },
+        .qer = 0,
+        .addr_4_byte = true,
+        .instr_4b = true,
+        .octal = true,
+        .t_pp_ns = SIM_US(150),
+        .t_bp1_ns = SIM_US(15),
+        .t_bp_ns = 1000,
+        .t_ce_ns = SIM_MS(150000),
+        .erase = {
+            { 4096,  0x20, 0x21, SIM_MS(25) },
+            { 65536, 0xD8, 0xDC, SIM_MS(220) },
+        },
+    },
+};
+
+const sim_nor_profile_t *sim_nor_find_profile(const char *name) {
+    for (size_t i = 0; i < sizeof(profiles) / sizeof(profiles[0]); i++) {
+        if (strcmp(profiles[i].name, name) == 0) {
+            return &profiles[i];
+        }
+    }
+    return NULL;
+}
+
+void sim_nor_list_profiles(void) {
+    for (size_t i = 0; i < sizeof(profiles) / sizeof(profiles[0]); i++) {
+        const sim_nor_profile_t *p = &profiles[i];
+        printf("  %-12s JEDEC %02X %02X %02X, %lu KB, page %lu\n", p->name, p->jedec_id[0],
+               p->jedec_id[1], p->jedec_id[2], (unsigned long)(p->capacity >> 10),
+               (unsigned long)p->page_size);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Encode a typical time as JESD216 "count-1 + units" field.
+ */
+static uint32_t encode_time(uint64_t ns, const uint64_t *units, uint8_t unit_num, uint8_t count_bits) {
+    uint32_t max = 1UL << count_bits;
+    uint8_t u;
+
+    for (u = 0; u < unit_num - 1; u++) {
+        if ((ns + units[u] - 1) / units[u] <= max) {
+            break;
+        }
+    }
+    uint64_t count = (ns + units[u] - 1) / units[u];
+    if (count == 0) {
+        count = 1;
+    } else if (count > max) {
+        count = max;
+    }
+    return ((uint32_t)u << count_bits) | (uint32_t)(count - 1);
+}
+
+/* the 4-byte address flavour of the quad page program of a part */
+static uint8_t qpp_4b_cmd(const sim_nor_profile_t *p) {
+    return p->qpp_cmd == 0x38 ? 0x3E : 0x34;
+}
+
+static uint8_t log2_u32(uint32_t v) {
+    uint8_t n = 0;
+    while (v > 1) {
+        v >>= 1;
+        n++;
+    }
+    return n;
+}
+
+static void put_dword(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+/**
+ * Sector map header (FF81h) and table of a hybrid part: SR2 TBPARM detected
+ * by 35h, map 0 with the parameter sectors at the bottom, map 1 at the top.
+ * erase[0] works in the parameter sectors only, the others everywhere.
+ */
+static void build_sector_map(sim_nor_t *nor, uint8_t *h) {
+    const sim_nor_profile_t *p = nor->profile;
+    uint32_t all = 0, others = 0;
+    uint32_t param = ((p->param_sectors / 256 - 1) << 8);
+    uint32_t array = (((p->capacity - p->param_sectors) / 256 - 1) << 8);
+
+    for (int i = 0; i < 4; i++) {
+        if (p->erase[i].size) {
+            all |= 1UL << i;
+            others |= i ? 1UL << i : 0;
+        }
+    }
+    const uint32_t dw[SFDP_SECTOR_MAP_DWORDS] = {
+        (0x35UL << 8) | ((uint32_t)SR2_TBPARM << 24), 0xFFFFFFFFUL,
+        0x02UL | (0x00UL << 8) | (1UL << 16), param | all, array | others,
+        0x03UL | (0x01UL << 8) | (1UL << 16), array | others, param | all,
+    };
+
+    h[0] = 0x81;
+    h[1] = 0;
+    h[2] = 1;
+    h[3] = SFDP_SECTOR_MAP_DWORDS;
+    h[4] = SFDP_SECTOR_MAP_PTR;
+    h[5] = 0;
+    h[6] = 0;
+    h[7] = 0xFF;
+    for (int i = 0; i < SFDP_SECTOR_MAP_DWORDS; i++) {
+        put_dword(&nor->sfdp[SFDP_SECTOR_MAP_PTR + i * 4], dw[i]);
+    }
+}
+
+/**
+ * xSPI profile 1.0 header (FF05h) and table of an octal part: 8D-8D-8D read
+ * EEh with 20 dummy clocks at 200 MHz, read status with 4-byte address and
+ * 4 dummy clocks.
+ */
+static void build_xspi_profile(sim_nor_t *nor, uint8_t *h) {
+    const uint32_t dw[SFDP_XSPI_DWORDS] = {
+        (0xEEUL << 8) | (1UL << 29),
+        0,
+        0,
+        (uint32_t)OCTAL_READ_DUMMY << 7,
+        (18UL << 27) | (16UL << 17) | (12UL << 7),
+    };
+
+    h[0] = 0x05;
+    h[1] = 0;
+    h[2] = 1;
+    h[3] = SFDP_XSPI_DWORDS;
+    h[4] = (uint8_t)SFDP_XSPI_PTR;
+    h[5] = (uint8_t)(SFDP_XSPI_PTR >> 8);
+    h[6] = 0;
+    h[7] = 0xFF;
+    for (int i = 0; i < SFDP_XSPI_DWORDS; i++) {
+        put_dword(&nor->sfdp[SFDP_XSPI_PTR + i * 4], dw[i]);
+    }
+}
+
+/**
+ * Octal DDR command sequence header (FF0Ah) and table: 06h, then 72h writing
+ * DOPI to CR2 address 0.
+ */
+static void build_octal_seq(sim_nor_t *nor, uint8_t *h) {
+    const uint32_t dw[SFDP_OCTAL_SEQ_DWORDS] = {
+        (1UL << 24) | (0x06UL << 16), 0,
+        (6UL << 24) | (0x72UL << 16), (uint32_t)CR2_DOPI << 8,
+    };
+
+    h[0] = 0x0A;
+    h[1] = 0;
+    h[2] = 1;
+    h[3] = SFDP_OCTAL_SEQ_DWORDS;
+    h[4] = (uint8_t)SFDP_OCTAL_SEQ_PTR;
+    h[5] = (uint8_t)(SFDP_OCTAL_SEQ_PTR >> 8);
+    h[6] = 0;
+    h[7] = 0xFF;
+    for (int i = 0; i < SFDP_OCTAL_SEQ_DWORDS; i++) {
+        put_dword(&nor->sfdp[SFDP_OCTAL_SEQ_PTR + i * 4], dw[i]);
+    }
+}
+
+/**
+ * Build the JESD216B SFDP image (header, parameter headers and tables) of a
+ * profile, JESD216C for octal parts.
+ */
+static void build_sfdp(sim_nor_t *nor) {
+    static const uint64_t erase_units[] = { SIM_MS(1), SIM_MS(16), SIM_MS(128), SIM_MS(1000) };
+    static const uint64_t chip_units[] = { SIM_MS(16), SIM_MS(256), SIM_MS(4000), SIM_MS(64000) };
+    static const uint64_t page_units[] = { SIM_US(8), SIM_US(64) };
+    static const uint64_t byte_units[] = { SIM_US(1), SIM_US(8) };
+    const sim_nor_profile_t *p = nor->profile;
+    const uint8_t basic_dwords = p->octal ? SFDP_BASIC_DWORDS_OCTAL : SFDP_BASIC_DWORDS;
+    uint32_t dw[SFDP_BASIC_DWORDS_OCTAL + 1] = { 0 };
+    uint8_t *h = nor->sfdp;
+    uint8_t headers = 1;
+
+    memset(nor->sfdp, 0xFF, sizeof(nor->sfdp));
+
+    /* SFDP header: signature, revision 1.6 (1.8 octal), number of parameter headers - 1 (set below), unused byte */
+    memcpy(h, "SFDP", 4);
+    h[4] = p->octal ? 8 : 6;
+    h[5] = 1;
+    h[7] = 0xFF;
+
+    /* basic flash parameter header */
+    h[8] = 0x00;
+    h[9] = p->octal ? 8 : 6;
+    h[10] = 1;
+    h[11] = basic_dwords;
+    h[12] = SFDP_BASIC_PTR;
+    h[13] = 0;
+    h[14] = 0;
+    h[15] = 0xFF;
+
+    /* DWORD1: 4K erase, write granularity, non-volatile SR (volatile by 50h per DWORD16), fast read modes */
+    uint32_t erase_4k_cmd = 0xFF;
+    for (int i = 0; i < 4; i++) {
+        if (p->erase[i].size == 4096) {
+            erase_4k_cmd = p->erase[i].cmd;
+        }
+    }
+    dw[1] = (erase_4k_cmd != 0xFF && !p->param_sectors ? 0x01 : 0x03) | (1UL << 2) |
+            (erase_4k_cmd << 8) | (1UL << 16) | ((p->addr_4_byte ? 1UL : 0UL) << 17) |
+            (1UL << 20) | (1UL << 21) | (1UL << 22) | 0xFF800000UL;
+    /* DWORD2: density in bits - 1 */
+    dw[2] = p->capacity * 8 - 1;
+    /* DWORD3: 1-4-4 EBh (mode 2 + dummy 4), 1-1-4 6Bh (8 dummy) */
+    dw[3] = (4UL << 0) | (2UL << 5) | (0xEBUL << 8) | (8UL << 16) | (0UL << 21) | (0x6BUL << 24);
+    /* DWORD4: 1-1-2 3Bh (8 dummy), 1-2-2 BBh (mode 4 + dummy 0) */
+    dw[4] = (8UL << 0) | (0UL << 5) | (0x3BUL << 8) | (0UL << 16) | (4UL << 21) | (0xBBUL << 24);
+    /* DWORD5..7: no 2-2-2 / 4-4-4 */
+    dw[5] = 0xFFFFFFEEUL;
+    dw[6] = 0x0000FFFFUL;
+    dw[7] = 0x0000FFFFUL;
+    /* DWORD8/9: erase types */
+    for (int i = 0; i < 4; i++) {
+        uint32_t v = p->erase[i].size ? ((uint32_t)log2_u32(p->erase[i].size) | ((uint32_t)p->erase[i].cmd << 8)) : 0;
+        dw[8 + i / 2] |= v << ((i & 1) * 16);
+    }
+    /* DWORD10: typical erase times, max = 2 * (3 + 1) * typical */
+    dw[10] = 3;
+    for (int i = 0; i < 4; i++) {
+        if (p->erase[i].size) {
+            dw[10] |= encode_time(p->erase[i].t_ns, erase_units, 4, 5) << (4 + 7 * i);
+        }
+    }
+    /* DWORD11: program times, page size, chip erase time */
+    dw[11] = 2 | ((uint32_t)log2_u32(p->page_size) << 4) |
+             (encode_time(p->t_pp_ns, page_units, 2, 5) << 8) |
+             (encode_time(p->t_bp1_ns, byte_units, 2, 4) << 14) |
+             (encode_time(p->t_bp_ns, byte_units, 2, 4) << 19) |
+             (encode_time(p->t_ce_ns, chip_units, 4, 5) << 24);
+    /* DWORD12/13: no suspend/resume */
+    dw[12] = 0xFFFFFFFFUL;
+    dw[13] = 0xFFFFFFFFUL;
+    /* DWORD14: status polling by WIP, bit 0 of 05h */
+    dw[14] = 0x80000007UL;
+    /* DWORD15: quad enable requirement */
+    dw[15] = (uint32_t)p->qer << 20;
+    if (p->continuous) {
+        /* 0-4-4 mode, entered by mode bits A5h or Axh, left by mode bits 00h or Fh on IO0-3 for 8 (10) clocks */
+        dw[15] |= (1UL << 9) | (0x03UL << 10) | (0x05UL << 16);
+    }
+    /* DWORD16: soft reset 66h/99h; SR1 non-volatile by 06h, or also volatile by 50h */
+    dw[16] = (0x10UL << 8) | (p->addr_4_byte ? (0x01UL << 24) : 0) | (p->volatile_sr ? 0x08UL : 0x01UL);
+    if (p->dtr_dummy) {
+        /* DTR clocking */
+        dw[1] |= 1UL << 19;
+    }
+    if (p->octal) {
+        /* no 1-1-2, 1-2-2, 1-4-4 or 1-1-4 reads; 8D-8D-8D opcodes extended by their inverse */
+        dw[1] &= ~((1UL << 16) | (1UL << 20) | (1UL << 21) | (1UL << 22));
+        dw[18] = 1UL << 29;
+    }
+
+    for (int i = 1; i <= basic_dwords; i++) {
+        put_dword(&nor->sfdp[SFDP_BASIC_PTR + (i - 1) * 4], dw[i]);
+    }
+
+    if (p->param_sectors) {
+        build_sector_map(nor, &h[8 + 8 * headers++]);
+    }
+    if (p->octal) {
+        build_xspi_profile(nor, &h[8 + 8 * headers++]);
+        build_octal_seq(nor, &h[8 + 8 * headers++]);
+    }
+    nor->sfdp[6] = (uint8_t)(headers - 1 + (p->instr_4b ? 1 : 0));
+    if (!p->instr_4b) {
+        return;
+    }
+
+    /* 4-byte address instruction header (FF84h) and table */
+    h += 8 * headers++;
+    h[8] = 0x84;
+    h[9] = 0;
+    h[10] = 1;
+    h[11] = SFDP_4BYTE_DWORDS;
+    h[12] = SFDP_4BYTE_PTR;
+    h[13] = 0;
+    h[14] = 0;
+    h[15] = 0xFF;
+
+    /* DWORD1: 13h, 0Ch, 6Ch, ECh (EEh) reads, 12h and the quad page program, erase types with a 4-byte opcode */
+    uint32_t support = (1UL << 0) | (1UL << 1) | (1UL << 6) |
+                       (p->octal ? 0 : (1UL << 4) | (1UL << 5) | (qpp_4b_cmd(p) == 0x34 ? (1UL << 7) : (1UL << 8))) |
+                       (p->dtr_dummy ? (1UL << 15) : 0);
+    /* DWORD2: erase opcodes of types 1..4 */
+    uint32_t erase_cmds = 0xFFFFFFFFUL;
+    for (int i = 0; i < 4; i++) {
+        if (p->erase[i].size && p->erase[i].cmd_4b) {
+            support |= 1UL << (9 + i);
+            erase_cmds &= ~(0xFFUL << (8 * i));
+            erase_cmds |= (uint32_t)p->erase[i].cmd_4b << (8 * i);
+        }
+    }
+    put_dword(&nor->sfdp[SFDP_4BYTE_PTR], support);
+    put_dword(&nor->sfdp[SFDP_4BYTE_PTR + 4], erase_cmds);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+sim_nor_t *sim_nor_create(const sim_nor_profile_t *profile) {
+    sim_nor_t *nor = calloc(1, sizeof(*nor));
+    if (nor == NULL) {
+        return NULL;
+    }
+    nor->profile = profile;
+    nor->array = malloc(profile->capacity);
+    if (nor->array == NULL) {
+        free(nor);
+        return NULL;
+    }
+    memset(nor->array, 0xFF, profile->capacity);
+    memcpy(nor->sr, profile->sr_init, sizeof(nor->sr));
+    memcpy(nor->sr_nv, profile->sr_init, sizeof(nor->sr_nv));
+    build_sfdp(nor);
+    return nor;
+}
+
+const sim_nor_profile_t *sim_nor_profile(const sim_nor_t *nor) {
+    return nor->profile;
+}
+
+uint8_t *sim_nor_array(sim_nor_t *nor) {
+    return nor->array;
+}
+
+const uint8_t *sim_nor_sfdp(const sim_nor_t *nor, size_t *size) {
+    *size = sizeof(nor->sfdp);
+    return nor->sfdp;
+}
+
+uint8_t sim_nor_last_cmd(const sim_nor_t *nor) {
+    return nor->last_cmd;
+}
+
+bool sim_nor_is_busy(const sim_nor_t *nor) {
+    return sim_now_ns < nor->busy_until;
+}
+
+bool sim_nor_is_octal(const sim_nor_t *nor) {
+    return nor->octal_ddr;
+}
+
+static bool qe_of(const sim_nor_profile_t *p, const uint8_t *sr) {
+    switch (p->qer) {
+    case 0:
+        return true;
+    case 2:
+        return (sr[0] & 0x40) != 0;
+    case 3:
+        return (sr[1] & 0x80) != 0;
+    default:
+        return (sr[1] & 0x02) != 0;
+    }
+}
+
+bool sim_nor_quad_enabled(const sim_nor_t *nor) {
+    return qe_of(nor->profile, nor->sr);
+}
+
+/* QE of the non-volatile status registers, as the part comes out of the next reset */
+bool sim_nor_quad_enabled_at_power_up(const sim_nor_t *nor) {
+    return qe_of(nor->profile, nor->sr_nv);
+}
+
+static const op_t *find_op(const sim_nor_t *nor, uint8_t cmd, op_t *scratch) {
+    const sim_nor_profile_t *p = nor->profile;
+
+    if (nor->octal_ddr) {
+        for (size_t i = 0; i < sizeof(octal_op_table) / sizeof(octal_op_table[0]); i++) {
+            if (octal_op_table[i].cmd == cmd) {
+                return &octal_op_table[i];
+            }
+        }
+        /* 8D-8D-8D erases always take 4-byte addresses */
+        for (int i = 0; i < 4; i++) {
+            if (p->erase[i].size && p->erase[i].cmd_4b == cmd) {
+                memset(scratch, 0, sizeof(*scratch));
+                scratch->cmd = cmd;
+                scratch->kind = OP_ERASE;
+                scratch->addr_pads = 8;
+                scratch->reg = (uint8_t)i;
+                scratch->addr_bits = 32;
+                return scratch;
+            }
+        }
+        return NULL;
+    }
+
+    for (size_t i = 0; i < sizeof(op_table) / sizeof(op_table[0]); i++) {
+        if (op_table[i].cmd == cmd) {
+            if (op_table[i].addr_bits == 32 && !p->instr_4b) {
+                break;
+            }
+            if (op_table[i].kind == OP_WRCR2 && !p->octal) {
+                break;
+            }
+            if (op_table[i].dtr) {
+                if (!p->dtr_dummy) {
+                    break;
+                }
+                *scratch = op_table[i];
+                scratch->dummy = p->dtr_dummy;
+                return scratch;
+            }
+            /* parts implement one of the quad page program flavours */
+            if (op_table[i].kind == OP_PROGRAM && op_table[i].quad &&
+                cmd != (op_table[i].addr_bits == 32 ? qpp_4b_cmd(p) : p->qpp_cmd)) {
+                break;
+            }
+            return &op_table[i];
+        }
+    }
+    for (int i = 0; i < 4; i++) {
+        bool is_4b = p->instr_4b && p->erase[i].cmd_4b == cmd;
+        if (p->erase[i].size && (p->erase[i].cmd == cmd || is_4b)) {
+            memset(scratch, 0, sizeof(*scratch));
+            scratch->cmd = cmd;
+            scratch->kind = OP_ERASE;
+            scratch->addr_pads = 1;
+            scratch->reg = (uint8_t)i;
+            scratch->addr_bits = is_4b ? 32 : 0;
+            return scratch;
+        }
+    }
+    return NULL;
+}
+
+static void protocol_error(const sim_nor_xfer_t *xfer, const char *why) {
+    if (sim_stats.protocol_errors++ < 8) {
+        fprintf(stderr, "sim: flash cannot decode command %02Xh: %s\n", xfer->cmd, why);
+    }
+    if (xfer->data && !xfer->data_write) {
+        /* nobody drives the bus, the controller samples whatever floats on it */
+        for (size_t i = 0; i < xfer->data_len; i++) {
+            xfer->data[i] = (uint8_t)(0xA5 ^ (i * 7));
+        }
+    }
+}
+
+static uint64_t program_time(const sim_nor_profile_t *p, size_t len) {
+    uint64_t t = p->t_bp1_ns + (len ? (len - 1) : 0) * p->t_bp_ns;
+    return t < p->t_pp_ns ? t : p->t_pp_ns;
+}
+
+static bool take_wel(sim_nor_t *nor, bool *volatile_we) {
+    if (!nor->wel && !nor->vwel) {
+        sim_stats.write_rejects++;
+        return false;
+    }
+    if (volatile_we) {
+        *volatile_we = !nor->wel && nor->vwel;
+    }
+    nor->wel = false;
+    nor->vwel = false;
+    return true;
+}
+
+/**
+ * Execute one decoded bus transaction.
+ *
+ * @param is_poll   set when the transaction was a status register read
+ * @param modifies  set when the transaction changed the array or status registers
+ *
+ * @return false when the flash did not understand the transaction
+ */
+bool sim_nor_execute(sim_nor_t *nor, sim_nor_xfer_t *xfer, bool *is_poll, bool *modifies) {
+    const sim_nor_profile_t *p = nor->profile;
+    op_t scratch;
+    const op_t *op;
+    bool dummy_poll, dummy_mod;
+
+    if (is_poll == NULL) {
+        is_poll = &dummy_poll;
+    }
+    if (modifies == NULL) {
+        modifies = &dummy_mod;
+    }
+    *is_poll = false;
+    *modifies = false;
+
+    if (!xfer->no_cmd && xfer->cmd_pads == 4 && xfer->cmd == 0xFF && !xfer->has_addr && xfer->data_len == 0) {
+        /* mode bit reset, Fh on IO0-3 leaves continuous read and is ignored otherwise */
+        nor->continuous = false;
+        return true;
+    }
+    if (nor->continuous != xfer->no_cmd) {
+        /* in continuous read the first clocks carry the address */
+        protocol_error(xfer, nor->continuous ? "opcode in continuous read mode" : "no opcode outside continuous read");
+        return false;
+    }
+    if (xfer->no_cmd) {
+        xfer->cmd = nor->continuous_cmd;
+        sim_stats.continuous_reads++;
+    }
+    op = find_op(nor, xfer->cmd, &scratch);
+    if (op == NULL) {
+        protocol_error(xfer, "unknown opcode");
+        return false;
+    }
+    nor->last_cmd = xfer->cmd;
+    if (nor->octal_ddr) {
+        if (xfer->cmd_pads != 8 || !xfer->ddr || !xfer->has_cmd_ext || xfer->cmd_ext != (uint8_t)~xfer->cmd) {
+            protocol_error(xfer, "not an 8D-8D-8D opcode with its inverse");
+            return false;
+        }
+        sim_stats.octal_cmds++;
+    } else if (!xfer->no_cmd && (xfer->cmd_pads != 1 || xfer->cmd_ddr || xfer->has_cmd_ext)) {
+        protocol_error(xfer, "opcode not on a single line");
+        return false;
+    } else if (xfer->ddr != op->dtr) {
+        protocol_error(xfer, op->dtr ? "DTR instruction without DDR phases" : "DDR phases of an SDR instruction");
+        return false;
+    } else if (op->dtr) {
+        sim_stats.dtr_reads++;
+    }
+    if (op->addr_pads) {
+        uint8_t bits = op->addr_bits ? op->addr_bits : (nor->addr_4_byte ? 32 : 24);
+        if (!xfer->has_addr || xfer->addr_pads != op->addr_pads || xfer->addr_bits != bits) {
+            protocol_error(xfer, "address phase mismatch");
+            return false;
+        }
+    } else if (xfer->has_addr) {
+        protocol_error(xfer, "unexpected address phase");
+        return false;
+    }
+    if (op->kind == OP_READ || op->kind == OP_RDSFDP || op->kind == OP_RDSR || op->kind == OP_RDID) {
+        if (xfer->dummy_cycles != op->dummy) {
+            protocol_error(xfer, "dummy cycle mismatch");
+            return false;
+        }
+    }
+    if (xfer->data_len && (op->data_pads == 0 || xfer->data_pads != op->data_pads)) {
+        protocol_error(xfer, "data phase mismatch");
+        return false;
+    }
+    if (op->quad && !sim_nor_quad_enabled(nor)) {
+        /* IO2/IO3 still act as /WP and /HOLD */
+        protocol_error(xfer, "quad command with QE cleared");
+        return false;
+    }
+
+    if (sim_nor_is_busy(nor) && op->kind != OP_RDSR) {
+        sim_stats.busy_violations++;
+        return true;
+    }
+
+    uint32_t addr = xfer->addr;
+    switch (op->kind) {
+    case OP_READ:
+        for (size_t i = 0; i < xfer->data_len; i++) {
+            xfer->data[i] = nor->array[(addr + i) % p->capacity];
+        }
+        if (p->continuous && op->addr_pads == 4 && xfer->has_mode) {
+            /* mode bits 7-4 the complement of 3-0 (A5h) enter or stay in continuous read */
+            nor->continuous = (((xfer->mode >> 4) ^ xfer->mode) & 0x0F) == 0x0F;
+            nor->continuous_cmd = op->cmd;
+        }
+        break;
+    case OP_RDSFDP:
+        for (size_t i = 0; i < xfer->data_len; i++) {
+            xfer->data[i] = nor->sfdp[(addr + i) % SFDP_IMAGE_SIZE];
+        }
+        break;
+    case OP_RDID:
+        for (size_t i = 0; i < xfer->data_len; i++) {
+            xfer->data[i] = i < 3 ? p->jedec_id[i] : 0x00;
+        }
+        break;
+    case OP_RDSR:
+        *is_poll = true;
+        for (size_t i = 0; i < xfer->data_len; i++) {
+            uint8_t v = nor->sr[op->reg];
+            if (op->reg == 0) {
+                v = (uint8_t)((v & ~0x03) | (sim_nor_is_busy(nor) ? 0x01 : 0) | (nor->wel ? 0x02 : 0));
+            }
+            xfer->data[i] = v;
+        }
+        break;
+    case OP_WREN:
+        nor->wel = true;
+        break;
+    case OP_WRDI:
+        nor->wel = false;
+        nor->vwel = false;
+        break;
+    case OP_VWREN:
+        if (!p->volatile_sr) {
+            protocol_error(xfer, "50h on a part without volatile status register writes");
+            break;
+        }
+        nor->vwel = true;
+        break;
+    case OP_WRSR: {
+        bool volatile_we = false;
+        if (xfer->data_len == 0 || !take_wel(nor, &volatile_we)) {
+            break;
+        }
+        nor->sr[op->reg] = xfer->data[0] & (op->reg == 0 ? 0xFC : 0xFF);
+        if (op->reg == 0 && xfer->data_len > 1) {
+            nor->sr[1] = xfer->data[1];
+        } else if (op->reg == 0 && p->qer == 1) {
+            /* QER 001b: one byte status write clears status register 2 */
+            nor->sr[1] = 0;
+        }
+        if (p->param_sectors) {
+            /* TBPARM is one-time programmable, a write can set it but not clear it */
+            nor->sr[1] |= nor->sr_nv[1] & SR2_TBPARM;
+        }
+        if (!volatile_we) {
+            memcpy(nor->sr_nv, nor->sr, sizeof(nor->sr_nv));
+            nor->busy_until = sim_now_ns + T_W_NS;
+            sim_stats.nv_sr_writes++;
+        }
+        *modifies = true;
+        break;
+    }
+    case OP_PROGRAM: {
+        if (!take_wel(nor, NULL)) {
+            break;
+        }
+        uint32_t page = addr % p->capacity & ~(p->page_size - 1);
+        uint32_t col = addr & (p->page_size - 1);
+        for (size_t i = 0; i < xfer->data_len; i++) {
+            nor->array[page + ((col + i) & (p->page_size - 1))] &= xfer->data[i];
+        }
+        size_t len = xfer->data_len < p->page_size ? xfer->data_len : p->page_size;
+        nor->busy_until = sim_now_ns + program_time(p, len);
+        sim_stats.page_programs++;
+        sim_stats.program_bytes += len;
+        *modifies = true;
+        break;
+    }
+    case OP_ERASE: {
+        if (!take_wel(nor, NULL)) {
+            break;
+        }
+        uint32_t size = p->erase[op->reg].size;
+        uint32_t start = (addr % p->capacity) & ~(size - 1);
+        uint32_t param_start = (nor->sr[1] & SR2_TBPARM) ? p->capacity - p->param_sectors : 0;
+        if (p->param_sectors && op->reg == 0 && start - param_start >= p->param_sectors) {
+            protocol_error(xfer, "erase type 1 outside the parameter sectors");
+            break;
+        }
+        memset(&nor->array[start], 0xFF, size);
+        nor->busy_until = sim_now_ns + p->erase[op->reg].t_ns;
+        sim_stats.erase_ops[op->reg]++;
+        *modifies = true;
+        break;
+    }
+    case OP_CHIP_ERASE:
+        if (!take_wel(nor, NULL)) {
+            break;
+        }
+        memset(nor->array, 0xFF, p->capacity);
+        nor->busy_until = sim_now_ns + p->t_ce_ns;
+        sim_stats.chip_erases++;
+        *modifies = true;
+        break;
+    case OP_EN4B:
+        nor->addr_4_byte = true;
+        break;
+    case OP_EX4B:
+        nor->addr_4_byte = false;
+        break;
+    case OP_RSTEN:
+        nor->reset_enabled = true;
+        return true;
+    case OP_RST:
+        if (nor->reset_enabled) {
+            nor->wel = false;
+            nor->vwel = false;
+            nor->addr_4_byte = false;
+            nor->octal_ddr = false;
+        }
+        break;
+    case OP_WRCR2:
+        if (xfer->data_len == 0 || !take_wel(nor, NULL)) {
+            break;
+        }
+        /* only CR2 address 0 is modeled, the mode switches at CS# high */
+        if (addr == 0) {
+            nor->octal_ddr = (xfer->data[0] & CR2_DOPI) != 0;
+        }
+        break;
+    }
+    nor->reset_enabled = false;
+    return true;
+}
+
+/**
+ * Decode a single-line (1-1-1) byte stream as clocked in by a plain SPI master.
+ *
+ * @param tx  bytes driven on MOSI (command, address, dummy, write data)
+ * @param rx  bytes sampled on MISO, may be NULL
+ */
+bool sim_nor_serial(sim_nor_t *nor, const uint8_t *tx, uint8_t *rx, size_t len) {
+    sim_nor_xfer_t xfer = { 0 };
+    op_t scratch;
+    const op_t *op;
+    size_t pos = 1;
+
+    if (len == 0) {
+        return true;
+    }
+    if (rx) {
+        memset(rx, 0xFF, len);
+    }
+
+    xfer.cmd = tx[0];
+    xfer.cmd_pads = 1;
+    if (nor->octal_ddr) {
+        protocol_error(&xfer, "part is in octal DDR mode");
+        return false;
+    }
+    if (nor->continuous) {
+        protocol_error(&xfer, "part is in continuous read mode");
+        return false;
+    }
+    op = find_op(nor, xfer.cmd, &scratch);
+    if (op == NULL || op->quad || (op->addr_pads && op->addr_pads != 1) || (op->data_pads && op->data_pads != 1)) {
+        protocol_error(&xfer, "not a single line command");
+        return false;
+    }
+    if (op->addr_pads) {
+        xfer.has_addr = true;
+        xfer.addr_pads = 1;
+        xfer.addr_bits = op->addr_bits ? op->addr_bits : (nor->addr_4_byte ? 32 : 24);
+        if (len < pos + xfer.addr_bits / 8) {
+            protocol_error(&xfer, "frame ends inside the address");
+            return false;
+        }
+        for (int i = 0; i < xfer.addr_bits / 8; i++) {
+            xfer.addr = (xfer.addr << 8) | tx[pos++];
+        }
+    }
+    xfer.dummy_cycles = op->dummy;
+    pos += op->dummy / 8;
+    if (pos > len) {
+        pos = len;
+    }
+    xfer.data_pads = 1;
+    xfer.data_len = len - pos;
+    xfer.data_write = (op->kind == OP_PROGRAM || op->kind == OP_WRSR || op->kind == OP_WRCR2);
+
+    uint8_t *data = NULL;
+    if (xfer.data_len) {
+        data = malloc(xfer.data_len);
+        if (data == NULL) {
+            return false;
+        }
+        memcpy(data, &tx[pos], xfer.data_len);
+        xfer.data = data;
+    }
+    bool ok = sim_nor_execute(nor, &xfer, NULL, NULL);
+    if (ok && rx && data && !xfer.data_write) {
+        memcpy(&rx[pos], data, xfer.data_len);
+    }
+    free(data);
+    return ok;
+}
+
+/**
+ * Clock one byte of a single-line frame, CS# stays low until sim_nor_serial_end().
+ * A read is decoded as soon as its instruction, address and dummy bytes are in
+ * and answered SERIAL_READ_AHEAD bytes ahead, any other frame executes at CS# high.
+ *
+ * @return the byte sampled on MISO
+ */
+uint8_t sim_nor_serial_byte(sim_nor_t *nor, uint8_t tx) {
+    size_t pos = nor->frame.len;
+    op_t scratch;
+    const op_t *op;
+
+    if (pos == nor->frame.size) {
+        size_t size = nor->frame.size ? 2 * nor->frame.size : 64;
+        uint8_t *buf = realloc(nor->frame.tx, size);
+        if (buf == NULL) {
+            return 0xFF;
+        }
+        nor->frame.tx = buf;
+        nor->frame.size = size;
+    }
+    nor->frame.tx[nor->frame.len++] = tx;
+
+    if (pos < nor->frame.rx_len) {
+        return nor->frame.rx[pos];
+    }
+    if (nor->octal_ddr || nor->continuous) {
+        return 0xFF;
+    }
+    op = find_op(nor, nor->frame.tx[0], &scratch);
+    if (op == NULL || (op->kind != OP_READ && op->kind != OP_RDSR && op->kind != OP_RDID && op->kind != OP_RDSFDP)) {
+        return 0xFF;
+    }
+    size_t header = 1 + op->dummy / 8;
+    if (op->addr_pads) {
+        header += (op->addr_bits ? op->addr_bits : (nor->addr_4_byte ? 32 : 24)) / 8;
+    }
+    if (pos < header) {
+        return 0xFF;
+    }
+
+    /* the data a read puts out depends on its header only, answer ahead with dummy bytes clocked in */
+    size_t len = pos + SERIAL_READ_AHEAD;
+    uint8_t *rx = realloc(nor->frame.rx, len);
+    if (rx == NULL) {
+        return 0xFF;
+    }
+    nor->frame.rx = rx;
+    uint8_t *frame = malloc(len);
+    if (frame == NULL) {
+        return 0xFF;
+    }
+    memset(frame, 0xFF, len);
+    memcpy(frame, nor->frame.tx, header);
+    nor->frame.rx_len = len;
+    nor->frame.executed = true;
+    sim_nor_serial(nor, frame, rx, len);
+    free(frame);
+
+    return rx[pos];
+}
+
+/**
+ * CS# high after sim_nor_serial_byte(): a frame no read answered executes now.
+ */
+bool sim_nor_serial_end(sim_nor_t *nor) {
+    bool ok = true;
+
+    if (nor->frame.len && !nor->frame.executed) {
+        ok = sim_nor_serial(nor, nor->frame.tx, NULL, nor->frame.len);
+    }
+    nor->frame.len = 0;
+    nor->frame.rx_len = 0;
+    nor->frame.executed = false;
+    return ok;
+}
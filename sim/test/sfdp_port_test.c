@@ -0,0 +1,61 @@
+/*
+ * Host-side simulator for the i.MXRT SFDP flashloader.
+ *
+ * SFDP port test: the status register reads sfdp_device_init() issues through
+ * the FlexSPI backend of sfdp/port/sfdp_port.c, against a simulated part on
+ * port A1. Every read has to reach the part with its own opcode, not the one
+ * the read register sequence was loaded with before.
+ */
+
+#include <stdio.h>
+
+#include "sfdp.h"
+
+#include "sim.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+#define TEST_PROFILE                "w25q128jv"
+
+/* sfdp/port/sfdp_port.c, declared by its only caller in sfdp.c */
+sfdp_err sfdp_spi_port_init(sfdp_flash *flash);
+
+int main(void) {
+    static const uint8_t cmds[] = { SFDP_CMD_JEDEC_ID, SFDP_CMD_READ_STATUS_REGISTER, 0x35, 0x15 };
+    unsigned failures = 0;
+    sfdp_flash flash = { 0 };
+
+    sim_flexspi_port[0] = sim_nor_create(sim_nor_find_profile(TEST_PROFILE));
+    if (sim_flexspi_port[0] == NULL) {
+        return 2;
+    }
+    const sim_nor_profile_t *profile = sim_nor_profile(sim_flexspi_port[0]);
+
+    if (sfdp_spi_port_init(&flash) != SFDP_SUCCESS) {
+        printf("sfdp_spi_port_init failed\n");
+        return 1;
+    }
+    /* twice round, each opcode has to replace the previous one */
+    for (int round = 0; round < 2; round++) {
+        for (size_t i = 0; i < sizeof(cmds); i++) {
+            uint8_t value = 0;
+            uint8_t expect = i == 0 ? profile->jedec_id[0] : profile->sr_init[i - 1];
+            sfdp_err result = flash.spi.wr(&flash.spi, &cmds[i], 1, &value, 1);
+
+            if (result != SFDP_SUCCESS || sim_nor_last_cmd(sim_flexspi_port[0]) != cmds[i] || value != expect) {
+                printf("read %02Xh: result %d, opcode sent %02Xh, 0x%02X (0x%02X expected)\n", cmds[i], result,
+                       sim_nor_last_cmd(sim_flexspi_port[0]), value, expect);
+                failures++;
+            }
+        }
+    }
+    if (sim_stats.protocol_errors != 0) {
+        printf("%llu protocol errors\n", (unsigned long long)sim_stats.protocol_errors);
+        failures++;
+    }
+    sfdp_log_flush();
+
+    printf("sfdp port: %zu register reads, %u failures\n", 2 * sizeof(cmds), failures);
+    printf("result: %s\n", failures ? "FAIL" : "PASS");
+    return failures ? 1 : 0;
+}